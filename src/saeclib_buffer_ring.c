@@ -0,0 +1,128 @@
+#include "saeclib_buffer_ring.h"
+
+/**
+ * The buffer ring doesn't do much on its own; it's three circular buffers and a block of memory.
+ * Its job is to keep the bookkeeping between them honest: descriptors that refer to buffers
+ * outside of the pool are rejected on their way into a queue, so a stage never has to check.
+ */
+
+
+static saeclib_error_e check_desc(const saeclib_buffer_ring_t* ring,
+                                  const saeclib_buffer_desc_t* desc)
+{
+    if ((desc->buf_idx >= ring->buf_count) || (desc->len > ring->buf_size)) {
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+    } else {
+        return SAECLIB_ERROR_NOERROR;
+    }
+}
+
+
+saeclib_error_e saeclib_buffer_ring_init(saeclib_buffer_ring_t* ring,
+                                         void* poolspace,
+                                         size_t poolsize,
+                                         size_t buf_size,
+                                         saeclib_circular_buffer_t* free_bufs,
+                                         saeclib_circular_buffer_t* submissions,
+                                         saeclib_circular_buffer_t* completions)
+{
+    if ((poolspace == NULL) ||
+        (free_bufs == NULL) ||
+        (submissions == NULL) ||
+        (completions == NULL)) {
+        return SAECLIB_ERROR_NULL_POINTER;
+    }
+
+    // the pool has to hold at least one buffer, and buffers are named by uint32_t indices, so there
+    // can't be more of them than that holds.
+    if ((buf_size == 0) || (poolsize < buf_size) || ((poolsize / buf_size) > UINT32_MAX)) {
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+    }
+
+    ring->data = poolspace;
+    ring->buf_size = buf_size;
+    ring->buf_count = poolsize / buf_size;
+    ring->free_bufs = free_bufs;
+    ring->submissions = submissions;
+    ring->completions = completions;
+
+    if ((saeclib_circular_buffer_capacity(free_bufs) != (ring->buf_count + 1)) ||
+        (free_bufs->elt_size != sizeof(uint32_t)) ||
+        (submissions->elt_size != sizeof(saeclib_buffer_desc_t)) ||
+        (completions->elt_size != sizeof(saeclib_buffer_desc_t))) {
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+    }
+
+    // every buffer starts out in the pool.
+    for (uint32_t i = 0; i < ring->buf_count; i++) {
+        saeclib_circular_buffer_pushone(ring->free_bufs, &i);
+    }
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+size_t saeclib_buffer_ring_free_count(const saeclib_buffer_ring_t* ring)
+{
+    return saeclib_circular_buffer_size(ring->free_bufs);
+}
+
+
+saeclib_error_e saeclib_buffer_ring_acquire(saeclib_buffer_ring_t* ring, uint32_t* idx)
+{
+    return saeclib_circular_buffer_popone(ring->free_bufs, idx);
+}
+
+
+saeclib_error_e saeclib_buffer_ring_release(saeclib_buffer_ring_t* ring, uint32_t idx)
+{
+    if (idx >= ring->buf_count) {
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+    }
+
+    // The free list has room for every buffer, so this only fails if every buffer is already free.
+    // A buffer released twice while another one is out goes unnoticed.
+    if (saeclib_circular_buffer_pushone(ring->free_bufs, &idx) != SAECLIB_ERROR_NOERROR) {
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+    }
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_buffer_ring_submit(saeclib_buffer_ring_t* ring,
+                                           const saeclib_buffer_desc_t* desc)
+{
+    saeclib_error_e err;
+    if ((err = check_desc(ring, desc)) != SAECLIB_ERROR_NOERROR) {
+        return err;
+    }
+
+    return saeclib_circular_buffer_pushone(ring->submissions, desc);
+}
+
+
+saeclib_error_e saeclib_buffer_ring_take(saeclib_buffer_ring_t* ring,
+                                         saeclib_buffer_desc_t* desc)
+{
+    return saeclib_circular_buffer_popone(ring->submissions, desc);
+}
+
+
+saeclib_error_e saeclib_buffer_ring_complete(saeclib_buffer_ring_t* ring,
+                                             const saeclib_buffer_desc_t* desc)
+{
+    saeclib_error_e err;
+    if ((err = check_desc(ring, desc)) != SAECLIB_ERROR_NOERROR) {
+        return err;
+    }
+
+    return saeclib_circular_buffer_pushone(ring->completions, desc);
+}
+
+
+saeclib_error_e saeclib_buffer_ring_reap(saeclib_buffer_ring_t* ring,
+                                         saeclib_buffer_desc_t* desc)
+{
+    return saeclib_circular_buffer_popone(ring->completions, desc);
+}
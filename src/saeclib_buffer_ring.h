@@ -0,0 +1,187 @@
+#ifndef _SAECLIB_BUFFER_RING_H
+#define _SAECLIB_BUFFER_RING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "saeclib_circular_buffer.h"
+#include "saeclib_error.h"
+
+/**
+ * A saeclib buffer ring is a pool of fixed-size buffers paired with two queues of small
+ * descriptors that refer to those buffers by index. It's meant for moving large payloads between
+ * pipeline stages without copying them: the payload is written into a pool buffer once, and only
+ * the descriptor travels through the queues.
+ *
+ * A buffer's life looks like this:
+ *
+ *     producer:   saeclib_buffer_ring_acquire()       take a free buffer from the pool
+ *                 ... fill the buffer ...
+ *                 saeclib_buffer_ring_submit()        hand it to the worker
+ *     worker:     saeclib_buffer_ring_take()          get the next submission
+ *                 ... work on the buffer in place ...
+ *                 saeclib_buffer_ring_complete()      hand it back
+ *     producer:   saeclib_buffer_ring_reap()          get the next completion
+ *                 saeclib_buffer_ring_release()       return the buffer to the pool
+ *
+ * Each of the three queues has exactly one thread pushing and one thread popping, so the stages
+ * can run on different threads with no locks.
+ */
+
+/**
+ * Descriptors are what actually get queued. buf_idx says which pool buffer the descriptor refers
+ * to; len and flags are carried through untouched for the stages to use as they please.
+ */
+typedef struct saeclib_buffer_desc
+{
+    uint32_t buf_idx;
+    uint32_t len;
+    uint32_t flags;
+} saeclib_buffer_desc_t;
+
+typedef struct saeclib_buffer_ring
+{
+    // Pool memory; buffer number i starts at data + (i * buf_size).
+    uint8_t* data;
+
+    size_t buf_count;
+    size_t buf_size;
+
+    // Queue of uint32_t indexes of buffers that aren't owned by any stage.
+    saeclib_circular_buffer_t* free_bufs;
+
+    // Queues of saeclib_buffer_desc_t.
+    saeclib_circular_buffer_t* submissions;
+    saeclib_circular_buffer_t* completions;
+} saeclib_buffer_ring_t;
+
+/**
+ * As with saeclib_collection_init, the caller is responsible for statically allocating and
+ * initializing the queues that the buffer ring uses internally. saeclib_buffer_ring_salloc does all
+ * of this for you.
+ *
+ * @param[in,out] ring        Buffer ring to be initialized
+ * @param[in]     poolspace   Pointer to a statically allocated memory region for the buffers
+ *                            themselves.
+ * @param[in]     poolsize    Size of poolspace in bytes. sizeof(poolspace) should be passed in.
+ * @param[in]     buf_size    Size of each buffer in the pool, in bytes. The pool holds
+ *                            poolsize / buf_size buffers, which must be non-zero and fit in a
+ *                            uint32_t.
+ * @param[in]     free_bufs   Circular buffer with element size sizeof(uint32_t) and a capacity of
+ *                            the number of pool buffers + 1. It's filled with every buffer index.
+ * @param[in]     submissions Circular buffer with element size sizeof(saeclib_buffer_desc_t).
+ * @param[in]     completions Circular buffer with element size sizeof(saeclib_buffer_desc_t).
+ *
+ * @return If null pointers are provided, this function returns SAECLIB_ERROR_NULL_POINTER.
+ *         If buf_size is 0, the pool is too small for even one buffer, there are too many
+ *         buffers for a uint32_t index, or one of the queues isn't initialized correctly, this
+ *         function returns SAECLIB_ERROR_BAD_STRUCTURE.
+ *         Otherwise, SAECLIB_ERROR_NOERROR is returned.
+ */
+saeclib_error_e saeclib_buffer_ring_init(saeclib_buffer_ring_t* ring,
+                                         void* poolspace,
+                                         size_t poolsize,
+                                         size_t buf_size,
+                                         saeclib_circular_buffer_t* free_bufs,
+                                         saeclib_circular_buffer_t* submissions,
+                                         saeclib_circular_buffer_t* completions);
+
+/**
+ * As with all salloc macros in saeclib, use with caution. Containers initialized with a salloc
+ * macro must not be passed out of a function that's called more than once.
+ *
+ * @param[in]     buf_count   How many buffers should the pool have?
+ * @param[in]     buf_size    What's the size of each buffer, in bytes?
+ * @param[in]     queue_depth How many descriptors should each of the submission and completion
+ *                            queues be able to hold?
+ *
+ * @return This macro passes out a saeclib_buffer_ring_t.
+ *
+ * Example usage:
+ *
+ *     // 32 buffers of 2KiB each, with up to 16 descriptors in flight in each direction.
+ *     saeclib_buffer_ring_t ring = saeclib_buffer_ring_salloc(32, 2048, 16);
+ */
+#define saeclib_buffer_ring_salloc(buf_count, buf_size, queue_depth) \
+    ({ \
+    static saeclib_circular_buffer_t free_bufs, submissions, completions; \
+    free_bufs = saeclib_circular_buffer_salloc((buf_count) + 1, sizeof(uint32_t)); \
+    submissions = saeclib_circular_buffer_salloc((queue_depth) + 1, sizeof(saeclib_buffer_desc_t)); \
+    completions = saeclib_circular_buffer_salloc((queue_depth) + 1, sizeof(saeclib_buffer_desc_t)); \
+    saeclib_buffer_ring_t sbr; \
+    static uint8_t space[(buf_count) * (buf_size)] __attribute__((aligned(16))); \
+    saeclib_buffer_ring_init(&sbr, space, sizeof(space), (buf_size), \
+                             &free_bufs, &submissions, &completions); \
+    sbr; \
+    })
+
+/**
+ * Returns a pointer to the start of a pool buffer.
+ */
+static inline uint8_t* saeclib_buffer_ring_buffer(const saeclib_buffer_ring_t* ring, uint32_t idx)
+{
+    return ring->data + (idx * ring->buf_size);
+}
+
+/**
+ * Returns the number of buffers that are sitting in the pool, unowned.
+ */
+size_t saeclib_buffer_ring_free_count(const saeclib_buffer_ring_t* ring);
+
+/**
+ * Takes a buffer out of the pool. The caller owns it until it's submitted.
+ *
+ * @param[out]    idx         Index of the acquired buffer.
+ *
+ * @return SAECLIB_ERROR_UNDERFLOW if every buffer is in use, SAECLIB_ERROR_NOERROR otherwise.
+ */
+saeclib_error_e saeclib_buffer_ring_acquire(saeclib_buffer_ring_t* ring, uint32_t* idx);
+
+/**
+ * Gives a buffer back to the pool. Ownership of buffers isn't tracked, so releasing a buffer twice
+ * is only caught when every buffer is already in the pool; otherwise the pool ends up handing the
+ * same buffer out twice.
+ *
+ * @return SAECLIB_ERROR_BAD_STRUCTURE if idx isn't a valid buffer index or every buffer is already
+ *         in the pool, SAECLIB_ERROR_NOERROR otherwise.
+ */
+saeclib_error_e saeclib_buffer_ring_release(saeclib_buffer_ring_t* ring, uint32_t idx);
+
+/**
+ * Passes ownership of a buffer to whoever is consuming submissions.
+ *
+ * @return SAECLIB_ERROR_OVERFLOW if the submission queue is full.
+ *         SAECLIB_ERROR_BAD_STRUCTURE if the descriptor's index or length don't fit the pool.
+ *         SAECLIB_ERROR_NOERROR otherwise.
+ */
+saeclib_error_e saeclib_buffer_ring_submit(saeclib_buffer_ring_t* ring,
+                                           const saeclib_buffer_desc_t* desc);
+
+/**
+ * Takes the oldest descriptor from the submission queue.
+ *
+ * @return SAECLIB_ERROR_UNDERFLOW if there are no submissions, SAECLIB_ERROR_NOERROR otherwise.
+ */
+saeclib_error_e saeclib_buffer_ring_take(saeclib_buffer_ring_t* ring,
+                                         saeclib_buffer_desc_t* desc);
+
+/**
+ * Passes ownership of a buffer back to the submitting side through the completion queue.
+ *
+ * @return Same as saeclib_buffer_ring_submit, but for the completion queue.
+ */
+saeclib_error_e saeclib_buffer_ring_complete(saeclib_buffer_ring_t* ring,
+                                             const saeclib_buffer_desc_t* desc);
+
+/**
+ * Takes the oldest descriptor from the completion queue. The buffer it refers to still belongs
+ * to the caller, and should be passed to saeclib_buffer_ring_release once the caller is done with
+ * it.
+ *
+ * @return SAECLIB_ERROR_UNDERFLOW if there are no completions, SAECLIB_ERROR_NOERROR otherwise.
+ */
+saeclib_error_e saeclib_buffer_ring_reap(saeclib_buffer_ring_t* ring,
+                                         saeclib_buffer_desc_t* desc);
+
+#endif
@@ -2,23 +2,48 @@
 
 #include <string.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /**
- *
+ * Returns SAECLIB_ERROR_OVERFLOW if there isn't room for 'steps' more elements.
  */
-static inline saeclib_error_e try_advance_head(saeclib_circular_buffer_t* buf, size_t steps)
+static inline saeclib_error_e check_head_space(const saeclib_circular_buffer_t* buf, size_t steps)
 {
     if ((saeclib_circular_buffer_capacity(buf) - saeclib_circular_buffer_size(buf)) <= steps) {
         return SAECLIB_ERROR_OVERFLOW;
     } else {
-        buf->head += steps;
-        if (buf->head >= saeclib_circular_buffer_capacity(buf)) {
-            buf->head -= saeclib_circular_buffer_capacity(buf);
-        }
         return SAECLIB_ERROR_NOERROR;
     }
 }
 
 
+/**
+ * Pushes are bracketed by write_begin and write_end so that lockless readers can detect when the
+ * producer has written over something they were reading. write_begin has to be visible before any
+ * of the element data is, and write_end can't be visible until the new head is.
+ */
+static inline void begin_write(saeclib_circular_buffer_t* buf, size_t steps)
+{
+    __atomic_store_n(&buf->write_begin, buf->write_begin + steps, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+
+static inline void end_write(saeclib_circular_buffer_t* buf, size_t steps)
+{
+    int newhead = buf->head + steps;
+    if (newhead >= saeclib_circular_buffer_capacity(buf)) {
+        newhead -= saeclib_circular_buffer_capacity(buf);
+    }
+    __atomic_store_n(&buf->head, newhead, __ATOMIC_RELEASE);
+    __atomic_store_n(&buf->write_end, buf->write_end + steps, __ATOMIC_RELEASE);
+}
+
+
 saeclib_error_e saeclib_circular_buffer_init(saeclib_circular_buffer_t* buf,
                                              void* bufspace,
                                              size_t bufsize,
@@ -28,6 +53,8 @@ saeclib_error_e saeclib_circular_buffer_init(saeclib_circular_buffer_t* buf,
     buf->head = (buf->tail = 0);
     buf->capacity = bufsize / eltsize;
     buf->elt_size = eltsize;
+    buf->copy_elt = saeclib_copy_select(eltsize);
+    buf->write_begin = (buf->write_end = 0);
 
     return SAECLIB_ERROR_NOERROR;
 }
@@ -39,12 +66,19 @@ size_t saeclib_circular_buffer_capacity(const saeclib_circular_buffer_t* buf)
 }
 
 
+/**
+ * head and tail are loaded with acquire ordering so that one producer and one consumer can share a
+ * buffer: the consumer sees the element data behind every head it reads, and the producer doesn't
+ * overwrite an element until the consumer has finished reading it.
+ */
 size_t saeclib_circular_buffer_size(const saeclib_circular_buffer_t* buf)
 {
-    if (buf->head >= buf->tail) {
-        return (buf->head - buf->tail);
+    int head = __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE);
+    int tail = __atomic_load_n(&buf->tail, __ATOMIC_ACQUIRE);
+    if (head >= tail) {
+        return (head - tail);
     } else {
-        return ((buf->head + buf->capacity) - buf->tail);
+        return ((head + buf->capacity) - tail);
     }
 }
 
@@ -61,12 +95,14 @@ saeclib_error_e saeclib_circular_buffer_pushone(saeclib_circular_buffer_t* buf,
     void* oldhead = buf->data + (buf->head * buf->elt_size);
     saeclib_error_e err;
 
-    if ((err = try_advance_head(buf, 1)) != SAECLIB_ERROR_NOERROR) {
+    if ((err = check_head_space(buf, 1)) != SAECLIB_ERROR_NOERROR) {
         return err;
-    } else {
-        memcpy(oldhead, item, buf->elt_size);
     }
 
+    begin_write(buf, 1);
+    buf->copy_elt(oldhead, item, buf->elt_size);
+    end_write(buf, 1);
+
     return SAECLIB_ERROR_NOERROR;
 }
 
@@ -107,7 +143,7 @@ saeclib_error_e saeclib_circular_buffer_peekone(const saeclib_circular_buffer_t*
 {
     void* tailptr = buf->data + (buf->tail * buf->elt_size);
     if (!saeclib_circular_buffer_empty(buf)) {
-        memcpy(item, tailptr, buf->elt_size);
+        buf->copy_elt(item, tailptr, buf->elt_size);
         return SAECLIB_ERROR_NOERROR;
     } else {
         return SAECLIB_ERROR_UNDERFLOW;
@@ -115,6 +151,43 @@ saeclib_error_e saeclib_circular_buffer_peekone(const saeclib_circular_buffer_t*
 }
 
 
+saeclib_error_e saeclib_circular_buffer_snapshot(const saeclib_circular_buffer_t* buf,
+                                                 void* items,
+                                                 uint32_t numel,
+                                                 uint32_t* copied)
+{
+    const size_t capacity = saeclib_circular_buffer_capacity(buf);
+
+    while (1) {
+        // The head we read might already include a push that hasn't bumped write_end yet, but it
+        // can't be older than write_end. Either way, everything behind it has been written.
+        uint32_t end = __atomic_load_n(&buf->write_end, __ATOMIC_ACQUIRE);
+        int head = __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE);
+
+        uint32_t n = numel;
+        if (n > (capacity - 1)) n = capacity - 1;
+        if (n > end) n = end;
+
+        // copy the n elements behind head, which may be split across the end of the buffer.
+        size_t first = (n > head) ? (n - head) : 0;
+        memcpy(items, buf->data + ((capacity - first) * buf->elt_size), first * buf->elt_size);
+        memcpy((uint8_t*)items + (first * buf->elt_size),
+               buf->data + ((head - (n - first)) * buf->elt_size),
+               (n - first) * buf->elt_size);
+
+        // The oldest element we copied is element number (end - n) or newer. It gets overwritten
+        // when the producer starts on element (end - n + capacity), so as long as write_begin
+        // hasn't gotten that far, our copy is intact.
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint32_t begin = __atomic_load_n(&buf->write_begin, __ATOMIC_RELAXED);
+        if ((uint32_t)(begin - end) <= (capacity - n)) {
+            *copied = n;
+            return SAECLIB_ERROR_NOERROR;
+        }
+    }
+}
+
+
 // TODO: remove loop for performance
 saeclib_error_e saeclib_circular_buffer_peekmany(const saeclib_circular_buffer_t* buf,
                                                  void* item,
@@ -124,7 +197,7 @@ saeclib_error_e saeclib_circular_buffer_peekmany(const saeclib_circular_buffer_t
     int cnt = 0;
     while ((idx != buf->head) && (cnt < numel)) {
         void* tailptr = buf->data + (idx * buf->elt_size);
-        memcpy((uint8_t*)item + (cnt * buf->elt_size), tailptr, buf->elt_size);
+        buf->copy_elt((uint8_t*)item + (cnt * buf->elt_size), tailptr, buf->elt_size);
         idx = ((idx + 1) > buf->capacity) ? (0) : (idx + 1);
         cnt++;
     }
@@ -145,10 +218,11 @@ saeclib_error_e saeclib_circular_buffer_disposemany(saeclib_circular_buffer_t* b
     if (saeclib_circular_buffer_size(buf) < numel) {
         return SAECLIB_ERROR_UNDERFLOW;
     } else {
-        buf->tail += numel;
-        if (buf->tail >= saeclib_circular_buffer_capacity(buf)) {
-            buf->tail -= saeclib_circular_buffer_capacity(buf);
+        int newtail = buf->tail + numel;
+        if (newtail >= saeclib_circular_buffer_capacity(buf)) {
+            newtail -= saeclib_circular_buffer_capacity(buf);
         }
+        __atomic_store_n(&buf->tail, newtail, __ATOMIC_RELEASE);
         return SAECLIB_ERROR_NOERROR;
     }
 }
@@ -157,21 +231,41 @@ saeclib_error_e saeclib_circular_buffer_disposemany(saeclib_circular_buffer_t* b
 // ================================================================
 
 /**
- *
+ * memcpy, with a signature that matches the streaming copies so that bulk transfers can pick
+ * between them.
+ */
+static void memcpy_void(void* dst, const void* src, size_t n)
+{
+    memcpy(dst, src, n);
+}
+
+
+/**
+ * Returns SAECLIB_ERROR_OVERFLOW if there isn't room for 'steps' more bytes.
  */
-static inline saeclib_error_e try_advance_head_u8(saeclib_u8_circular_buffer_t* buf, size_t steps)
+static inline saeclib_error_e check_head_space_u8(const saeclib_u8_circular_buffer_t* buf,
+                                                  size_t steps)
 {
     if ((saeclib_u8_circular_buffer_capacity(buf) - saeclib_u8_circular_buffer_size(buf)) <= steps) {
         return SAECLIB_ERROR_OVERFLOW;
     } else {
-        buf->head += steps;
-        if (buf->head >= saeclib_u8_circular_buffer_capacity(buf)) {
-            buf->head -= saeclib_u8_circular_buffer_capacity(buf);
-        }
         return SAECLIB_ERROR_NOERROR;
     }
 }
 
+
+/**
+ * As with the generic buffer, head is only published once the bytes behind it have been written.
+ */
+static inline void advance_head_u8(saeclib_u8_circular_buffer_t* buf, size_t steps)
+{
+    int newhead = buf->head + steps;
+    if (newhead >= saeclib_u8_circular_buffer_capacity(buf)) {
+        newhead -= saeclib_u8_circular_buffer_capacity(buf);
+    }
+    __atomic_store_n(&buf->head, newhead, __ATOMIC_RELEASE);
+}
+
 saeclib_error_e saeclib_u8_circular_buffer_init(saeclib_u8_circular_buffer_t* buf,
                                              void* bufspace,
                                              size_t bufsize)
@@ -179,11 +273,19 @@ saeclib_error_e saeclib_u8_circular_buffer_init(saeclib_u8_circular_buffer_t* bu
     buf->data = (uint8_t*)bufspace;
     buf->head = (buf->tail = 0);
     buf->capacity = bufsize;
+    buf->stream_threshold = 0;
 
     return SAECLIB_ERROR_NOERROR;
 }
 
 
+void saeclib_u8_circular_buffer_set_streaming(saeclib_u8_circular_buffer_t* buf,
+                                              size_t threshold)
+{
+    buf->stream_threshold = threshold;
+}
+
+
 size_t saeclib_u8_circular_buffer_capacity(const saeclib_u8_circular_buffer_t* buf)
 {
     return buf->capacity;
@@ -192,10 +294,12 @@ size_t saeclib_u8_circular_buffer_capacity(const saeclib_u8_circular_buffer_t* b
 
 size_t saeclib_u8_circular_buffer_size(const saeclib_u8_circular_buffer_t* buf)
 {
-    if (buf->head >= buf->tail) {
-        return (buf->head - buf->tail);
+    int head = __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE);
+    int tail = __atomic_load_n(&buf->tail, __ATOMIC_ACQUIRE);
+    if (head >= tail) {
+        return (head - tail);
     } else {
-        return ((buf->head + buf->capacity) - buf->tail);
+        return ((head + buf->capacity) - tail);
     }
 }
 
@@ -212,12 +316,13 @@ saeclib_error_e saeclib_u8_circular_buffer_pushone(saeclib_u8_circular_buffer_t*
     uint8_t* oldhead = buf->data + buf->head;
     saeclib_error_e err;
 
-    if ((err = try_advance_head_u8(buf, 1)) != SAECLIB_ERROR_NOERROR) {
+    if ((err = check_head_space_u8(buf, 1)) != SAECLIB_ERROR_NOERROR) {
         return err;
-    } else {
-        *oldhead = item;
     }
 
+    *oldhead = item;
+    advance_head_u8(buf, 1);
+
     return SAECLIB_ERROR_NOERROR;
 }
 
@@ -229,17 +334,23 @@ saeclib_error_e saeclib_u8_circular_buffer_pushmany(saeclib_u8_circular_buffer_t
     int oldhead = buf->head;
     saeclib_error_e err;
 
-    if ((err = try_advance_head_u8(buf, numel)) != SAECLIB_ERROR_NOERROR) {
+    if ((err = check_head_space_u8(buf, numel)) != SAECLIB_ERROR_NOERROR) {
         return err;
     }
 
+    void (*copy)(void*, const void*, size_t) = memcpy_void;
+    if ((buf->stream_threshold != 0) && (numel >= buf->stream_threshold)) {
+        copy = saeclib_copy_stream_to;
+    }
+
     // // copy until the end of the buffer (could be zero if no space at end)
-    size_t available_at_end = (oldhead >= buf->tail) ? buf->capacity - oldhead : buf->tail - oldhead;
+    size_t available_at_end = buf->capacity - oldhead;
     size_t first_copy_size = available_at_end >= numel ? numel : available_at_end;
-    memcpy(buf->data + oldhead, items, first_copy_size);
+    copy(buf->data + oldhead, items, first_copy_size);
     // copy to the front of the buffer (could be zero if no space at front or all was copied on first step)
-    memcpy(buf->data, items + first_copy_size, numel - first_copy_size);
+    copy(buf->data, items + first_copy_size, numel - first_copy_size);
 
+    advance_head_u8(buf, numel);
     return SAECLIB_ERROR_NOERROR;
 }
 
@@ -293,12 +404,17 @@ saeclib_error_e saeclib_u8_circular_buffer_peekmany(const saeclib_u8_circular_bu
     if (saeclib_u8_circular_buffer_size(buf) < numel) {
         return SAECLIB_ERROR_UNDERFLOW;
     }
+    void (*copy)(void*, const void*, size_t) = memcpy_void;
+    if ((buf->stream_threshold != 0) && (numel >= buf->stream_threshold)) {
+        copy = saeclib_copy_stream_from;
+    }
+
     // copy until the end of the buffer (could be zero if no data at end)
-    size_t available_at_end = (buf->tail >= buf->head) ? buf->capacity - buf->tail : buf->head - buf->tail;
+    size_t available_at_end = buf->capacity - buf->tail;
     size_t first_copy_size = available_at_end >= numel ? numel : available_at_end;
-    memcpy(items, buf->data + buf->tail, first_copy_size);
+    copy(items, buf->data + buf->tail, first_copy_size);
     // copy from the front of the buffer (could be zero if no data at front or all was copied on first step)
-    memcpy(items + first_copy_size, buf->data, numel - first_copy_size);
+    copy(items + first_copy_size, buf->data, numel - first_copy_size);
     return SAECLIB_ERROR_NOERROR;
 }
 
@@ -315,10 +431,228 @@ saeclib_error_e saeclib_u8_circular_buffer_disposemany(saeclib_u8_circular_buffe
     if (saeclib_u8_circular_buffer_size(buf) < numel) {
         return SAECLIB_ERROR_UNDERFLOW;
     } else {
-        buf->tail += numel;
-        if (buf->tail >= saeclib_u8_circular_buffer_capacity(buf)) {
-            buf->tail -= saeclib_u8_circular_buffer_capacity(buf);
+        int newtail = buf->tail + numel;
+        if (newtail >= saeclib_u8_circular_buffer_capacity(buf)) {
+            newtail -= saeclib_u8_circular_buffer_capacity(buf);
         }
+        __atomic_store_n(&buf->tail, newtail, __ATOMIC_RELEASE);
         return SAECLIB_ERROR_NOERROR;
     }
 }
+
+
+/**
+ * Finds the one or two contiguous memory regions that hold the buffer's data, in order from tail
+ * to head. The second region is empty unless the data wraps around the end of the buffer.
+ */
+static void get_filled_segments_u8(const saeclib_u8_circular_buffer_t* buf,
+                                   const uint8_t** seg0, size_t* len0,
+                                   const uint8_t** seg1, size_t* len1)
+{
+    *seg0 = buf->data + buf->tail;
+    *seg1 = buf->data;
+    if (buf->head >= buf->tail) {
+        *len0 = buf->head - buf->tail;
+        *len1 = 0;
+    } else {
+        *len0 = buf->capacity - buf->tail;
+        *len1 = buf->head;
+    }
+}
+
+
+saeclib_error_e saeclib_u8_circular_buffer_free_segments(const saeclib_u8_circular_buffer_t* buf,
+                                                         uint8_t** seg0, size_t* len0,
+                                                         uint8_t** seg1, size_t* len1)
+{
+    // One byte always has to stay empty, so the free space ends just before the tail. The tail
+    // is only read once; a consumer could move it while we're working.
+    const int tail = __atomic_load_n(&buf->tail, __ATOMIC_ACQUIRE);
+
+    *seg0 = buf->data + buf->head;
+    *seg1 = buf->data;
+    if (buf->head < tail) {
+        *len0 = tail - buf->head - 1;
+        *len1 = 0;
+    } else if (tail == 0) {
+        *len0 = buf->capacity - buf->head - 1;
+        *len1 = 0;
+    } else {
+        *len0 = buf->capacity - buf->head;
+        *len1 = tail - 1;
+    }
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_u8_circular_buffer_commit(saeclib_u8_circular_buffer_t* buf,
+                                                  uint32_t numel)
+{
+    saeclib_error_e err;
+    if ((err = check_head_space_u8(buf, numel)) != SAECLIB_ERROR_NOERROR) {
+        return err;
+    }
+
+    advance_head_u8(buf, numel);
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+/**
+ * Returns the index of the first byte in p[0, len) that equals byte, or len if there is none.
+ */
+static size_t find_byte(const uint8_t* p, size_t len, uint8_t byte)
+{
+#if defined(__SSE2__)
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i needle32 = _mm256_set1_epi8((char)byte);
+    for (; (i + 32) <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        uint32_t hits = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle32));
+        if (hits) {
+            return i + __builtin_ctz(hits);
+        }
+    }
+#endif
+
+    const __m128i needle16 = _mm_set1_epi8((char)byte);
+    for (; (i + 16) <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        uint32_t hits = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle16));
+        if (hits) {
+            return i + __builtin_ctz(hits);
+        }
+    }
+
+    for (; i < len; i++) {
+        if (p[i] == byte) {
+            return i;
+        }
+    }
+    return len;
+#else
+    const uint8_t* hit = memchr(p, byte, len);
+    return (hit != NULL) ? (size_t)(hit - p) : len;
+#endif
+}
+
+
+/**
+ * Returns the index of the first byte in p[0, len) that's a member of the set, or len if there is
+ * none. table is a 256-bit membership bitmap of the same set, used for the scalar path.
+ */
+static size_t find_any_byte(const uint8_t* p, size_t len,
+                            const uint8_t* set, size_t setlen,
+                            const uint32_t table[8])
+{
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    if (setlen <= 16) {
+#if defined(__AVX2__)
+        for (; (i + 32) <= len; i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+            __m256i match = _mm256_setzero_si256();
+            for (size_t j = 0; j < setlen; j++) {
+                match = _mm256_or_si256(match, _mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)set[j])));
+            }
+            uint32_t hits = (uint32_t)_mm256_movemask_epi8(match);
+            if (hits) {
+                return i + __builtin_ctz(hits);
+            }
+        }
+#endif
+        for (; (i + 16) <= len; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+            __m128i match = _mm_setzero_si128();
+            for (size_t j = 0; j < setlen; j++) {
+                match = _mm_or_si128(match, _mm_cmpeq_epi8(v, _mm_set1_epi8((char)set[j])));
+            }
+            uint32_t hits = (uint32_t)_mm_movemask_epi8(match);
+            if (hits) {
+                return i + __builtin_ctz(hits);
+            }
+        }
+    }
+#endif
+
+    for (; i < len; i++) {
+        if (table[p[i] / 32] & (((uint32_t)1) << (p[i] % 32))) {
+            return i;
+        }
+    }
+    return len;
+}
+
+
+saeclib_error_e saeclib_u8_circular_buffer_find(const saeclib_u8_circular_buffer_t* buf,
+                                                uint8_t byte,
+                                                size_t* offset)
+{
+    const uint8_t *seg0, *seg1;
+    size_t len0, len1;
+    get_filled_segments_u8(buf, &seg0, &len0, &seg1, &len1);
+
+    size_t idx = find_byte(seg0, len0, byte);
+    if (idx == len0) {
+        idx = len0 + find_byte(seg1, len1, byte);
+        if (idx == (len0 + len1)) {
+            return SAECLIB_ERROR_UNDERFLOW;
+        }
+    }
+
+    *offset = idx;
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_u8_circular_buffer_find_any(const saeclib_u8_circular_buffer_t* buf,
+                                                    const uint8_t* set,
+                                                    size_t setlen,
+                                                    size_t* offset)
+{
+    const uint8_t *seg0, *seg1;
+    size_t len0, len1;
+    get_filled_segments_u8(buf, &seg0, &len0, &seg1, &len1);
+
+    uint32_t table[8] = { 0 };
+    for (size_t j = 0; j < setlen; j++) {
+        table[set[j] / 32] |= (((uint32_t)1) << (set[j] % 32));
+    }
+
+    size_t idx = find_any_byte(seg0, len0, set, setlen, table);
+    if (idx == len0) {
+        idx = len0 + find_any_byte(seg1, len1, set, setlen, table);
+        if (idx == (len0 + len1)) {
+            return SAECLIB_ERROR_UNDERFLOW;
+        }
+    }
+
+    *offset = idx;
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_u8_circular_buffer_pop_frame(saeclib_u8_circular_buffer_t* buf,
+                                                     uint8_t delim,
+                                                     uint8_t* frame,
+                                                     size_t framecap,
+                                                     size_t* framelen)
+{
+    size_t delim_offset;
+    saeclib_error_e err = saeclib_u8_circular_buffer_find(buf, delim, &delim_offset);
+    if (err != SAECLIB_ERROR_NOERROR) {
+        return err;
+    }
+
+    *framelen = delim_offset;
+    if (delim_offset > framecap) {
+        return SAECLIB_ERROR_OVERFLOW;
+    }
+
+    saeclib_u8_circular_buffer_peekmany(buf, frame, delim_offset);
+    return saeclib_u8_circular_buffer_disposemany(buf, delim_offset + 1);
+}
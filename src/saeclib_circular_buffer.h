@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include "saeclib_copy.h"
 #include "saeclib_error.h"
 
 typedef struct saeclib_circular_buffer
@@ -13,12 +14,23 @@ typedef struct saeclib_circular_buffer
 
     // head and tail of the circular buffer. These details should be irrelevant, but in case a user
     // really wants to muck around in the guts, data is added at head and removed at tail.
+    // Only the producer writes head and only the consumer writes tail, so one thread may push while
+    // another pops without any extra locking.
     int head, tail;
 
     // Total number of elements that the buffer can hold. Data should have capacity * elt_size bytes
     // alloated to it.
     size_t capacity;
     size_t elt_size;
+
+    // Routine used to copy single elements in and out of the buffer, chosen by
+    // saeclib_circular_buffer_init to suit elt_size.
+    saeclib_copy_fn_t copy_elt;
+
+    // Free-running counts of elements that the producer has started writing and finished writing.
+    // They only exist so that saeclib_circular_buffer_snapshot() can tell whether the producer
+    // overwrote the elements it was copying; they wrap around harmlessly.
+    uint32_t write_begin, write_end;
 } saeclib_circular_buffer_t;
 
 /**
@@ -158,6 +170,32 @@ saeclib_error_e saeclib_circular_buffer_popmany(saeclib_circular_buffer_t* buf,
 saeclib_error_e saeclib_circular_buffer_peekone(const saeclib_circular_buffer_t* buf,
                                                 void* item);
 
+/**
+ * Copies the most recently pushed elements out of the buffer without locking it and without
+ * removing anything. This is meant for a monitoring thread that wants to look at the last few
+ * samples in a buffer while a producer keeps pushing into it from another thread.
+ *
+ * The producer is never blocked. Instead, the producer publishes sequence counters around every
+ * push, and if the producer comes far enough around the buffer to overwrite an element while it's
+ * being copied, the copy is thrown away and retried.
+ *
+ * Elements are copied whether or not a consumer has already popped them, so the contents of the
+ * snapshot only depend on what was pushed. The oldest element is written to items[0].
+ *
+ * @param[in]     buf         The buffer to take a snapshot of
+ * @param[out]    items       Pointer to a memory location that can hold numel elements.
+ * @param[in]     numel       Maximum number of elements to copy.
+ * @param[out]    copied      Number of elements that were actually copied. This is limited by the
+ *                            capacity of the buffer (capacity - 1 elements) and by the number of
+ *                            elements that have been pushed so far.
+ *
+ * @returns SAECLIB_ERROR_NOERROR.
+ */
+saeclib_error_e saeclib_circular_buffer_snapshot(const saeclib_circular_buffer_t* buf,
+                                                 void* items,
+                                                 uint32_t numel,
+                                                 uint32_t* copied);
+
 /**
  *
  */
@@ -182,6 +220,10 @@ typedef struct saeclib_u8_circular_buffer
     uint8_t* data;
     int head, tail;
     size_t capacity;
+
+    // pushmany/popmany calls of at least this many bytes use non-temporal copies. 0 turns
+    // streaming off, which is the default.
+    size_t stream_threshold;
 } saeclib_u8_circular_buffer_t;
 
 
@@ -197,6 +239,22 @@ saeclib_error_e saeclib_u8_circular_buffer_init(saeclib_u8_circular_buffer_t* bu
         scb; \
     })
 
+/**
+ * Turns streaming mode on or off for bulk copies.
+ *
+ * When a large buffer is used to move a lot of data that the consumer won't look at until much
+ * later, copying it in and out with memcpy drags all of it through the cache and evicts whatever
+ * else was running. In streaming mode, pushmany writes the buffer with non-temporal stores and
+ * popmany/peekmany prefetch with a non-temporal hint. Small transfers are better off in the cache,
+ * so only transfers of at least 'threshold' bytes are streamed.
+ *
+ * @param[in,out] buf         The buffer to change.
+ * @param[in]     threshold   Smallest transfer, in bytes, that is streamed. 0 turns streaming off.
+ *                            A few KiB is a reasonable starting point.
+ */
+void saeclib_u8_circular_buffer_set_streaming(saeclib_u8_circular_buffer_t* buf,
+                                              size_t threshold);
+
 size_t saeclib_u8_circular_buffer_capacity(const saeclib_u8_circular_buffer_t* buf);
 size_t saeclib_u8_circular_buffer_size(const saeclib_u8_circular_buffer_t* buf);
 bool saeclib_u8_circular_buffer_empty(const saeclib_u8_circular_buffer_t* buf);
@@ -223,4 +281,96 @@ saeclib_error_e saeclib_u8_circular_buffer_disposeone(saeclib_u8_circular_buffer
 saeclib_error_e saeclib_u8_circular_buffer_disposemany(saeclib_u8_circular_buffer_t* buf,
                                                        uint32_t numel);
 
+/**
+ * Finds the free space in the buffer, for producers (DMA engines, file readers, ...) that want to
+ * write into the buffer directly instead of going through pushmany. The free space starts at head
+ * and may be split in two by the end of the buffer; the second segment is empty unless it is.
+ *
+ * Nothing is added to the buffer until saeclib_u8_circular_buffer_commit is called.
+ *
+ * @param[in]     buf         The buffer whose free space should be found.
+ * @param[out]    seg0        Start of the free space, at the buffer's head.
+ * @param[out]    len0        Number of free bytes starting at seg0.
+ * @param[out]    seg1        Start of the part of the free space that wraps around.
+ * @param[out]    len1        Number of free bytes starting at seg1.
+ *
+ * @returns This function always returns SAECLIB_ERROR_NOERROR.
+ */
+saeclib_error_e saeclib_u8_circular_buffer_free_segments(const saeclib_u8_circular_buffer_t* buf,
+                                                         uint8_t** seg0, size_t* len0,
+                                                         uint8_t** seg1, size_t* len1);
+
+/**
+ * Adds bytes that were written directly into the buffer's free space. The bytes become visible to
+ * a consumer on another thread no earlier than the head moves.
+ *
+ * @param[in,out] buf         The buffer whose head should be moved.
+ * @param[in]     numel       The number of bytes that were written starting at the head.
+ *
+ * @returns normally SAECLIB_ERROR_NOERROR.
+ *          If there aren't that many free bytes, the buffer is unchanged and
+ *          SAECLIB_ERROR_OVERFLOW is returned.
+ */
+saeclib_error_e saeclib_u8_circular_buffer_commit(saeclib_u8_circular_buffer_t* buf,
+                                                  uint32_t numel);
+
+/**
+ * Searches the buffer for the first occurrence of a byte, starting at its tail. Both segments of
+ * a wrapped buffer are searched, so callers don't need to worry about where the data sits.
+ *
+ * On x86 targets with SSE2 or AVX2 enabled, 16 or 32 bytes are compared at a time; otherwise this
+ * falls back on the C library's memchr.
+ *
+ * @param[in]     buf         The buffer to search
+ * @param[in]     byte        The byte to look for
+ * @param[out]    offset      Number of elements between the buffer's tail and the first matching
+ *                            byte. An offset of 0 means that the byte at the tail matched.
+ *
+ * @returns SAECLIB_ERROR_NOERROR if the byte was found.
+ *          If the byte isn't in the buffer, *offset is unchanged and SAECLIB_ERROR_UNDERFLOW is
+ *          returned.
+ */
+saeclib_error_e saeclib_u8_circular_buffer_find(const saeclib_u8_circular_buffer_t* buf,
+                                                uint8_t byte,
+                                                size_t* offset);
+
+/**
+ * Same as saeclib_u8_circular_buffer_find, but matches any one of several bytes.
+ *
+ * @param[in]     set         Array of bytes to look for.
+ * @param[in]     setlen      Number of bytes in set. Small sets (16 or fewer bytes) take the SIMD
+ *                            path; larger sets use a lookup table.
+ */
+saeclib_error_e saeclib_u8_circular_buffer_find_any(const saeclib_u8_circular_buffer_t* buf,
+                                                    const uint8_t* set,
+                                                    size_t setlen,
+                                                    size_t* offset);
+
+/**
+ * Removes one complete delimiter-terminated frame from the buffer's tail.
+ *
+ * The bytes before the first delimiter are copied into frame and the delimiter itself is
+ * discarded. Back-to-back delimiters produce zero-length frames; it's up to the caller to skip
+ * these if the protocol (for instance, HDLC-style 0x7e framing) uses delimiters as both openers
+ * and closers.
+ *
+ * @param[in,out] buf         The buffer from which a frame should be removed
+ * @param[in]     delim       Byte that terminates a frame, for instance '\n'.
+ * @param[out]    frame       Memory region that the frame's contents will be written to.
+ * @param[in]     framecap    Size of the frame memory region in bytes.
+ * @param[out]    framelen    Number of bytes written into frame, not counting the delimiter.
+ *
+ * @returns normally SAECLIB_ERROR_NOERROR.
+ *          If there is no complete frame in the buffer, the buffer is unchanged and
+ *          SAECLIB_ERROR_UNDERFLOW is returned.
+ *          If the frame doesn't fit in framecap bytes, the buffer is unchanged and
+ *          SAECLIB_ERROR_OVERFLOW is returned; *framelen is set to the size that would have been
+ *          needed, so the caller can either grow its frame buffer or dispose of the frame.
+ */
+saeclib_error_e saeclib_u8_circular_buffer_pop_frame(saeclib_u8_circular_buffer_t* buf,
+                                                     uint8_t delim,
+                                                     uint8_t* frame,
+                                                     size_t framecap,
+                                                     size_t* framelen);
+
 #endif
@@ -69,6 +69,7 @@ saeclib_error_e saeclib_collection_init(saeclib_collection_t* collection,
     collection->data = bufspace;
     collection->capacity = bufsize / eltsize;
     collection->elt_size = eltsize;
+    collection->copy_elt = saeclib_copy_select(eltsize);
     collection->slots = slots;
     collection->occupied_bitmap = bitmap_space;
 
@@ -129,7 +130,7 @@ saeclib_error_e saeclib_collection_add(saeclib_collection_t* scl,
 
     // copy into array
     void* slotptr = scl->data + (slot * scl->elt_size);
-    memcpy(slotptr, item, scl->elt_size);
+    scl->copy_elt(slotptr, item, scl->elt_size);
 
     return SAECLIB_ERROR_NOERROR;
 }
@@ -190,7 +191,7 @@ saeclib_error_e saeclib_collection_iterator_get(const saeclib_collection_t* coll
                                                 void* item)
 {
     void* slotptr = collection->data + (it->idx * collection->elt_size);
-    memcpy(item, slotptr, collection->elt_size);
+    collection->copy_elt(item, slotptr, collection->elt_size);
 
     return SAECLIB_ERROR_NOERROR;
 }
@@ -6,6 +6,7 @@
 #include <stddef.h>
 
 #include "saeclib_circular_buffer.h"
+#include "saeclib_copy.h"
 #include "saeclib_error.h"
 
 
@@ -21,6 +22,10 @@ typedef struct saeclib_collection
     size_t capacity;
     size_t elt_size;
 
+    // Routine used to copy elements in and out of the collection, chosen by saeclib_collection_init
+    // to suit elt_size.
+    saeclib_copy_fn_t copy_elt;
+
     // This queue is used for keeping track of open slots. It contains uint32_t that are index
     // numbers
     saeclib_circular_buffer_t* slots;
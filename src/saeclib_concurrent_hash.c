@@ -0,0 +1,392 @@
+#include "saeclib_concurrent_hash.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "saeclib_hash_functions.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Control word layout:
+ *     bits 0-2    state
+ *     bits 3-9    7 bits of the key's hash, while the bucket is BUSY, PENDING or FULL
+ *     bits 10-31  version, incremented on every state change (and allowed to wrap)
+ *
+ * The version is what lets a reader tell that a bucket it has just read didn't change underneath
+ * it, even if it went FULL -> TOMB -> FULL again with a different key that has the same hash bits.
+ */
+#define STATE_EMPTY   0u
+#define STATE_BUSY    1u
+#define STATE_PENDING 2u
+#define STATE_FULL    3u
+#define STATE_TOMB    4u
+#define STATE_MASK    7u
+
+#define TAG_SHIFT     3
+#define VERSION_SHIFT 10
+
+static inline uint32_t state_of(uint32_t w)
+{
+    return w & STATE_MASK;
+}
+
+static inline uint32_t tag_of(uint32_t w)
+{
+    return (w >> TAG_SHIFT) & 0x7f;
+}
+
+/**
+ * The control word that follows w when the bucket moves to a new state.
+ */
+static inline uint32_t next_word(uint32_t w, uint32_t state, uint32_t tag)
+{
+    uint32_t version = (w >> VERSION_SHIFT) + 1;
+    return (version << VERSION_SHIFT) | (tag << TAG_SHIFT) | state;
+}
+
+/**
+ * Same scrambling as the control bytes of saeclib_hash_table_t.
+ */
+static inline uint32_t tag_for_hash(unsigned int hash)
+{
+    return (hash * 0x9e3779b1u) >> 25;
+}
+
+static inline size_t home_idx(const saeclib_concurrent_hash_table_t* cht, unsigned int hash)
+{
+    return (size_t)saeclib_hash_mix64(hash) & cht->mask;
+}
+
+static inline uint8_t* get_keyptr_at_idx(const saeclib_concurrent_hash_table_t* cht, size_t idx)
+{
+    return cht->key_data + (idx * cht->key_elt_size);
+}
+
+static inline uint8_t* get_valptr_at_idx(const saeclib_concurrent_hash_table_t* cht, size_t idx)
+{
+    return cht->value_data + (idx * cht->value_elt_size);
+}
+
+/**
+ * Control words are read and written sequentially consistently by inserts: a thread that has just
+ * published its PENDING key must see every other thread's PENDING key that it might be racing with,
+ * or both could decide they won.
+ */
+static inline uint32_t load_ctrl(const saeclib_concurrent_hash_table_t* cht, size_t idx)
+{
+    return __atomic_load_n(&cht->ctrl[idx], __ATOMIC_SEQ_CST);
+}
+
+/**
+ * true if bucket idx's control word is still w, i.e. nothing read from the bucket since w was
+ * loaded was in the middle of changing.
+ */
+static inline bool unchanged(const saeclib_concurrent_hash_table_t* cht, size_t idx, uint32_t w)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&cht->ctrl[idx], __ATOMIC_RELAXED) == w;
+}
+
+static inline void spin_pause(void)
+{
+#if defined(__SSE2__)
+    _mm_pause();
+#endif
+}
+
+/**
+ * Waits for bucket idx to stop being BUSY and returns its control word.
+ */
+static inline uint32_t load_settled(const saeclib_concurrent_hash_table_t* cht, size_t idx)
+{
+    uint32_t w;
+    while (state_of(w = load_ctrl(cht, idx)) == STATE_BUSY)
+        spin_pause();
+    return w;
+}
+
+/**
+ * Compares the key in bucket idx against key, for a bucket whose control word was w and is
+ * PENDING or FULL with the right hash bits.
+ *
+ * @return 1 if it matches, 0 if it doesn't, -1 if the bucket changed while it was being compared
+ *         and has to be looked at again.
+ */
+static int bucket_matches(const saeclib_concurrent_hash_table_t* cht,
+                          size_t idx,
+                          uint32_t w,
+                          const void* key)
+{
+    int match = !cht->cmp(key, get_keyptr_at_idx(cht, idx));
+    return unchanged(cht, idx, w) ? match : -1;
+}
+
+
+saeclib_error_e saeclib_concurrent_hash_table_init(saeclib_concurrent_hash_table_t* cht,
+                                                   void* keyspace,
+                                                   void* valuespace,
+                                                   uint32_t* ctrlspace,
+                                                   size_t keyspace_size,
+                                                   size_t key_size,
+                                                   size_t value_size,
+                                                   unsigned int (*hash_fn)(const void*),
+                                                   int (*cmp)(const void*, const void*))
+{
+    size_t capacity = keyspace_size / key_size;
+    if ((capacity < 2) || ((capacity & (capacity - 1)) != 0))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    cht->key_data = keyspace;
+    cht->value_data = valuespace;
+    cht->ctrl = ctrlspace;
+    cht->capacity = capacity;
+    cht->mask = capacity - 1;
+    cht->key_elt_size = key_size;
+    cht->value_elt_size = value_size;
+    cht->hash_fn = hash_fn;
+    cht->cmp = cmp;
+
+    memset(ctrlspace, 0, capacity * sizeof(uint32_t));
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+/**
+ * After publishing key as PENDING in bucket mine, decides whether this insert has lost to another
+ * insert of the same key: one that already finished (FULL), or one still PENDING closer to the
+ * key's home bucket. Of several concurrent inserts of one key, only the one nearest home wins,
+ * unless it's beaten by one that finished before it became PENDING.
+ *
+ * A PENDING insert of the same key farther from home has to be waited for. It might have checked
+ * our bucket before we claimed it, when it was still a tombstone, in which case it won't see us and
+ * will go on to finish. It can't be waiting for us in turn, since inserts only wait for ones
+ * farther out than themselves.
+ */
+static bool lost_race(const saeclib_concurrent_hash_table_t* cht,
+                      const void* key,
+                      uint32_t tag,
+                      size_t home,
+                      size_t mine)
+{
+    const size_t my_dist = (mine - home) & cht->mask;
+    size_t idx = home;
+    for (size_t probed = 0; probed < cht->capacity; probed++, idx = (idx + 1) & cht->mask) {
+        if (idx == mine)
+            continue;
+
+        int match = 0;
+        uint32_t w;
+        while (1) {
+            // a BUSY bucket's key isn't readable yet; wait until it is, since it might be ours.
+            w = load_settled(cht, idx);
+            if ((state_of(w) != STATE_PENDING) && (state_of(w) != STATE_FULL))
+                break;
+            if (tag_of(w) != tag)
+                break;
+            match = bucket_matches(cht, idx, w, key);
+            if (match == -1)
+                continue;
+
+            const bool farther = (((idx - home) & cht->mask) > my_dist);
+            if (match && (state_of(w) == STATE_PENDING) && farther) {
+                while (load_ctrl(cht, idx) == w)
+                    spin_pause();
+                continue;
+            }
+            break;
+        }
+
+        if (state_of(w) == STATE_EMPTY)
+            return false;
+        if (((state_of(w) == STATE_PENDING) || (state_of(w) == STATE_FULL)) &&
+            (tag_of(w) == tag) && match)
+            return true;
+    }
+    return false;
+}
+
+
+saeclib_error_e saeclib_concurrent_hash_insert(saeclib_concurrent_hash_table_t* cht,
+                                               const void* key,
+                                               const void* value)
+{
+    const unsigned int hash = cht->hash_fn(key);
+    const uint32_t tag = tag_for_hash(hash);
+    const size_t home = home_idx(cht, hash);
+
+    while (1) {
+        // Find the first free bucket in the key's chain, checking all the way to the end of the
+        // chain that the key isn't already there. Buckets only go back to EMPTY in
+        // saeclib_concurrent_hash_purge, so nothing can be inserted past the first EMPTY bucket.
+        size_t free_idx = SIZE_MAX;
+        uint32_t free_word = 0;
+        size_t idx = home;
+        for (size_t probed = 0; probed < cht->capacity; probed++, idx = (idx + 1) & cht->mask) {
+            uint32_t w = load_ctrl(cht, idx);
+            if ((state_of(w) == STATE_EMPTY) || (state_of(w) == STATE_TOMB)) {
+                if (free_idx == SIZE_MAX) {
+                    free_idx = idx;
+                    free_word = w;
+                }
+                if (state_of(w) == STATE_EMPTY)
+                    break;
+            } else if ((state_of(w) == STATE_FULL) && (tag_of(w) == tag) &&
+                       (bucket_matches(cht, idx, w, key) == 1)) {
+                return SAECLIB_ERROR_DUPLICATE_KEY;
+            }
+        }
+        if (free_idx == SIZE_MAX)
+            return SAECLIB_ERROR_OVERFLOW;
+
+        // Claim it. If another thread got there first, start over: it may have been inserting the
+        // same key.
+        const uint32_t busy = next_word(free_word, STATE_BUSY, tag);
+        if (!__atomic_compare_exchange_n(&cht->ctrl[free_idx], &free_word, busy, false,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            continue;
+
+        memcpy(get_keyptr_at_idx(cht, free_idx), key, cht->key_elt_size);
+        const uint32_t pending = next_word(busy, STATE_PENDING, tag);
+        __atomic_store_n(&cht->ctrl[free_idx], pending, __ATOMIC_SEQ_CST);
+
+        if (lost_race(cht, key, tag, home, free_idx)) {
+            __atomic_store_n(&cht->ctrl[free_idx], next_word(pending, STATE_TOMB, 0),
+                             __ATOMIC_RELEASE);
+            return SAECLIB_ERROR_DUPLICATE_KEY;
+        }
+
+        memcpy(get_valptr_at_idx(cht, free_idx), value, cht->value_elt_size);
+        __atomic_store_n(&cht->ctrl[free_idx], next_word(pending, STATE_FULL, tag),
+                         __ATOMIC_RELEASE);
+        return SAECLIB_ERROR_NOERROR;
+    }
+}
+
+
+saeclib_error_e saeclib_concurrent_hash_search(const saeclib_concurrent_hash_table_t* cht,
+                                               const void* key,
+                                               void* out)
+{
+    const unsigned int hash = cht->hash_fn(key);
+    const uint32_t tag = tag_for_hash(hash);
+    size_t idx = home_idx(cht, hash);
+    for (size_t probed = 0; probed < cht->capacity; ) {
+        uint32_t w = __atomic_load_n(&cht->ctrl[idx], __ATOMIC_ACQUIRE);
+        if (state_of(w) == STATE_EMPTY)
+            return SAECLIB_ERROR_UNDERFLOW;
+
+        if ((state_of(w) == STATE_FULL) && (tag_of(w) == tag)) {
+            int match = !cht->cmp(key, get_keyptr_at_idx(cht, idx));
+            if (match)
+                memcpy(out, get_valptr_at_idx(cht, idx), cht->value_elt_size);
+            if (!unchanged(cht, idx, w))
+                continue;
+            if (match)
+                return SAECLIB_ERROR_NOERROR;
+        }
+
+        probed++;
+        idx = (idx + 1) & cht->mask;
+    }
+    return SAECLIB_ERROR_UNDERFLOW;
+}
+
+
+saeclib_error_e saeclib_concurrent_hash_delete(saeclib_concurrent_hash_table_t* cht,
+                                               const void* key)
+{
+    const unsigned int hash = cht->hash_fn(key);
+    const uint32_t tag = tag_for_hash(hash);
+    size_t idx = home_idx(cht, hash);
+    for (size_t probed = 0; probed < cht->capacity; ) {
+        uint32_t w = load_ctrl(cht, idx);
+        if (state_of(w) == STATE_EMPTY)
+            return SAECLIB_ERROR_UNDERFLOW;
+
+        if ((state_of(w) == STATE_FULL) && (tag_of(w) == tag)) {
+            int match = bucket_matches(cht, idx, w, key);
+            if (match == -1)
+                continue;
+            if (match) {
+                // if this fails, the key was deleted (or the bucket reused) by someone else in the
+                // meantime; look at the bucket again.
+                if (__atomic_compare_exchange_n(&cht->ctrl[idx], &w,
+                                                next_word(w, STATE_TOMB, 0), false,
+                                                __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+                    return SAECLIB_ERROR_NOERROR;
+                continue;
+            }
+        }
+
+        probed++;
+        idx = (idx + 1) & cht->mask;
+    }
+    return SAECLIB_ERROR_UNDERFLOW;
+}
+
+
+/**
+ * Swaps n bytes at a and b.
+ */
+static void swap_bytes(uint8_t* a, uint8_t* b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint8_t t = a[i];
+        a[i] = b[i];
+        b[i] = t;
+    }
+}
+
+
+saeclib_error_e saeclib_concurrent_hash_purge(saeclib_concurrent_hash_table_t* cht)
+{
+    // Tombstones become EMPTY, and every key is marked as not yet placed. PENDING can't otherwise
+    // be seen while nothing else is using the table, so it's borrowed for that.
+    for (size_t i = 0; i < cht->capacity; i++) {
+        const uint32_t w = cht->ctrl[i];
+        if (state_of(w) == STATE_TOMB)
+            cht->ctrl[i] = next_word(w, STATE_EMPTY, 0);
+        else if (state_of(w) == STATE_FULL)
+            cht->ctrl[i] = next_word(w, STATE_PENDING, tag_of(w));
+    }
+
+    // Each key goes into the first bucket in its chain that isn't FULL. If that's another key that
+    // hasn't been placed yet, the two swap and the other one is placed next. FULL buckets are never
+    // touched again, so every placed key stays reachable from its home bucket.
+    size_t i = 0;
+    while (i < cht->capacity) {
+        const uint32_t w = cht->ctrl[i];
+        if (state_of(w) != STATE_PENDING) {
+            i++;
+            continue;
+        }
+
+        size_t idx = home_idx(cht, cht->hash_fn(get_keyptr_at_idx(cht, i)));
+        while (state_of(cht->ctrl[idx]) == STATE_FULL)
+            idx = (idx + 1) & cht->mask;
+
+        const uint32_t t = cht->ctrl[idx];
+        if (idx == i) {
+            cht->ctrl[i] = next_word(w, STATE_FULL, tag_of(w));
+            i++;
+        } else if (state_of(t) == STATE_EMPTY) {
+            memcpy(get_keyptr_at_idx(cht, idx), get_keyptr_at_idx(cht, i), cht->key_elt_size);
+            memcpy(get_valptr_at_idx(cht, idx), get_valptr_at_idx(cht, i), cht->value_elt_size);
+            cht->ctrl[idx] = next_word(t, STATE_FULL, tag_of(w));
+            cht->ctrl[i] = next_word(w, STATE_EMPTY, 0);
+            i++;
+        } else {
+            swap_bytes(get_keyptr_at_idx(cht, idx), get_keyptr_at_idx(cht, i), cht->key_elt_size);
+            swap_bytes(get_valptr_at_idx(cht, idx), get_valptr_at_idx(cht, i),
+                       cht->value_elt_size);
+            cht->ctrl[idx] = next_word(t, STATE_FULL, tag_of(w));
+            cht->ctrl[i] = next_word(w, STATE_PENDING, tag_of(t));
+        }
+    }
+
+    return SAECLIB_ERROR_NOERROR;
+}
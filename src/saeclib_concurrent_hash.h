@@ -0,0 +1,129 @@
+#ifndef _SAECLIB_CONCURRENT_HASH_H
+#define _SAECLIB_CONCURRENT_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "saeclib_error.h"
+#include "saeclib_hash.h"
+
+/**
+ * A fixed-capacity hash table that any number of threads can insert into, search, and delete from
+ * at the same time, without a global lock.
+ *
+ * Like saeclib_hash_table_t, it uses open addressing with linear probing over statically allocated
+ * memory, but each bucket has a 32-bit control word instead of a control byte. The word holds the
+ * bucket's state, 7 bits of its key's hash, and a version number that goes up every time the state
+ * changes. Threads take ownership of a bucket by changing its word with a compare-and-swap:
+ *
+ *     EMPTY --> BUSY --> PENDING --> FULL --> TOMB --> BUSY --> ...
+ *
+ * BUSY means a thread is writing a key into the bucket; PENDING means the key is there, and the
+ * thread is checking that nobody else inserted the same key at the same time. Deleted buckets
+ * become tombstones rather than going back to EMPTY, so that searches that started before the
+ * delete still find their way past them; inserts reuse them for any key.
+ *
+ * Tombstones are only turned back into EMPTY buckets by saeclib_concurrent_hash_purge. Until then,
+ * every bucket that has ever held a key stays part of a chain, so a table with a lot of inserts and
+ * deletes over its life ends up with no EMPTY buckets at all, and every miss and every insert has
+ * to look at every bucket. Tables like that need purging now and then, whenever the threads using
+ * them can be paused.
+ *
+ * Searches don't write anything; they check the bucket's version before and after reading it and
+ * try again if it changed. As with saeclib_hash_search_optimistic, that means hash_fn and cmp can
+ * be called on a key that's in the middle of being written, and must cope with it.
+ *
+ * A thread that inserts into a BUSY bucket's chain waits for it to become PENDING, which only takes
+ * as long as copying a key, unless the inserting thread is descheduled right then.
+ */
+
+typedef struct saeclib_concurrent_hash_table
+{
+    uint8_t* key_data;
+    uint8_t* value_data;
+
+    // one control word per bucket; see saeclib_concurrent_hash.c for the layout. Zeroed memory is
+    // an empty table.
+    uint32_t* ctrl;
+
+    // capacity is a power of two.
+    size_t capacity;
+    size_t mask;
+
+    size_t key_elt_size;
+    size_t value_elt_size;
+
+    unsigned int (*hash_fn)(const void*);
+    int (*cmp)(const void*, const void*);
+} saeclib_concurrent_hash_table_t;
+
+/**
+ * Initializes an empty concurrent hash table. The arguments are the same as for
+ * saeclib_hash_table_init, except that ctrlspace has one uint32_t per bucket, zeroed.
+ *
+ * @return SAECLIB_ERROR_BAD_STRUCTURE if keyspace_size / key_size isn't a power of two of at least
+ *         2.
+ */
+saeclib_error_e saeclib_concurrent_hash_table_init(saeclib_concurrent_hash_table_t* cht,
+                                                   void* keyspace,
+                                                   void* valuespace,
+                                                   uint32_t* ctrlspace,
+                                                   size_t keyspace_size,
+                                                   size_t key_size,
+                                                   size_t value_size,
+                                                   unsigned int (*hash_fn)(const void*),
+                                                   int (*cmp)(const void*, const void*));
+
+/**
+ * Statically allocates a concurrent hash table with at least capacity buckets, rounded up to a
+ * power of two. The same cautions as for saeclib_hash_table_salloc apply.
+ */
+#define saeclib_concurrent_hash_table_salloc(capacity, keysize, valuesize, hash_fn, cmp)          \
+    ({                                                                                            \
+    saeclib_concurrent_hash_table_t cht;                                                          \
+    static uint8_t keyspace[SAECLIB_NEXT_POW2(capacity) * (keysize)] = { 0 };                     \
+    static uint8_t valuespace[SAECLIB_NEXT_POW2(capacity) * (valuesize)] = { 0 };                 \
+    static uint32_t ctrlspace[SAECLIB_NEXT_POW2(capacity)] = { 0 };                               \
+    saeclib_concurrent_hash_table_init(&cht, keyspace, valuespace, ctrlspace, sizeof(keyspace),   \
+                                       keysize, valuesize, hash_fn, cmp);                         \
+    cht;                                                                                          \
+    })
+
+/**
+ * Inserts a new key-value pair. If several threads insert the same key at once, exactly one of them
+ * succeeds.
+ *
+ * @return SAECLIB_ERROR_DUPLICATE_KEY if the key is already there.
+ *         SAECLIB_ERROR_OVERFLOW if there's no EMPTY or TOMB bucket left in the key's chain.
+ *         SAECLIB_ERROR_NOERROR otherwise.
+ */
+saeclib_error_e saeclib_concurrent_hash_insert(saeclib_concurrent_hash_table_t* cht,
+                                               const void* key,
+                                               const void* value);
+
+/**
+ * Copies the value for a key into out.
+ *
+ * @return SAECLIB_ERROR_UNDERFLOW if the key isn't there. out may have been written to anyway.
+ */
+saeclib_error_e saeclib_concurrent_hash_search(const saeclib_concurrent_hash_table_t* cht,
+                                               const void* key,
+                                               void* out);
+
+/**
+ * Removes a key. If several threads delete the same key at once, exactly one of them succeeds.
+ *
+ * @return SAECLIB_ERROR_UNDERFLOW if the key isn't there.
+ */
+saeclib_error_e saeclib_concurrent_hash_delete(saeclib_concurrent_hash_table_t* cht,
+                                               const void* key);
+
+/**
+ * Turns every tombstone back into an EMPTY bucket, moving keys as needed so that they can all still
+ * be found. It hashes every key in the table once.
+ *
+ * Unlike everything else here, this must not be called while any other thread is using the table.
+ */
+saeclib_error_e saeclib_concurrent_hash_purge(saeclib_concurrent_hash_table_t* cht);
+
+#endif
@@ -0,0 +1,139 @@
+#include "saeclib_copy.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/**
+ * memcpy with a constant size is turned into plain (unaligned-safe) loads and stores by the
+ * compiler, which is exactly what we want for the fixed sizes.
+ */
+static void copy_1(void* dst, const void* src, size_t n)
+{
+    *(uint8_t*)dst = *(const uint8_t*)src;
+}
+
+static void copy_2(void* dst, const void* src, size_t n)
+{
+    memcpy(dst, src, 2);
+}
+
+static void copy_4(void* dst, const void* src, size_t n)
+{
+    memcpy(dst, src, 4);
+}
+
+static void copy_8(void* dst, const void* src, size_t n)
+{
+    memcpy(dst, src, 8);
+}
+
+static void copy_16(void* dst, const void* src, size_t n)
+{
+    memcpy(dst, src, 16);
+}
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+/**
+ * n must be a multiple of 16. Elements aren't guaranteed to be 16-byte aligned (elt_size might
+ * not be a multiple of the alignment of the container's memory), so unaligned moves are used;
+ * on the cores we care about they're just as fast as aligned ones when the data happens to be
+ * aligned.
+ */
+static void copy_16n(void* dst, const void* src, size_t n)
+{
+    uint8_t* d = dst;
+    const uint8_t* s = src;
+    for (size_t i = 0; i < n; i += 16) {
+#if defined(__SSE2__)
+        _mm_storeu_si128((__m128i*)(d + i), _mm_loadu_si128((const __m128i*)(s + i)));
+#else
+        vst1q_u8(d + i, vld1q_u8(s + i));
+#endif
+    }
+}
+#endif
+
+static void copy_any(void* dst, const void* src, size_t n)
+{
+    memcpy(dst, src, n);
+}
+
+
+saeclib_copy_fn_t saeclib_copy_select(size_t elt_size)
+{
+    switch (elt_size) {
+        case 1:  return copy_1;
+        case 2:  return copy_2;
+        case 4:  return copy_4;
+        case 8:  return copy_8;
+        case 16: return copy_16;
+        default: break;
+    }
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+    if (((elt_size % 16) == 0) && (elt_size <= 256)) {
+        return copy_16n;
+    }
+#endif
+
+    return copy_any;
+}
+
+
+void saeclib_copy_stream_to(void* dst, const void* src, size_t n)
+{
+#if defined(__SSE2__)
+    uint8_t* d = dst;
+    const uint8_t* s = src;
+
+    // non-temporal stores need a 16-byte aligned destination; get there with an ordinary copy.
+    size_t head = (16 - ((uintptr_t)d & 15)) & 15;
+    if (head > n) head = n;
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+
+    for (; n >= 64; n -= 64, d += 64, s += 64) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(s + 0));
+        __m128i b = _mm_loadu_si128((const __m128i*)(s + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)(s + 32));
+        __m128i e = _mm_loadu_si128((const __m128i*)(s + 48));
+        _mm_stream_si128((__m128i*)(d + 0), a);
+        _mm_stream_si128((__m128i*)(d + 16), b);
+        _mm_stream_si128((__m128i*)(d + 32), c);
+        _mm_stream_si128((__m128i*)(d + 48), e);
+    }
+    for (; n >= 16; n -= 16, d += 16, s += 16) {
+        _mm_stream_si128((__m128i*)d, _mm_loadu_si128((const __m128i*)s));
+    }
+    memcpy(d, s, n);
+
+    _mm_sfence();
+#else
+    memcpy(dst, src, n);
+#endif
+}
+
+
+void saeclib_copy_stream_from(void* dst, const void* src, size_t n)
+{
+    // how far ahead of the copy to prefetch; a few cache lines is enough to cover memory latency.
+    const size_t PREFETCH_DISTANCE = 512;
+
+    uint8_t* d = dst;
+    const uint8_t* s = src;
+    for (; n >= 256; n -= 256, d += 256, s += 256) {
+        for (size_t i = 0; i < 256; i += 64) {
+            __builtin_prefetch(s + PREFETCH_DISTANCE + i, 0, 0);
+        }
+        memcpy(d, s, 256);
+    }
+    memcpy(d, s, n);
+}
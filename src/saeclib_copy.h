@@ -0,0 +1,43 @@
+#ifndef _SAECLIB_COPY_H
+#define _SAECLIB_COPY_H
+
+#include <stddef.h>
+
+/**
+ * Containers that hold elements of a size that's only known at runtime would normally copy them
+ * with memcpy(dst, src, elt_size). For the small element sizes that are most common, that call
+ * costs more than the copy does. Instead, containers pick one of these routines when they're
+ * initialized and call through it from then on.
+ *
+ * Every routine has the same signature as memcpy (minus the return value) so that the generic
+ * fallback can just be memcpy; the fixed-size routines ignore n.
+ */
+typedef void (*saeclib_copy_fn_t)(void* dst, const void* src, size_t n);
+
+/**
+ * Returns the copy routine that's fastest for elements of size elt_size.
+ *
+ * Sizes of 1, 2, 4, 8 and 16 bytes get a routine that's a single load and store. Multiples of 16
+ * bytes up to 256 bytes get a routine made out of 16-byte SIMD moves when SSE2 or NEON is
+ * available. Everything else goes to memcpy.
+ */
+saeclib_copy_fn_t saeclib_copy_select(size_t elt_size);
+
+/**
+ * Copies n bytes into memory that isn't going to be read again for a long time, using
+ * non-temporal stores so that the destination doesn't push everything else out of the cache.
+ * The stores are fenced before this returns, so publishing the data afterwards (for instance by
+ * moving a circular buffer's head) is safe.
+ *
+ * Falls back on memcpy on targets without SSE2.
+ */
+void saeclib_copy_stream_to(void* dst, const void* src, size_t n);
+
+/**
+ * Copies n bytes out of memory that was written a long time ago and won't be read again,
+ * prefetching the source ahead of the copy with a non-temporal hint so that it displaces as little
+ * of the cache as possible.
+ */
+void saeclib_copy_stream_from(void* dst, const void* src, size_t n);
+
+#endif
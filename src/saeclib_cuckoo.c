@@ -0,0 +1,341 @@
+#include "saeclib_cuckoo.h"
+
+#include <string.h>
+
+#include "saeclib_hash_functions.h"
+
+// How many buckets an insert's breadth-first search for room may visit, counting both of the new
+// key's buckets. That covers every chain of up to three moves, and many of four.
+#define BFS_MAX_NODES 256
+
+// How long a chain of moves can get; deeper buckets aren't searched.
+#define BFS_MAX_DEPTH 4
+
+
+static inline uint8_t* bucket_ptr(const saeclib_cuckoo_table_t* cht, size_t b)
+{
+    return cht->buckets + (b * cht->bucket_size);
+}
+
+static inline uint8_t* get_keyptr(const saeclib_cuckoo_table_t* cht, size_t b, int s)
+{
+    return bucket_ptr(cht, b) + cht->key_offset + (s * cht->key_elt_size);
+}
+
+static inline uint8_t* get_valptr(const saeclib_cuckoo_table_t* cht, size_t b, int s)
+{
+    return bucket_ptr(cht, b) + cht->value_offset + (s * cht->value_elt_size);
+}
+
+static inline size_t stash_bucket(const saeclib_cuckoo_table_t* cht)
+{
+    return cht->nbuckets;
+}
+
+/**
+ * The user's hash, mixed so that its low bits pick the first bucket and its top byte is the tag.
+ */
+static inline uint64_t key_mix(const saeclib_cuckoo_table_t* cht, const void* key)
+{
+    return saeclib_hash_mix64(cht->hash_fn(key));
+}
+
+static inline uint8_t tag_for(uint64_t m)
+{
+    uint8_t tag = m >> 56;
+    return (tag != 0) ? tag : 1;
+}
+
+/**
+ * A key's other bucket, from either one of its buckets and its tag. XORing makes this work both
+ * ways round.
+ */
+static inline size_t alt_bucket(const saeclib_cuckoo_table_t* cht, size_t b, uint8_t tag)
+{
+    return (b ^ (tag * 0x5bd1e995u)) & cht->mask;
+}
+
+/**
+ * Index of an empty slot in bucket b, or -1.
+ */
+static inline int free_slot(const saeclib_cuckoo_table_t* cht, size_t b)
+{
+    const uint8_t* tags = bucket_ptr(cht, b);
+    for (int s = 0; s < SAECLIB_CUCKOO_SLOTS; s++) {
+        if (tags[s] == 0)
+            return s;
+    }
+    return -1;
+}
+
+/**
+ * Slot holding key in bucket b, or -1.
+ */
+static inline int find_in_bucket(const saeclib_cuckoo_table_t* cht, size_t b, const void* key,
+                                 uint8_t tag)
+{
+    const uint8_t* tags = bucket_ptr(cht, b);
+    for (int s = 0; s < SAECLIB_CUCKOO_SLOTS; s++) {
+        if ((tags[s] == tag) && !cht->cmp(key, get_keyptr(cht, b, s)))
+            return s;
+    }
+    return -1;
+}
+
+/**
+ * Looks for key in its two buckets and the stash. Returns true and sets *bucket and *slot if it's
+ * found.
+ */
+static bool find(const saeclib_cuckoo_table_t* cht, const void* key, uint64_t m,
+                 size_t* bucket, int* slot)
+{
+    const uint8_t tag = tag_for(m);
+    const size_t b1 = m & cht->mask;
+    const size_t b2 = alt_bucket(cht, b1, tag);
+
+    if ((*slot = find_in_bucket(cht, b1, key, tag)) != -1) {
+        *bucket = b1;
+        return true;
+    }
+    if ((*slot = find_in_bucket(cht, b2, key, tag)) != -1) {
+        *bucket = b2;
+        return true;
+    }
+    if ((cht->stash_count > 0) &&
+        ((*slot = find_in_bucket(cht, stash_bucket(cht), key, tag)) != -1)) {
+        *bucket = stash_bucket(cht);
+        return true;
+    }
+    return false;
+}
+
+static void move_slot(saeclib_cuckoo_table_t* cht, size_t db, int ds, size_t sb, int ss)
+{
+    bucket_ptr(cht, db)[ds] = bucket_ptr(cht, sb)[ss];
+    memcpy(get_keyptr(cht, db, ds), get_keyptr(cht, sb, ss), cht->key_elt_size);
+    memcpy(get_valptr(cht, db, ds), get_valptr(cht, sb, ss), cht->value_elt_size);
+    bucket_ptr(cht, sb)[ss] = 0;
+}
+
+
+typedef struct bfs_node
+{
+    size_t bucket;
+
+    // node for the bucket whose key would move into this one, and which slot that key is in.
+    int16_t parent;
+    int8_t slot;
+    int8_t depth;
+} bfs_node_t;
+
+/**
+ * true if bucket b is node n's bucket or any of its ancestors'. A chain of moves mustn't go
+ * through the same bucket twice, or a later move could pick up a key that an earlier one put there.
+ */
+static bool on_path(const bfs_node_t* nodes, int n, size_t b)
+{
+    for (; n != -1; n = nodes[n].parent) {
+        if (nodes[n].bucket == b)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Makes room in bucket b1 or b2, both full, by moving keys to their other buckets. Looks for the
+ * shortest chain of moves that ends in a bucket with an empty slot before moving anything, so
+ * nothing changes if there isn't one.
+ *
+ * @return true, with *bucket and *slot set to the freed slot, if room was made.
+ */
+static bool make_room(saeclib_cuckoo_table_t* cht, size_t b1, size_t b2, size_t* bucket, int* slot)
+{
+    bfs_node_t nodes[BFS_MAX_NODES];
+    int tail = 0;
+    nodes[tail++] = (bfs_node_t){ b1, -1, -1, 0 };
+    if (b2 != b1)
+        nodes[tail++] = (bfs_node_t){ b2, -1, -1, 0 };
+
+    for (int head = 0; head < tail; head++) {
+        const size_t b = nodes[head].bucket;
+        int s = free_slot(cht, b);
+        if (s != -1) {
+            // Move keys down the chain, starting from the end so that each one moves into the slot
+            // that the previous move emptied.
+            for (int n = head; nodes[n].parent != -1; n = nodes[n].parent) {
+                const size_t pb = nodes[nodes[n].parent].bucket;
+                move_slot(cht, nodes[n].bucket, s, pb, nodes[n].slot);
+                s = nodes[n].slot;
+            }
+            int n = head;
+            while (nodes[n].parent != -1) n = nodes[n].parent;
+            *bucket = nodes[n].bucket;
+            *slot = s;
+            return true;
+        }
+
+        if (nodes[head].depth == BFS_MAX_DEPTH)
+            continue;
+
+        const uint8_t* tags = bucket_ptr(cht, b);
+        for (int i = 0; (i < SAECLIB_CUCKOO_SLOTS) && (tail < BFS_MAX_NODES); i++) {
+            const size_t alt = alt_bucket(cht, b, tags[i]);
+            if (!on_path(nodes, head, alt))
+                nodes[tail++] = (bfs_node_t){ alt, head, i, nodes[head].depth + 1 };
+        }
+    }
+
+    return false;
+}
+
+
+saeclib_error_e saeclib_cuckoo_table_init(saeclib_cuckoo_table_t* cht,
+                                          void* bucketspace,
+                                          size_t bucketspace_size,
+                                          size_t key_size,
+                                          size_t value_size,
+                                          unsigned int (*hash_fn)(const void*),
+                                          int (*cmp)(const void*, const void*))
+{
+    const size_t bucket_size = SAECLIB_CUCKOO_BUCKET_SIZE(key_size, value_size);
+    const size_t total = bucketspace_size / bucket_size;
+    if ((total < 2) || (((total - 1) & (total - 2)) != 0))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    cht->buckets = bucketspace;
+    cht->nbuckets = total - 1;
+    cht->mask = cht->nbuckets - 1;
+    cht->bucket_size = bucket_size;
+    cht->key_offset = SAECLIB_CUCKOO_KEY_OFFSET(key_size);
+    cht->value_offset = SAECLIB_CUCKOO_VALUE_OFFSET(key_size, value_size);
+    cht->key_elt_size = key_size;
+    cht->value_elt_size = value_size;
+    cht->size = 0;
+    cht->stash_count = 0;
+    cht->hash_fn = hash_fn;
+    cht->cmp = cmp;
+
+    for (size_t b = 0; b < total; b++) {
+        memset(bucket_ptr(cht, b), 0, SAECLIB_CUCKOO_SLOTS);
+    }
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_cuckoo_insert(saeclib_cuckoo_table_t* cht,
+                                      const void* key,
+                                      const void* value)
+{
+    const uint64_t m = key_mix(cht, key);
+    size_t b;
+    int s;
+    if (find(cht, key, m, &b, &s))
+        return SAECLIB_ERROR_DUPLICATE_KEY;
+
+    const uint8_t tag = tag_for(m);
+    const size_t b1 = m & cht->mask;
+    const size_t b2 = alt_bucket(cht, b1, tag);
+    if ((s = free_slot(cht, b1)) != -1) {
+        b = b1;
+    } else if ((s = free_slot(cht, b2)) != -1) {
+        b = b2;
+    } else if (make_room(cht, b1, b2, &b, &s)) {
+        // b and s set by make_room
+    } else if ((s = free_slot(cht, stash_bucket(cht))) != -1) {
+        b = stash_bucket(cht);
+        cht->stash_count++;
+    } else {
+        return SAECLIB_ERROR_OVERFLOW;
+    }
+
+    bucket_ptr(cht, b)[s] = tag;
+    memcpy(get_keyptr(cht, b, s), key, cht->key_elt_size);
+    // sets have no values, and callers are allowed to pass NULL for them.
+    if (cht->value_elt_size != 0) {
+        memcpy(get_valptr(cht, b, s), value, cht->value_elt_size);
+    }
+    cht->size++;
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_cuckoo_search(const saeclib_cuckoo_table_t* cht,
+                                      const void* key,
+                                      void* out)
+{
+    size_t b;
+    int s;
+    if (!find(cht, key, key_mix(cht, key), &b, &s))
+        return SAECLIB_ERROR_UNDERFLOW;
+
+    if (cht->value_elt_size != 0) {
+        memcpy(out, get_valptr(cht, b, s), cht->value_elt_size);
+    }
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_cuckoo_search_ref(saeclib_cuckoo_table_t* cht,
+                                          const void* key,
+                                          void** out)
+{
+    size_t b;
+    int s;
+    if (!find(cht, key, key_mix(cht, key), &b, &s))
+        return SAECLIB_ERROR_UNDERFLOW;
+
+    *out = get_valptr(cht, b, s);
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+/**
+ * Moves keys out of the stash into their own buckets wherever there's room for them.
+ */
+static void drain_stash(saeclib_cuckoo_table_t* cht)
+{
+    const size_t sb = stash_bucket(cht);
+    const uint8_t* tags = bucket_ptr(cht, sb);
+    for (int ss = 0; (ss < SAECLIB_CUCKOO_SLOTS) && (cht->stash_count > 0); ss++) {
+        if (tags[ss] == 0)
+            continue;
+
+        const size_t b1 = key_mix(cht, get_keyptr(cht, sb, ss)) & cht->mask;
+        const size_t b2 = alt_bucket(cht, b1, tags[ss]);
+        int s;
+        if ((s = free_slot(cht, b1)) != -1) {
+            move_slot(cht, b1, s, sb, ss);
+            cht->stash_count--;
+        } else if ((s = free_slot(cht, b2)) != -1) {
+            move_slot(cht, b2, s, sb, ss);
+            cht->stash_count--;
+        }
+    }
+}
+
+
+saeclib_error_e saeclib_cuckoo_delete(saeclib_cuckoo_table_t* cht, const void* key)
+{
+    size_t b;
+    int s;
+    if (!find(cht, key, key_mix(cht, key), &b, &s))
+        return SAECLIB_ERROR_UNDERFLOW;
+
+    bucket_ptr(cht, b)[s] = 0;
+    cht->size--;
+    if (b == stash_bucket(cht)) {
+        cht->stash_count--;
+    } else if (cht->stash_count > 0) {
+        drain_stash(cht);
+    }
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+size_t saeclib_cuckoo_size(const saeclib_cuckoo_table_t* cht)
+{
+    return cht->size;
+}
@@ -0,0 +1,156 @@
+#ifndef _SAECLIB_CUCKOO_H
+#define _SAECLIB_CUCKOO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "saeclib_error.h"
+#include "saeclib_hash.h"
+
+/**
+ * A cuckoo hash table: every key lives in one of two candidate buckets of SAECLIB_CUCKOO_SLOTS
+ * slots, so a search looks at two buckets at most, however full the table is. (Plus the stash,
+ * below, when it isn't empty.)
+ *
+ * Each bucket keeps a one-byte tag from the hash of each of its keys, then the keys, then the
+ * values, all together, so a bucket with small keys and values is one or two cache lines. A
+ * search only calls cmp on slots whose tag matches. A key's second bucket is worked out from its
+ * first bucket and its tag alone, so keys can be moved to their other bucket without being
+ * hashed again.
+ *
+ * When both of a new key's buckets are full, the insert does a bounded breadth-first search for a
+ * short chain of keys to move to their other buckets to make room, and only moves anything once
+ * it's found one. If there's none, the key goes in the stash, a spare bucket that every search
+ * checks while it's not empty. Deletes move keys out of the stash when room opens up for them.
+ * Tables fill to about 95% before inserts start to fail.
+ */
+
+#define SAECLIB_CUCKOO_SLOTS 4
+
+// Layout of one bucket: SAECLIB_CUCKOO_SLOTS tag bytes (0 for an empty slot), then the keys, then
+// the values, each aligned as far as their size allows.
+#define SAECLIB_CUCKOO_ALIGN_FOR(off, size)                                                       \
+    ((((size) % 8) == 0) ? (((off) + 7) & ~(size_t)7) :                                           \
+     (((size) % 4) == 0) ? (((off) + 3) & ~(size_t)3) : (off))
+#define SAECLIB_CUCKOO_KEY_OFFSET(keysize) SAECLIB_CUCKOO_ALIGN_FOR(SAECLIB_CUCKOO_SLOTS, keysize)
+#define SAECLIB_CUCKOO_VALUE_OFFSET(keysize, valuesize)                                           \
+    SAECLIB_CUCKOO_ALIGN_FOR(SAECLIB_CUCKOO_KEY_OFFSET(keysize) +                                 \
+                             (SAECLIB_CUCKOO_SLOTS * (keysize)), valuesize)
+
+/**
+ * Bytes per bucket for the given key and value sizes.
+ */
+#define SAECLIB_CUCKOO_BUCKET_SIZE(keysize, valuesize)                                            \
+    ((SAECLIB_CUCKOO_VALUE_OFFSET(keysize, valuesize) + (SAECLIB_CUCKOO_SLOTS * (valuesize)) +    \
+      7) & ~(size_t)7)
+
+/**
+ * Number of buckets, not counting the stash, needed for capacity keys at most; a power of two.
+ */
+#define SAECLIB_CUCKOO_NBUCKETS(capacity) \
+    SAECLIB_NEXT_POW2(((capacity) + SAECLIB_CUCKOO_SLOTS - 1) / SAECLIB_CUCKOO_SLOTS)
+
+typedef struct saeclib_cuckoo_table
+{
+    // nbuckets buckets, followed by one more for the stash.
+    uint8_t* buckets;
+    size_t nbuckets;
+    size_t mask;
+
+    size_t bucket_size;
+    size_t key_offset;
+    size_t value_offset;
+
+    size_t key_elt_size;
+    size_t value_elt_size;
+
+    // keys in the whole table, and in the stash.
+    size_t size;
+    size_t stash_count;
+
+    unsigned int (*hash_fn)(const void*);
+    int (*cmp)(const void*, const void*);
+} saeclib_cuckoo_table_t;
+
+/**
+ * Initializes an empty cuckoo hash table.
+ *
+ * @param[in,out] cht       Cuckoo table to initialize.
+ * @param[in]     bucketspace Memory for the buckets: (nbuckets + 1) * SAECLIB_CUCKOO_BUCKET_SIZE
+ *                            bytes, where nbuckets is a power of two. Aligning it to 64 bytes
+ *                            keeps buckets from straddling cache lines more than they have to.
+ * @param[in]     bucketspace_size  Size of bucketspace in bytes.
+ * @param[in]     key_size  Size in bytes of each key.
+ * @param[in]     value_size  Size in bytes of each value; 0 for a set.
+ * @param[in]     hash_fn   Hash function for keys. It's mixed before use, so weak hashes are fine.
+ * @param[in]     cmp       Compare function for keys, returning 0 if they're equal.
+ *
+ * @return SAECLIB_ERROR_BAD_STRUCTURE if bucketspace doesn't hold a power of two plus one buckets.
+ */
+saeclib_error_e saeclib_cuckoo_table_init(saeclib_cuckoo_table_t* cht,
+                                          void* bucketspace,
+                                          size_t bucketspace_size,
+                                          size_t key_size,
+                                          size_t value_size,
+                                          unsigned int (*hash_fn)(const void*),
+                                          int (*cmp)(const void*, const void*));
+
+/**
+ * Statically allocates a cuckoo table with room for at least capacity keys. The same cautions as
+ * for saeclib_hash_table_salloc apply.
+ */
+#define saeclib_cuckoo_table_salloc(capacity, keysize, valuesize, hash_fn, cmp)                   \
+    ({                                                                                            \
+    saeclib_cuckoo_table_t cht;                                                                   \
+    static uint8_t bucketspace[(SAECLIB_CUCKOO_NBUCKETS(capacity) + 1) *                          \
+                               SAECLIB_CUCKOO_BUCKET_SIZE(keysize, valuesize)]                    \
+        __attribute__((aligned(64))) = { 0 };                                                     \
+    saeclib_cuckoo_table_init(&cht, bucketspace, sizeof(bucketspace), keysize, valuesize,         \
+                              hash_fn, cmp);                                                      \
+    cht;                                                                                          \
+    })
+
+/**
+ * Inserts a new key-value pair. For a set (value_size 0), value may be NULL.
+ *
+ * @return SAECLIB_ERROR_DUPLICATE_KEY if the key is already there.
+ *         SAECLIB_ERROR_OVERFLOW if no room could be made for it and the stash is full. The table
+ *         is unchanged.
+ */
+saeclib_error_e saeclib_cuckoo_insert(saeclib_cuckoo_table_t* cht,
+                                      const void* key,
+                                      const void* value);
+
+/**
+ * Copies the value for a key into out. For a set (value_size 0), out may be NULL, and this just
+ * says whether the key is there.
+ *
+ * @return SAECLIB_ERROR_UNDERFLOW if the key isn't there.
+ */
+saeclib_error_e saeclib_cuckoo_search(const saeclib_cuckoo_table_t* cht,
+                                      const void* key,
+                                      void* out);
+
+/**
+ * Same as saeclib_cuckoo_search, but returns a pointer to the value, meaning that it can be
+ * modified. Inserts can move values around, so the pointer is only good until the next insert or
+ * delete.
+ */
+saeclib_error_e saeclib_cuckoo_search_ref(saeclib_cuckoo_table_t* cht,
+                                          const void* key,
+                                          void** out);
+
+/**
+ * Removes a key.
+ *
+ * @return SAECLIB_ERROR_UNDERFLOW if the key isn't there.
+ */
+saeclib_error_e saeclib_cuckoo_delete(saeclib_cuckoo_table_t* cht, const void* key);
+
+/**
+ * Number of keys in the table.
+ */
+size_t saeclib_cuckoo_size(const saeclib_cuckoo_table_t* cht);
+
+#endif
@@ -17,6 +17,7 @@ typedef enum {
     SAECLIB_ERROR_DUPLICATE_KEY,
     SAECLIB_ERROR_UNKNOWN,
     SAECLIB_ERROR_UNIMPLEMENTED,
+    SAECLIB_ERROR_IO,
 } saeclib_error_e;
 
 #endif
@@ -0,0 +1,399 @@
+#include "saeclib_file_ingest.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define SAECLIB_HAVE_IO_URING 1
+#endif
+#endif
+
+/**
+ * Reads are handed out in file order, each one taking the next piece of the circular buffer's free
+ * space after the reads that are already in flight. Because they can complete in any order, a
+ * completed read's bytes aren't committed until every read before it has been committed too.
+ *
+ * io_uring is driven through raw system calls rather than liburing, so that there are no extra
+ * libraries to link against.
+ */
+
+
+#if defined(SAECLIB_HAVE_IO_URING)
+static int uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    int ret;
+    do {
+        ret = syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
+    } while ((ret < 0) && (errno == EINTR));
+    return ret;
+}
+
+
+static void uring_teardown(saeclib_file_ingest_t* ing)
+{
+    if (ing->sqes != NULL) munmap(ing->sqes, ing->sqes_size);
+    if ((ing->cq_map != NULL) && (ing->cq_map != ing->sq_map)) munmap(ing->cq_map, ing->cq_map_size);
+    if (ing->sq_map != NULL) munmap(ing->sq_map, ing->sq_map_size);
+    close(ing->ring_fd);
+
+    ing->sqes = ing->cq_map = ing->sq_map = NULL;
+    ing->ring_fd = -1;
+}
+
+
+/**
+ * Returns false if io_uring isn't available, in which case ing->ring_fd is left at -1.
+ */
+static bool uring_setup(saeclib_file_ingest_t* ing)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int ring_fd = syscall(__NR_io_uring_setup, ing->depth, &params);
+    if (ring_fd < 0) {
+        return false;
+    }
+    ing->ring_fd = ring_fd;
+
+    ing->sq_map_size = params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+    ing->cq_map_size = params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+    ing->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    // newer kernels let both rings share one mapping.
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP);
+    if (single_mmap) {
+        if (ing->cq_map_size > ing->sq_map_size) {
+            ing->sq_map_size = ing->cq_map_size;
+        }
+        ing->cq_map_size = ing->sq_map_size;
+    }
+
+    void* sq_map = mmap(NULL, ing->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd, IORING_OFF_SQ_RING);
+    ing->sq_map = (sq_map == MAP_FAILED) ? NULL : sq_map;
+
+    void* cq_map = sq_map;
+    if (!single_mmap) {
+        cq_map = mmap(NULL, ing->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd, IORING_OFF_CQ_RING);
+    }
+    ing->cq_map = (cq_map == MAP_FAILED) ? NULL : cq_map;
+
+    void* sqes = mmap(NULL, ing->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd, IORING_OFF_SQES);
+    ing->sqes = (sqes == MAP_FAILED) ? NULL : sqes;
+
+    if ((ing->sq_map == NULL) || (ing->cq_map == NULL) || (ing->sqes == NULL)) {
+        uring_teardown(ing);
+        return false;
+    }
+
+    uint8_t* sq = ing->sq_map;
+    ing->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ing->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ing->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ing->sq_array = (unsigned*)(sq + params.sq_off.array);
+
+    uint8_t* cq = ing->cq_map;
+    ing->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ing->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ing->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ing->cqes = cq + params.cq_off.cqes;
+
+    return true;
+}
+
+
+static void uring_queue_read(saeclib_file_ingest_t* ing, uint32_t slot_idx)
+{
+    const saeclib_file_ingest_read_t* rd = &ing->reads[slot_idx];
+
+    unsigned tail = *ing->sq_tail;
+    unsigned idx = tail & *ing->sq_mask;
+    struct io_uring_sqe* sqe = &((struct io_uring_sqe*)ing->sqes)[idx];
+
+    // IORING_OP_READ only arrived in 5.6, but IORING_OP_READV has been there since io_uring itself.
+    struct iovec* iov = &ing->iovs[slot_idx];
+    iov->iov_base = ing->buf->data + rd->buf_pos;
+    iov->iov_len = rd->len;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = ing->fd;
+    sqe->off = rd->file_offset;
+    sqe->addr = (uint64_t)(uintptr_t)iov;
+    sqe->len = 1;
+    sqe->user_data = slot_idx;
+
+    ing->sq_array[idx] = idx;
+    __atomic_store_n(ing->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ing->sq_pending++;
+}
+
+
+/**
+ * Takes back the reads that are queued in the submission ring but that the kernel never took, and
+ * marks them as failed with the given negated errno. They're always the newest reads.
+ */
+static void uring_drop_pending(saeclib_file_ingest_t* ing, int32_t result)
+{
+    __atomic_store_n(ing->sq_tail, *ing->sq_tail - ing->sq_pending, __ATOMIC_RELEASE);
+
+    for (uint32_t i = ing->count - ing->sq_pending; i < ing->count; i++) {
+        saeclib_file_ingest_read_t* rd = &ing->reads[(ing->first + i) % SAECLIB_FILE_INGEST_MAX_DEPTH];
+        rd->result = result;
+        rd->done = true;
+    }
+
+    ing->sq_pending = 0;
+}
+
+
+/**
+ * Passes queued reads to the kernel and, if wait is set, blocks until at least one read completes.
+ *
+ * The kernel can take fewer reads than were queued, or none at all with EAGAIN or EBUSY when it's
+ * short on memory or completions are backed up; whatever it doesn't take stays queued for the next
+ * call. Any other error means the queued reads will never be taken, so they're failed instead of
+ * being left for someone to wait on.
+ */
+static void uring_submit(saeclib_file_ingest_t* ing, bool wait)
+{
+    const bool block = wait && ((ing->sq_pending + ing->in_kernel) > 0);
+    if ((ing->sq_pending == 0) && !block) {
+        return;
+    }
+
+    int ret = uring_enter(ing->ring_fd, ing->sq_pending, block ? 1 : 0,
+                          block ? IORING_ENTER_GETEVENTS : 0);
+    if (ret >= 0) {
+        ing->sq_pending -= ret;
+        ing->in_kernel += ret;
+        return;
+    }
+
+    const int err = errno;
+    if ((err == EAGAIN) || (err == EBUSY)) {
+        // nothing was taken; room frees up as the reads that the kernel already has complete.
+        if (block && (ing->in_kernel > 0)) {
+            uring_enter(ing->ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+        }
+        return;
+    }
+
+    if (ing->error == 0) {
+        ing->error = err;
+    }
+    uring_drop_pending(ing, -err);
+}
+
+
+static void uring_reap(saeclib_file_ingest_t* ing)
+{
+    unsigned head = *ing->cq_head;
+    unsigned tail = __atomic_load_n(ing->cq_tail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        const struct io_uring_cqe* cqe = &((struct io_uring_cqe*)ing->cqes)[head & *ing->cq_mask];
+        saeclib_file_ingest_read_t* rd = &ing->reads[cqe->user_data];
+        rd->result = cqe->res;
+        rd->done = true;
+        ing->in_kernel--;
+        head++;
+    }
+
+    __atomic_store_n(ing->cq_head, head, __ATOMIC_RELEASE);
+}
+#endif
+
+
+/**
+ * Hands out the circular buffer's free space to new reads, up to the queue depth. With io_uring,
+ * the reads are only queued, to be passed to the kernel by uring_submit. Without it, each read is
+ * done on the spot.
+ */
+static void submit_reads(saeclib_file_ingest_t* ing)
+{
+    saeclib_u8_circular_buffer_t* buf = ing->buf;
+    const size_t capacity = saeclib_u8_circular_buffer_capacity(buf);
+
+    while (!ing->eof && !ing->resync && !ing->error && (ing->count < ing->depth)) {
+        // free space that isn't already spoken for by a read in flight.
+        const size_t reserved = (ing->next_pos + capacity - buf->head) % capacity;
+        const size_t free_bytes = capacity - saeclib_u8_circular_buffer_size(buf) - 1 - reserved;
+
+        size_t len = capacity - ing->next_pos;
+        if (len > free_bytes) len = free_bytes;
+        if (len > ing->chunk_size) len = ing->chunk_size;
+        if (len == 0) {
+            break;
+        }
+
+        uint32_t slot_idx = (ing->first + ing->count) % SAECLIB_FILE_INGEST_MAX_DEPTH;
+        saeclib_file_ingest_read_t* rd = &ing->reads[slot_idx];
+        rd->file_offset = ing->next_offset;
+        rd->buf_pos = ing->next_pos;
+        rd->len = len;
+        rd->done = false;
+        ing->count++;
+
+        ing->next_offset += len;
+        ing->next_pos = (ing->next_pos + len) % capacity;
+
+#if defined(SAECLIB_HAVE_IO_URING)
+        if (ing->ring_fd >= 0) {
+            uring_queue_read(ing, slot_idx);
+            continue;
+        }
+#endif
+
+        ssize_t ret = pread(ing->fd, buf->data + rd->buf_pos, len, rd->file_offset);
+        rd->result = (ret < 0) ? -errno : ret;
+        rd->done = true;
+
+        // a short read means we're at the end of the file; don't bother reading past it.
+        if (rd->result < (int32_t)len) {
+            break;
+        }
+    }
+}
+
+
+/**
+ * Commits the oldest reads to the circular buffer for as long as they're complete.
+ */
+static void commit_reads(saeclib_file_ingest_t* ing, size_t* committed)
+{
+    while ((ing->count > 0) && ing->reads[ing->first].done) {
+        const saeclib_file_ingest_read_t* rd = &ing->reads[ing->first];
+        ing->first = (ing->first + 1) % SAECLIB_FILE_INGEST_MAX_DEPTH;
+        ing->count--;
+
+        // anything after a short or failed read is thrown away.
+        if (ing->eof || ing->resync || ing->error) {
+            continue;
+        }
+
+        if (rd->result < 0) {
+            ing->error = -rd->result;
+            continue;
+        }
+
+        saeclib_u8_circular_buffer_commit(ing->buf, rd->result);
+        *committed += rd->result;
+
+        if (rd->result == 0) {
+            ing->eof = true;
+        } else if (rd->result < rd->len) {
+            ing->resync = true;
+            ing->next_offset = rd->file_offset + rd->result;
+        }
+    }
+
+    // once the reads that were thrown away are out of the kernel's hands, start again right after
+    // the short read.
+    if (ing->resync && (ing->count == 0)) {
+        ing->resync = false;
+        ing->next_pos = ing->buf->head;
+    }
+}
+
+
+saeclib_error_e saeclib_file_ingest_init(saeclib_file_ingest_t* ing,
+                                         saeclib_u8_circular_buffer_t* buf,
+                                         int fd,
+                                         uint32_t chunk_size,
+                                         uint32_t depth,
+                                         uint32_t flags)
+{
+    if (buf == NULL) {
+        return SAECLIB_ERROR_NULL_POINTER;
+    }
+    if ((chunk_size == 0) || (depth == 0) || (depth > SAECLIB_FILE_INGEST_MAX_DEPTH)) {
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+    }
+
+    memset(ing, 0, sizeof(*ing));
+    ing->buf = buf;
+    ing->fd = fd;
+    ing->chunk_size = chunk_size;
+    ing->depth = depth;
+    ing->next_pos = buf->head;
+    ing->ring_fd = -1;
+
+#if defined(SAECLIB_HAVE_IO_URING)
+    if (!(flags & SAECLIB_FILE_INGEST_NO_IO_URING)) {
+        uring_setup(ing);
+    }
+#endif
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+bool saeclib_file_ingest_using_io_uring(const saeclib_file_ingest_t* ing)
+{
+    return (ing->ring_fd >= 0);
+}
+
+
+saeclib_error_e saeclib_file_ingest_poll(saeclib_file_ingest_t* ing, bool wait, size_t* committed)
+{
+    size_t total = 0;
+
+    submit_reads(ing);
+
+#if defined(SAECLIB_HAVE_IO_URING)
+    if (ing->ring_fd >= 0) {
+        uring_submit(ing, wait);
+        uring_reap(ing);
+    }
+#endif
+
+    commit_reads(ing, &total);
+
+    if (committed != NULL) {
+        *committed = total;
+    }
+
+    return (ing->error != 0) ? SAECLIB_ERROR_IO : SAECLIB_ERROR_NOERROR;
+}
+
+
+bool saeclib_file_ingest_done(const saeclib_file_ingest_t* ing)
+{
+    return (ing->eof || (ing->error != 0)) && (ing->count == 0);
+}
+
+
+saeclib_error_e saeclib_file_ingest_close(saeclib_file_ingest_t* ing)
+{
+#if defined(SAECLIB_HAVE_IO_URING)
+    if (ing->ring_fd >= 0) {
+        // reads still queued are submitted along the way, so that none are left in the ring.
+        while ((ing->sq_pending > 0) || (ing->in_kernel > 0)) {
+            const unsigned sq_pending = ing->sq_pending;
+            const unsigned in_kernel = ing->in_kernel;
+
+            uring_submit(ing, true);
+            uring_reap(ing);
+
+            // the kernel won't take the queued reads or report any completions.
+            if ((ing->sq_pending == sq_pending) && (ing->in_kernel == in_kernel)) {
+                break;
+            }
+        }
+        uring_teardown(ing);
+    }
+#endif
+
+    ing->count = 0;
+    ing->sq_pending = 0;
+    ing->in_kernel = 0;
+    return SAECLIB_ERROR_NOERROR;
+}
@@ -0,0 +1,150 @@
+#ifndef _SAECLIB_FILE_INGEST_H
+#define _SAECLIB_FILE_INGEST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+#include "saeclib_circular_buffer.h"
+#include "saeclib_error.h"
+
+/**
+ * A file ingest streams a file into a u8 circular buffer, keeping several reads in flight at once.
+ * Each read targets a piece of the buffer's free space directly, and bytes are committed to the
+ * buffer, in file order, as their reads complete. A consumer can pop from the buffer on another
+ * thread while this is going on.
+ *
+ * This is a hosted-only (Linux) part of saeclib. Reads go through io_uring where the kernel allows
+ * it; otherwise they fall back on synchronous pread(), one chunk at a time.
+ *
+ * Nothing is dynamically allocated by saeclib, but when io_uring is used, the kernel's submission
+ * and completion rings are mapped into the process by saeclib_file_ingest_init and unmapped by
+ * saeclib_file_ingest_close.
+ */
+
+// Maximum number of reads that a file ingest can have in flight.
+#define SAECLIB_FILE_INGEST_MAX_DEPTH 16
+
+// Pass this to saeclib_file_ingest_init to skip io_uring and always use pread().
+#define SAECLIB_FILE_INGEST_NO_IO_URING (1 << 0)
+
+typedef struct saeclib_file_ingest_read
+{
+    uint64_t file_offset;
+
+    // where in the circular buffer this read lands, and how many bytes were asked for.
+    uint32_t buf_pos;
+    uint32_t len;
+
+    // bytes read, or a negated errno. Only valid once done is set.
+    int32_t result;
+    bool done;
+} saeclib_file_ingest_read_t;
+
+typedef struct saeclib_file_ingest
+{
+    saeclib_u8_circular_buffer_t* buf;
+    int fd;
+
+    // largest single read, and maximum number of reads in flight.
+    uint32_t chunk_size;
+    uint32_t depth;
+
+    // file offset and buffer position for the next read to be submitted.
+    uint64_t next_offset;
+    uint32_t next_pos;
+
+    // Reads in submission order; reads[first] is the oldest. Reads are committed to the buffer in
+    // this order no matter what order they complete in.
+    saeclib_file_ingest_read_t reads[SAECLIB_FILE_INGEST_MAX_DEPTH];
+    // count includes reads that are queued for io_uring but haven't been taken by the kernel yet.
+    uint32_t first, count;
+
+    // Set when a read comes back short. Reads submitted after it landed in the wrong place, so
+    // their results are thrown away and no new reads are submitted until they've all completed.
+    bool resync;
+    bool eof;
+
+    // errno of the first failed read, or 0.
+    int error;
+
+    // io_uring state. ring_fd is -1 when pread() is being used instead.
+    int ring_fd;
+    void* sq_map;
+    size_t sq_map_size;
+    void* cq_map;
+    size_t cq_map_size;
+    void* sqes;
+    size_t sqes_size;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    void* cqes;
+
+    // Reads queued in the submission ring that the kernel hasn't taken yet, and reads that it has
+    // taken but whose completions haven't been collected.
+    unsigned sq_pending;
+    unsigned in_kernel;
+
+    // Reads are submitted as single-element readv's, which every io_uring kernel supports; this is
+    // where each read slot's iovec lives while the kernel has it.
+    struct iovec iovs[SAECLIB_FILE_INGEST_MAX_DEPTH];
+} saeclib_file_ingest_t;
+
+/**
+ * Sets up a file ingest. The file is read from its start.
+ *
+ * @param[in,out] ing         File ingest to be initialized
+ * @param[in]     buf         Circular buffer that the file's contents should be streamed into
+ * @param[in]     fd          File descriptor to read from. It stays owned by the caller.
+ * @param[in]     chunk_size  Maximum size of each read, in bytes.
+ * @param[in]     depth       How many reads may be in flight at once. At most
+ *                            SAECLIB_FILE_INGEST_MAX_DEPTH.
+ * @param[in]     flags       0, or SAECLIB_FILE_INGEST_NO_IO_URING.
+ *
+ * @return SAECLIB_ERROR_NULL_POINTER if buf is NULL.
+ *         SAECLIB_ERROR_BAD_STRUCTURE if chunk_size or depth is out of range.
+ *         SAECLIB_ERROR_NOERROR otherwise; failing to set up io_uring isn't an error.
+ */
+saeclib_error_e saeclib_file_ingest_init(saeclib_file_ingest_t* ing,
+                                         saeclib_u8_circular_buffer_t* buf,
+                                         int fd,
+                                         uint32_t chunk_size,
+                                         uint32_t depth,
+                                         uint32_t flags);
+
+/**
+ * Returns true if reads are going through io_uring rather than pread().
+ */
+bool saeclib_file_ingest_using_io_uring(const saeclib_file_ingest_t* ing);
+
+/**
+ * Submits reads into whatever free space the circular buffer has, collects completed reads, and
+ * commits their bytes to the buffer.
+ *
+ * @param[in,out] ing         File ingest to make progress on
+ * @param[in]     wait        If true and reads are in flight, block until at least one completes.
+ * @param[out]    committed   Number of bytes that were added to the circular buffer by this call.
+ *                            May be NULL.
+ *
+ * @return SAECLIB_ERROR_IO if a read failed, or io_uring refused to take reads; ing->error holds
+ *         the errno. Bytes before the failed read are still committed.
+ *         SAECLIB_ERROR_NOERROR otherwise.
+ */
+saeclib_error_e saeclib_file_ingest_poll(saeclib_file_ingest_t* ing, bool wait, size_t* committed);
+
+/**
+ * Returns true once the whole file has been committed to the circular buffer (or a read failed),
+ * and no reads are in flight.
+ */
+bool saeclib_file_ingest_done(const saeclib_file_ingest_t* ing);
+
+/**
+ * Waits for any reads that are still in flight, since they write into the circular buffer's
+ * memory, and releases the io_uring instance if there is one. Reads that were queued but never
+ * taken by the kernel are submitted first, so that they're waited for too. The file descriptor
+ * isn't closed.
+ */
+saeclib_error_e saeclib_file_ingest_close(saeclib_file_ingest_t* ing);
+
+#endif
@@ -0,0 +1,372 @@
+#include "saeclib_filter.h"
+
+#include <string.h>
+
+#include "saeclib_hash_functions.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SAECLIB_FILTER_X86 1
+#endif
+
+// How many keys the batch functions hash and prefetch before testing them.
+#define BATCH_SIZE 16
+
+
+/**
+ * Odd multipliers, one per block word. A key's hash times each of them gives the bit it sets in
+ * that word, from the product's top 5 bits.
+ */
+static const uint32_t bloom_salt[SAECLIB_BLOOM_FILTER_BLOCK_WORDS] __attribute__((aligned(32))) = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+    0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+};
+
+/**
+ * The top half of the mixed hash picks a key's block, and the bottom half its bits in the block.
+ */
+static inline uint64_t bloom_hash(const saeclib_bloom_filter_t* bf, const void* key)
+{
+    return saeclib_hash_mix64(bf->hash_fn(key));
+}
+
+static inline uint32_t* bloom_block(const saeclib_bloom_filter_t* bf, uint64_t h)
+{
+    return bf->blocks + (((h >> 32) & bf->mask) * SAECLIB_BLOOM_FILTER_BLOCK_WORDS);
+}
+
+static inline bool block_test_scalar(const uint32_t* block, uint32_t h)
+{
+    uint32_t missing = 0;
+    for (int i = 0; i < SAECLIB_BLOOM_FILTER_BLOCK_WORDS; i++) {
+        missing |= ~block[i] & (1u << ((h * bloom_salt[i]) >> 27));
+    }
+    return missing == 0;
+}
+
+#if defined(SAECLIB_FILTER_X86)
+/**
+ * Same as block_test_scalar, for all eight words at once: multiply, shift and test in one go.
+ */
+__attribute__((target("avx2")))
+static inline bool block_test_avx2(const uint32_t* block, uint32_t h)
+{
+    const __m256i salt = _mm256_load_si256((const __m256i*)bloom_salt);
+    const __m256i bits = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(h), salt), 27);
+    const __m256i mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), bits);
+
+    // testc is 1 if every bit of mask is also set in the block.
+    return _mm256_testc_si256(_mm256_loadu_si256((const __m256i*)block), mask);
+}
+
+__attribute__((target("avx2")))
+static bool bloom_contains_avx2(const saeclib_bloom_filter_t* bf, uint64_t h)
+{
+    return block_test_avx2(bloom_block(bf, h), (uint32_t)h);
+}
+#endif
+
+static inline bool bloom_contains_hashed(const saeclib_bloom_filter_t* bf, uint64_t h)
+{
+#if defined(SAECLIB_FILTER_X86)
+    if (bf->avx2)
+        return bloom_contains_avx2(bf, h);
+#endif
+    return block_test_scalar(bloom_block(bf, h), (uint32_t)h);
+}
+
+
+saeclib_error_e saeclib_bloom_filter_init(saeclib_bloom_filter_t* bf,
+                                          void* blockspace,
+                                          size_t blockspace_size,
+                                          size_t key_size,
+                                          unsigned int (*hash_fn)(const void*))
+{
+    const size_t nblocks = blockspace_size / (SAECLIB_BLOOM_FILTER_BLOCK_WORDS * sizeof(uint32_t));
+    if ((nblocks == 0) || ((nblocks & (nblocks - 1)) != 0))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    bf->blocks = blockspace;
+    bf->nblocks = nblocks;
+    bf->mask = nblocks - 1;
+    bf->key_elt_size = key_size;
+    bf->hash_fn = hash_fn;
+
+#if defined(SAECLIB_FILTER_X86)
+    __builtin_cpu_init();
+    bf->avx2 = __builtin_cpu_supports("avx2");
+#else
+    bf->avx2 = false;
+#endif
+
+    saeclib_bloom_filter_clear(bf);
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+void saeclib_bloom_filter_add(saeclib_bloom_filter_t* bf, const void* key)
+{
+    const uint64_t h = bloom_hash(bf, key);
+    uint32_t* block = bloom_block(bf, h);
+    for (int i = 0; i < SAECLIB_BLOOM_FILTER_BLOCK_WORDS; i++) {
+        block[i] |= 1u << (((uint32_t)h * bloom_salt[i]) >> 27);
+    }
+}
+
+
+bool saeclib_bloom_filter_contains(const saeclib_bloom_filter_t* bf, const void* key)
+{
+    return bloom_contains_hashed(bf, bloom_hash(bf, key));
+}
+
+
+size_t saeclib_bloom_filter_contains_batch(const saeclib_bloom_filter_t* bf,
+                                           const void* keys,
+                                           size_t n,
+                                           uint64_t* found_mask)
+{
+    const uint8_t* k = keys;
+    uint64_t hashes[BATCH_SIZE];
+    size_t found = 0;
+
+    memset(found_mask, 0, ((n + 63) / 64) * sizeof(uint64_t));
+    for (size_t start = 0; start < n; start += BATCH_SIZE) {
+        const size_t count = ((n - start) < BATCH_SIZE) ? (n - start) : BATCH_SIZE;
+        for (size_t i = 0; i < count; i++) {
+            hashes[i] = bloom_hash(bf, k + ((start + i) * bf->key_elt_size));
+            __builtin_prefetch(bloom_block(bf, hashes[i]));
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (bloom_contains_hashed(bf, hashes[i])) {
+                found_mask[(start + i) / 64] |= 1ull << ((start + i) % 64);
+                found++;
+            }
+        }
+    }
+
+    return found;
+}
+
+
+void saeclib_bloom_filter_clear(saeclib_bloom_filter_t* bf)
+{
+    memset(bf->blocks, 0, bf->nblocks * SAECLIB_BLOOM_FILTER_BLOCK_WORDS * sizeof(uint32_t));
+}
+
+
+// How many fingerprints an insert moves around before it gives up.
+#define CUCKOO_FILTER_MAX_KICKS 500
+
+static const uint64_t LANES_LOW = 0x0001000100010001ull;
+static const uint64_t LANES_HIGH = 0x8000800080008000ull;
+
+/**
+ * The low bits of the mixed hash pick a key's first bucket, and the top 16 its fingerprint.
+ */
+static inline uint64_t cf_hash(const saeclib_cuckoo_filter_t* cf, const void* key)
+{
+    return saeclib_hash_mix64(cf->hash_fn(key));
+}
+
+static inline uint16_t cf_fingerprint(uint64_t m)
+{
+    uint16_t fp = m >> 48;
+    return (fp != 0) ? fp : 1;
+}
+
+static inline size_t cf_alt_bucket(const saeclib_cuckoo_filter_t* cf, size_t b, uint16_t fp)
+{
+    return (b ^ (fp * 0x5bd1e995u)) & cf->mask;
+}
+
+static inline uint16_t* cf_bucket(const saeclib_cuckoo_filter_t* cf, size_t b)
+{
+    return cf->buckets + (b * SAECLIB_CUCKOO_FILTER_SLOTS);
+}
+
+/**
+ * Whether any of a bucket's four 16-bit fingerprints is fp: XORing with fp zeroes the lanes that
+ * match, and the usual trick finds zero lanes. It can flag a lane above a zero one by mistake, but
+ * only when there is a zero one, so the answer is exact.
+ */
+static inline bool cf_bucket_has(const saeclib_cuckoo_filter_t* cf, size_t b, uint16_t fp)
+{
+    uint64_t bucket;
+    memcpy(&bucket, cf_bucket(cf, b), sizeof(bucket));
+    const uint64_t x = bucket ^ (fp * LANES_LOW);
+    return ((x - LANES_LOW) & ~x & LANES_HIGH) != 0;
+}
+
+static bool cf_bucket_put(saeclib_cuckoo_filter_t* cf, size_t b, uint16_t fp)
+{
+    uint16_t* bucket = cf_bucket(cf, b);
+    for (int s = 0; s < SAECLIB_CUCKOO_FILTER_SLOTS; s++) {
+        if (bucket[s] == 0) {
+            bucket[s] = fp;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool cf_bucket_remove(saeclib_cuckoo_filter_t* cf, size_t b, uint16_t fp)
+{
+    uint16_t* bucket = cf_bucket(cf, b);
+    for (int s = 0; s < SAECLIB_CUCKOO_FILTER_SLOTS; s++) {
+        if (bucket[s] == fp) {
+            bucket[s] = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline bool cf_contains_hashed(const saeclib_cuckoo_filter_t* cf, uint64_t m)
+{
+    const uint16_t fp = cf_fingerprint(m);
+    const size_t b1 = m & cf->mask;
+    const size_t b2 = cf_alt_bucket(cf, b1, fp);
+    if (cf_bucket_has(cf, b1, fp) || cf_bucket_has(cf, b2, fp))
+        return true;
+
+    return cf->has_victim && (cf->victim_fp == fp) &&
+           ((cf->victim_bucket == b1) || (cf->victim_bucket == b2));
+}
+
+
+saeclib_error_e saeclib_cuckoo_filter_init(saeclib_cuckoo_filter_t* cf,
+                                           void* bucketspace,
+                                           size_t bucketspace_size,
+                                           size_t key_size,
+                                           unsigned int (*hash_fn)(const void*))
+{
+    const size_t nbuckets = bucketspace_size / (SAECLIB_CUCKOO_FILTER_SLOTS * sizeof(uint16_t));
+    if ((nbuckets < 2) || ((nbuckets & (nbuckets - 1)) != 0))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    cf->buckets = bucketspace;
+    cf->nbuckets = nbuckets;
+    cf->mask = nbuckets - 1;
+    cf->key_elt_size = key_size;
+    cf->hash_fn = hash_fn;
+    cf->size = 0;
+    cf->has_victim = false;
+    cf->victim_fp = 0;
+    cf->victim_bucket = 0;
+    cf->rng = 2463534242u;
+
+    memset(bucketspace, 0, nbuckets * SAECLIB_CUCKOO_FILTER_SLOTS * sizeof(uint16_t));
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_cuckoo_filter_insert(saeclib_cuckoo_filter_t* cf, const void* key)
+{
+    if (cf->has_victim)
+        return SAECLIB_ERROR_OVERFLOW;
+
+    const uint64_t m = cf_hash(cf, key);
+    uint16_t fp = cf_fingerprint(m);
+    const size_t b1 = m & cf->mask;
+    const size_t b2 = cf_alt_bucket(cf, b1, fp);
+    cf->size++;
+    if (cf_bucket_put(cf, b1, fp) || cf_bucket_put(cf, b2, fp))
+        return SAECLIB_ERROR_NOERROR;
+
+    // Swap fp for a fingerprint picked at random from one of the full buckets, and try to put that
+    // one in its other bucket, and so on.
+    size_t b = b1;
+    for (int kick = 0; kick < CUCKOO_FILTER_MAX_KICKS; kick++) {
+        cf->rng ^= cf->rng << 13;
+        cf->rng ^= cf->rng >> 17;
+        cf->rng ^= cf->rng << 5;
+        if ((kick == 0) && (cf->rng & 4))
+            b = b2;
+
+        uint16_t* slot = &cf_bucket(cf, b)[cf->rng % SAECLIB_CUCKOO_FILTER_SLOTS];
+        const uint16_t kicked = *slot;
+        *slot = fp;
+        fp = kicked;
+
+        b = cf_alt_bucket(cf, b, fp);
+        if (cf_bucket_put(cf, b, fp))
+            return SAECLIB_ERROR_NOERROR;
+    }
+
+    cf->has_victim = true;
+    cf->victim_fp = fp;
+    cf->victim_bucket = b;
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+bool saeclib_cuckoo_filter_contains(const saeclib_cuckoo_filter_t* cf, const void* key)
+{
+    return cf_contains_hashed(cf, cf_hash(cf, key));
+}
+
+
+size_t saeclib_cuckoo_filter_contains_batch(const saeclib_cuckoo_filter_t* cf,
+                                            const void* keys,
+                                            size_t n,
+                                            uint64_t* found_mask)
+{
+    const uint8_t* k = keys;
+    uint64_t hashes[BATCH_SIZE];
+    size_t found = 0;
+
+    memset(found_mask, 0, ((n + 63) / 64) * sizeof(uint64_t));
+    for (size_t start = 0; start < n; start += BATCH_SIZE) {
+        const size_t count = ((n - start) < BATCH_SIZE) ? (n - start) : BATCH_SIZE;
+        for (size_t i = 0; i < count; i++) {
+            const uint64_t m = cf_hash(cf, k + ((start + i) * cf->key_elt_size));
+            const size_t b1 = m & cf->mask;
+            hashes[i] = m;
+            __builtin_prefetch(cf_bucket(cf, b1));
+            __builtin_prefetch(cf_bucket(cf, cf_alt_bucket(cf, b1, cf_fingerprint(m))));
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (cf_contains_hashed(cf, hashes[i])) {
+                found_mask[(start + i) / 64] |= 1ull << ((start + i) % 64);
+                found++;
+            }
+        }
+    }
+
+    return found;
+}
+
+
+saeclib_error_e saeclib_cuckoo_filter_delete(saeclib_cuckoo_filter_t* cf, const void* key)
+{
+    const uint64_t m = cf_hash(cf, key);
+    const uint16_t fp = cf_fingerprint(m);
+    const size_t b1 = m & cf->mask;
+    const size_t b2 = cf_alt_bucket(cf, b1, fp);
+
+    if (cf_bucket_remove(cf, b1, fp) || cf_bucket_remove(cf, b2, fp)) {
+        cf->size--;
+
+        // there may be room for the fingerprint that was kept aside now.
+        if (cf->has_victim &&
+            (cf_bucket_put(cf, cf->victim_bucket, cf->victim_fp) ||
+             cf_bucket_put(cf, cf_alt_bucket(cf, cf->victim_bucket, cf->victim_fp), cf->victim_fp)))
+            cf->has_victim = false;
+        return SAECLIB_ERROR_NOERROR;
+    }
+
+    if (cf->has_victim && (cf->victim_fp == fp) &&
+        ((cf->victim_bucket == b1) || (cf->victim_bucket == b2))) {
+        cf->has_victim = false;
+        cf->size--;
+        return SAECLIB_ERROR_NOERROR;
+    }
+
+    return SAECLIB_ERROR_UNDERFLOW;
+}
+
+
+size_t saeclib_cuckoo_filter_size(const saeclib_cuckoo_filter_t* cf)
+{
+    return cf->size;
+}
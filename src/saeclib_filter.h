@@ -0,0 +1,235 @@
+#ifndef _SAECLIB_FILTER_H
+#define _SAECLIB_FILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "saeclib_error.h"
+#include "saeclib_hash.h"
+
+/**
+ * Approximate set membership: filters that answer "definitely not there" or "probably there" for
+ * a key, using a small fraction of the memory a hash table of the same keys would, so that
+ * lookups for missing keys can skip the table (or the disk) altogether. Neither filter stores
+ * keys, only bits of their hashes, so a key can never be read back out.
+ *
+ * Both filters run the user's 32-bit hash through saeclib_hash_mix64 before use, so weak hashes
+ * like saeclib_hash_table_u32_hash are fine. Keys whose 32-bit hashes are equal always look the
+ * same to the filters, though, which adds n / 2^32 to the false positive rates below for a filter
+ * holding n keys, even with a perfect hash function.
+ */
+
+
+/**
+ * Split-block Bloom filter. The filter is an array of 32-byte blocks of eight 32-bit words. A key
+ * picks one block with its hash, and sets or tests one bit in each of the block's words, so a
+ * query reads one block: one cache line, when the blocks are 32-byte aligned. On x86 machines
+ * with AVX2 (checked at runtime), a block is tested with a single 256-bit compare.
+ *
+ * With 8 bits per key the false positive rate is around 3%, and with 16 around 0.15%. Keys can't
+ * be removed.
+ */
+
+#define SAECLIB_BLOOM_FILTER_BLOCK_WORDS 8
+
+/**
+ * Number of blocks for capacity keys at bits_per_key bits each; a power of two.
+ */
+#define SAECLIB_BLOOM_FILTER_NBLOCKS(capacity, bits_per_key) \
+    SAECLIB_NEXT_POW2((((capacity) * (bits_per_key)) + 255) / 256)
+
+typedef struct saeclib_bloom_filter
+{
+    // nblocks blocks of SAECLIB_BLOOM_FILTER_BLOCK_WORDS words.
+    uint32_t* blocks;
+    size_t nblocks;
+    size_t mask;
+
+    size_t key_elt_size;
+    unsigned int (*hash_fn)(const void*);
+
+    // whether to use the AVX2 block test, decided at init.
+    bool avx2;
+} saeclib_bloom_filter_t;
+
+/**
+ * Initializes an empty Bloom filter.
+ *
+ * @param[in,out] bf        Filter to initialize.
+ * @param[in]     blockspace  Memory for the blocks, SAECLIB_BLOOM_FILTER_NBLOCKS * 32 bytes and
+ *                            preferably aligned to 32 bytes. It's cleared here.
+ * @param[in]     blockspace_size  Size of blockspace in bytes.
+ * @param[in]     key_size  Size in bytes of each key; used by the batch functions.
+ * @param[in]     hash_fn   Hash function for keys.
+ *
+ * @return SAECLIB_ERROR_BAD_STRUCTURE if blockspace doesn't hold a power of two blocks.
+ */
+saeclib_error_e saeclib_bloom_filter_init(saeclib_bloom_filter_t* bf,
+                                          void* blockspace,
+                                          size_t blockspace_size,
+                                          size_t key_size,
+                                          unsigned int (*hash_fn)(const void*));
+
+/**
+ * Statically allocates a Bloom filter sized for capacity keys with at least bits_per_key bits
+ * each. The same cautions as for saeclib_hash_table_salloc apply.
+ */
+#define saeclib_bloom_filter_salloc(capacity, bits_per_key, keysize, hash_fn)                      \
+    ({                                                                                            \
+    saeclib_bloom_filter_t bf;                                                                    \
+    static uint32_t blockspace[SAECLIB_BLOOM_FILTER_NBLOCKS(capacity, bits_per_key) *             \
+                               SAECLIB_BLOOM_FILTER_BLOCK_WORDS] __attribute__((aligned(64)));    \
+    saeclib_bloom_filter_init(&bf, blockspace, sizeof(blockspace), keysize, hash_fn);             \
+    bf;                                                                                           \
+    })
+
+/**
+ * Adds a key to the filter.
+ */
+void saeclib_bloom_filter_add(saeclib_bloom_filter_t* bf, const void* key);
+
+/**
+ * Returns false if the key was definitely never added, and true if it probably was.
+ */
+bool saeclib_bloom_filter_contains(const saeclib_bloom_filter_t* bf, const void* key);
+
+/**
+ * Tests n keys at once. All of the keys are hashed and their blocks prefetched before any of them
+ * are tested, like saeclib_hash_search_batch, so that the cache misses for a big filter overlap.
+ *
+ * @param[in]     keys        n keys, packed one after the other.
+ * @param[in]     n           Number of keys.
+ * @param[out]    found_mask  Bit (i % 64) of found_mask[i / 64] is set if keys[i] is probably in
+ *                            the filter and cleared otherwise. Should have room for (n + 63) / 64
+ *                            words.
+ *
+ * @return How many of the keys are probably in the filter.
+ */
+size_t saeclib_bloom_filter_contains_batch(const saeclib_bloom_filter_t* bf,
+                                           const void* keys,
+                                           size_t n,
+                                           uint64_t* found_mask);
+
+/**
+ * Empties the filter.
+ */
+void saeclib_bloom_filter_clear(saeclib_bloom_filter_t* bf);
+
+
+/**
+ * Cuckoo filter. Like saeclib_cuckoo_table_t, but each slot holds only a 16-bit fingerprint of a
+ * key's hash, and a key's second bucket comes from its first bucket and its fingerprint. Unlike
+ * a Bloom filter, keys can be deleted. Each bucket is 4 fingerprints in 8 bytes, and a query
+ * checks both of a key's buckets with a few word-wide operations.
+ *
+ * The false positive rate is about 0.01% when the filter's 95% full, and less when it's emptier.
+ * Slots are 16 bits, and the filter fills to about 95% before inserts start to fail.
+ *
+ * The filter can't tell keys with the same fingerprint and buckets apart. Only delete keys that
+ * were inserted, or a key that shares a fingerprint with it can go missing. The same key can be
+ * inserted more than once (as long as its two buckets have room for all the copies), and then
+ * needs deleting as many times.
+ */
+
+#define SAECLIB_CUCKOO_FILTER_SLOTS 4
+
+/**
+ * Number of buckets for capacity keys; a power of two, with room to spare so that the filter
+ * doesn't have to fill past 95%.
+ */
+#define SAECLIB_CUCKOO_FILTER_NBUCKETS(capacity) \
+    SAECLIB_NEXT_POW2((((capacity) * 20 / 19) + SAECLIB_CUCKOO_FILTER_SLOTS - 1) / \
+                      SAECLIB_CUCKOO_FILTER_SLOTS)
+
+typedef struct saeclib_cuckoo_filter
+{
+    // nbuckets buckets of SAECLIB_CUCKOO_FILTER_SLOTS fingerprints, 0 for an empty slot.
+    uint16_t* buckets;
+    size_t nbuckets;
+    size_t mask;
+
+    size_t key_elt_size;
+    unsigned int (*hash_fn)(const void*);
+
+    size_t size;
+
+    // A fingerprint that was kicked out of its bucket by an insert that then ran out of moves.
+    // Keeping it here means no key is ever lost; while it's here, the filter is full.
+    bool has_victim;
+    uint16_t victim_fp;
+    size_t victim_bucket;
+
+    // picks which fingerprint to kick out.
+    uint32_t rng;
+} saeclib_cuckoo_filter_t;
+
+/**
+ * Initializes an empty cuckoo filter.
+ *
+ * @param[in,out] cf        Filter to initialize.
+ * @param[in]     bucketspace  Memory for the buckets, SAECLIB_CUCKOO_FILTER_NBUCKETS * 8 bytes.
+ *                             It's cleared here.
+ * @param[in]     bucketspace_size  Size of bucketspace in bytes.
+ * @param[in]     key_size  Size in bytes of each key; used by the batch functions.
+ * @param[in]     hash_fn   Hash function for keys.
+ *
+ * @return SAECLIB_ERROR_BAD_STRUCTURE if bucketspace doesn't hold a power of two buckets, at
+ *         least 2.
+ */
+saeclib_error_e saeclib_cuckoo_filter_init(saeclib_cuckoo_filter_t* cf,
+                                           void* bucketspace,
+                                           size_t bucketspace_size,
+                                           size_t key_size,
+                                           unsigned int (*hash_fn)(const void*));
+
+/**
+ * Statically allocates a cuckoo filter with room for capacity keys. The same cautions as for
+ * saeclib_hash_table_salloc apply.
+ */
+#define saeclib_cuckoo_filter_salloc(capacity, keysize, hash_fn)                                  \
+    ({                                                                                            \
+    saeclib_cuckoo_filter_t cf;                                                                   \
+    static uint16_t bucketspace[SAECLIB_CUCKOO_FILTER_NBUCKETS(capacity) *                        \
+                                SAECLIB_CUCKOO_FILTER_SLOTS] __attribute__((aligned(64)));        \
+    saeclib_cuckoo_filter_init(&cf, bucketspace, sizeof(bucketspace), keysize, hash_fn);          \
+    cf;                                                                                           \
+    })
+
+/**
+ * Adds a key to the filter. If both of its buckets are full, fingerprints are moved to their other
+ * buckets to make room, up to a few hundred times. If that runs out, the key is still added, but
+ * the last fingerprint to be moved is kept aside and the filter is full until a delete makes room
+ * for it again.
+ *
+ * @return SAECLIB_ERROR_OVERFLOW if the filter is full. The key isn't added.
+ */
+saeclib_error_e saeclib_cuckoo_filter_insert(saeclib_cuckoo_filter_t* cf, const void* key);
+
+/**
+ * Returns false if the key is definitely not in the filter, and true if it probably is.
+ */
+bool saeclib_cuckoo_filter_contains(const saeclib_cuckoo_filter_t* cf, const void* key);
+
+/**
+ * Tests n keys at once, prefetching both of every key's buckets first. Arguments and return
+ * value are the same as for saeclib_bloom_filter_contains_batch.
+ */
+size_t saeclib_cuckoo_filter_contains_batch(const saeclib_cuckoo_filter_t* cf,
+                                            const void* keys,
+                                            size_t n,
+                                            uint64_t* found_mask);
+
+/**
+ * Removes one copy of a key that was inserted.
+ *
+ * @return SAECLIB_ERROR_UNDERFLOW if the key's fingerprint isn't in either of its buckets.
+ */
+saeclib_error_e saeclib_cuckoo_filter_delete(saeclib_cuckoo_filter_t* cf, const void* key);
+
+/**
+ * Number of keys in the filter.
+ */
+size_t saeclib_cuckoo_filter_size(const saeclib_cuckoo_filter_t* cf);
+
+#endif
@@ -1,7 +1,23 @@
 #include "saeclib_hash.h"
+#include <stdbool.h>
 #include <string.h>
 #include <assert.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Control byte for an empty bucket. Filled buckets always have the top bit set.
+#define CTRL_EMPTY 0x00
+#define CTRL_FULL  SAECLIB_HASH_CTRL_FULL
+
+// Control byte for a bucket of a table that's being migrated out of, whose key has been moved or
+// deleted. Searches carry on past it, as if it were filled.
+#define CTRL_TOMBSTONE 0x01
+
+// How many of the old table's buckets each insert or delete migrates while the table is growing.
+#define MIGRATE_BUCKETS_PER_OP 16
+
 
 static void* get_keyptr_at_idx(saeclib_hash_table_t* sht, int idx)
 {
@@ -14,6 +30,351 @@ static void* get_valptr_at_idx(saeclib_hash_table_t* sht, int idx)
 }
 
 
+/**
+ * Every change to a table is bracketed by begin_write and end_write, which make seq odd and then
+ * even again, so that saeclib_hash_search_optimistic can spot a write that overlapped it. The odd
+ * value has to be visible before anything in the table changes, and the even one can't be visible
+ * until everything has.
+ */
+static inline void begin_write(saeclib_hash_table_t* sht)
+{
+    __atomic_store_n(&sht->seq, sht->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+
+static inline void end_write(saeclib_hash_table_t* sht)
+{
+    __atomic_store_n(&sht->seq, sht->seq + 1, __ATOMIC_RELEASE);
+}
+
+
+static inline void spin_pause(void)
+{
+#if defined(__SSE2__)
+    _mm_pause();
+#endif
+}
+
+
+/**
+ * Control byte for a filled bucket holding a key with the given hash. The hash is scrambled a
+ * little first because the low bits were already used to pick the bucket, and the high bits of
+ * weak hashes (like the identity hash for integers) are often all zero.
+ */
+static inline uint8_t ctrl_for_hash(unsigned int hash)
+{
+    return CTRL_FULL | (uint8_t)((hash * 0x9e3779b1u) >> 25);
+}
+
+
+/**
+ * murmur3's 32-bit finalizer. Every input bit affects every output bit, so masking off the low
+ * bits of the result is as good as dividing by a prime.
+ */
+static inline uint32_t mix32(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+
+static inline size_t home_idx(const saeclib_hash_table_t* sht, unsigned int hash)
+{
+    if (sht->mask != 0)
+        return mix32(hash) & sht->mask;
+
+    return hash % sht->capacity;
+}
+
+
+/**
+ * How many buckets after home bucket idx is, going forward and wrapping around.
+ */
+static inline size_t dist_from_home(const saeclib_hash_table_t* sht, size_t idx, size_t home)
+{
+    return (idx >= home) ? (idx - home) : (idx + sht->capacity - home);
+}
+
+
+static inline size_t next_idx(const saeclib_hash_table_t* sht, size_t idx)
+{
+    return ((idx + 1) == sht->capacity) ? 0 : (idx + 1);
+}
+
+
+/**
+ * Returns true if the 16 bytes at a and b are the same.
+ */
+static inline bool equal16(const void* a, const void* b)
+{
+#if defined(__SSE2__)
+    __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)a),
+                                _mm_loadu_si128((const __m128i*)b));
+    return (_mm_movemask_epi8(eq) == 0xffff);
+#else
+    uint64_t a0, a1, b0, b1;
+    memcpy(&a0, a, 8);
+    memcpy(&a1, (const uint8_t*)a + 8, 8);
+    memcpy(&b0, b, 8);
+    memcpy(&b1, (const uint8_t*)b + 8, 8);
+    return (((a0 ^ b0) | (a1 ^ b1)) == 0);
+#endif
+}
+
+
+/**
+ * Returns true if the filled bucket idx holds key. kind is always a constant, so each of probe()'s
+ * copies of the probe loop gets just one of these compares. Keys of the built-in kinds are
+ * compared directly, which is cheaper than checking the cached hash; other keys check the cached
+ * hash first, if there is one, before calling cmp.
+ */
+static inline __attribute__((always_inline)) bool key_matches(const saeclib_hash_table_t* sht,
+                                                              size_t idx,
+                                                              const void* key,
+                                                              unsigned int hash,
+                                                              saeclib_hash_key_kind_e kind)
+{
+    const void* bucket_key = get_keyptr_at_idx((saeclib_hash_table_t*)sht, idx);
+
+    switch (kind) {
+        case SAECLIB_HASH_KEY_U32: {
+            uint32_t a, b;
+            memcpy(&a, key, sizeof(a));
+            memcpy(&b, bucket_key, sizeof(b));
+            return (a == b);
+        }
+        case SAECLIB_HASH_KEY_U64: {
+            uint64_t a, b;
+            memcpy(&a, key, sizeof(a));
+            memcpy(&b, bucket_key, sizeof(b));
+            return (a == b);
+        }
+        case SAECLIB_HASH_KEY_U128:
+            return equal16(key, bucket_key);
+        default:
+            if ((sht->hashes != NULL) && (sht->hashes[idx] != hash))
+                return false;
+            return !sht->cmp(key, bucket_key);
+    }
+}
+
+
+/**
+ * Returns the hash of the key in the filled bucket idx, without calling hash_fn if it's cached.
+ */
+static inline unsigned int bucket_hash(saeclib_hash_table_t* sht, size_t idx)
+{
+    if (sht->hashes != NULL)
+        return sht->hashes[idx];
+
+    return sht->hash_fn(get_keyptr_at_idx(sht, idx));
+}
+
+
+/**
+ * Walks the probe sequence for a key. Returns the index of the bucket holding the key, or -1 if
+ * it's not in the table. In that case, *stop_idx is set to the bucket that ended the search, which
+ * is where the key would be inserted, or -1 if the table is full. The search ends at an empty
+ * bucket or, with Robin Hood insertion, at a key that's closer to its home bucket than ours would
+ * be.
+ *
+ * Away from the end of the bucket array, 16 control bytes are checked at a time and keys are only
+ * compared in buckets whose control byte matches. The last 15 buckets are probed one at a time so
+ * that no extra control bytes need to be allocated past the end of the array.
+ *
+ * This is the body of probe(), which inlines it once for each kind of key.
+ */
+static inline __attribute__((always_inline)) int probe_kind(const saeclib_hash_table_t* sht,
+                                                            const void* key,
+                                                            unsigned int hash,
+                                                            int* stop_idx,
+                                                            saeclib_hash_key_kind_e kind)
+{
+    const uint8_t ctrl = ctrl_for_hash(hash);
+    size_t idx = home_idx(sht, hash);
+    size_t probed = 0;
+
+    while (probed < sht->capacity) {
+#if defined(__SSE2__)
+        if ((idx + 16) <= sht->capacity) {
+            __m128i group = _mm_loadu_si128((const __m128i*)(sht->bucket_filled + idx));
+            uint32_t empties = _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_setzero_si128()));
+            uint32_t matches = _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)ctrl)));
+
+            // With Robin Hood insertion, a key whose distance from home is less than ours would
+            // be also ends the chain. Our distances for this group are probed + [0, 16).
+            if (sht->probe_dist != NULL) {
+                __m128i dists = _mm_loadu_si128((const __m128i*)(sht->probe_dist + idx));
+                __m128i ours = _mm_adds_epu8(_mm_set1_epi8((char)((probed < 255) ? probed : 255)),
+                                             _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+                                                           12, 13, 14, 15));
+                __m128i closer = _mm_cmpeq_epi8(_mm_subs_epu8(ours, dists), _mm_setzero_si128());
+                empties |= ~_mm_movemask_epi8(closer) & 0xffff;
+            }
+
+            // Only buckets before the first empty one belong to this key's chain, and we mustn't
+            // go past the bucket we started at.
+            size_t chain_len = (empties != 0) ? __builtin_ctz(empties) : 16;
+            if (chain_len > (sht->capacity - probed)) {
+                chain_len = sht->capacity - probed;
+            }
+
+            for (matches &= (1u << chain_len) - 1; matches != 0; matches &= (matches - 1)) {
+                size_t match_idx = idx + __builtin_ctz(matches);
+                if (key_matches(sht, match_idx, key, hash, kind))
+                    return match_idx;
+            }
+
+            if (chain_len < 16) {
+                *stop_idx = (chain_len < (sht->capacity - probed)) ? (int)(idx + chain_len) : -1;
+                return -1;
+            }
+
+            probed += 16;
+            idx += 16;
+            if (idx == sht->capacity)
+                idx = 0;
+            continue;
+        }
+#endif
+        // if we came across an empty bucket, we didn't find our key.
+        if (sht->bucket_filled[idx] == CTRL_EMPTY) {
+            *stop_idx = idx;
+            return -1;
+        }
+
+        // with Robin Hood insertion, our key would have displaced this one.
+        if ((sht->probe_dist != NULL) && (sht->probe_dist[idx] < probed)) {
+            *stop_idx = idx;
+            return -1;
+        }
+
+        // check the cheap control byte before comparing keys.
+        if ((sht->bucket_filled[idx] == ctrl) && key_matches(sht, idx, key, hash, kind))
+            return idx;
+
+        // linear probing
+        idx = next_idx(sht, idx);
+        probed++;
+    }
+
+    // we made it all the way around the array without finding the key or an empty bucket.
+    *stop_idx = -1;
+    return -1;
+}
+
+
+/**
+ * Walks the probe sequence for a key; see probe_kind. Tables of built-in key kinds get a copy of
+ * the probe loop that compares their keys inline, without calling through sht->cmp.
+ */
+static int probe(const saeclib_hash_table_t* sht, const void* key, unsigned int hash, int* stop_idx)
+{
+    switch (sht->key_kind) {
+        case SAECLIB_HASH_KEY_U32:
+            return probe_kind(sht, key, hash, stop_idx, SAECLIB_HASH_KEY_U32);
+        case SAECLIB_HASH_KEY_U64:
+            return probe_kind(sht, key, hash, stop_idx, SAECLIB_HASH_KEY_U64);
+        case SAECLIB_HASH_KEY_U128:
+            return probe_kind(sht, key, hash, stop_idx, SAECLIB_HASH_KEY_U128);
+        default:
+            return probe_kind(sht, key, hash, stop_idx, SAECLIB_HASH_KEY_GENERIC);
+    }
+}
+
+
+/**
+ * Moves the contents of bucket src into bucket dst, leaving src untouched.
+ */
+static void move_bucket(saeclib_hash_table_t* sht, size_t dst, size_t src)
+{
+    memcpy(get_keyptr_at_idx(sht, dst), get_keyptr_at_idx(sht, src), sht->key_elt_size);
+    memcpy(get_valptr_at_idx(sht, dst), get_valptr_at_idx(sht, src), sht->value_elt_size);
+    sht->bucket_filled[dst] = sht->bucket_filled[src];
+    if (sht->hashes != NULL)
+        sht->hashes[dst] = sht->hashes[src];
+}
+
+
+/**
+ * Records how far bucket idx is from the home bucket of the key in it, if Robin Hood insertion is
+ * enabled.
+ */
+static inline void set_probe_dist(saeclib_hash_table_t* sht, size_t idx, size_t home)
+{
+    if (sht->probe_dist != NULL)
+        sht->probe_dist[idx] = dist_from_home(sht, idx, home);
+}
+
+
+/**
+ * Robin Hood insertion of a key that isn't in the table, where probe() stopped at bucket pos.
+ *
+ * Keys in a run of filled buckets are ordered by home bucket, so inserting the new key at pos
+ * and moving every key from pos up to the next empty bucket along by one keeps them in order. This
+ * is the same thing as swapping the new key with each key that's closer to home than it, but it
+ * doesn't need to copy keys through a temporary.
+ */
+static saeclib_error_e robin_hood_insert(saeclib_hash_table_t* sht,
+                                         const void* key,
+                                         const void* value,
+                                         unsigned int hash,
+                                         size_t pos)
+{
+    const size_t dist = dist_from_home(sht, pos, home_idx(sht, hash));
+    if (dist > UINT8_MAX)
+        return SAECLIB_ERROR_OVERFLOW;
+
+    // find the end of the run, making sure that nothing will be pushed too far from home.
+    size_t end = pos;
+    while (sht->bucket_filled[end] != CTRL_EMPTY) {
+        if (sht->probe_dist[end] == UINT8_MAX)
+            return SAECLIB_ERROR_OVERFLOW;
+        end = next_idx(sht, end);
+        if (end == pos)
+            return SAECLIB_ERROR_OVERFLOW;
+    }
+
+    while (end != pos) {
+        size_t prev = (end == 0) ? (sht->capacity - 1) : (end - 1);
+        move_bucket(sht, end, prev);
+        sht->probe_dist[end] = sht->probe_dist[prev] + 1;
+        end = prev;
+    }
+
+    memcpy(get_keyptr_at_idx(sht, pos), key, sht->key_elt_size);
+    memcpy(get_valptr_at_idx(sht, pos), value, sht->value_elt_size);
+    sht->bucket_filled[pos] = ctrl_for_hash(hash);
+    sht->probe_dist[pos] = dist;
+    if (sht->hashes != NULL)
+        sht->hashes[pos] = hash;
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+/**
+ * Which of the built-in key kinds, if any, a table with the given key size and compare function
+ * holds.
+ */
+static saeclib_hash_key_kind_e key_kind_for(size_t key_size, int (*cmp)(const void*, const void*))
+{
+    if ((cmp == saeclib_hash_table_u32_cmp) && (key_size == sizeof(uint32_t)))
+        return SAECLIB_HASH_KEY_U32;
+    if ((cmp == saeclib_hash_table_u64_cmp) && (key_size == sizeof(uint64_t)))
+        return SAECLIB_HASH_KEY_U64;
+    if ((cmp == saeclib_hash_table_u128_cmp) && (key_size == 16))
+        return SAECLIB_HASH_KEY_U128;
+
+    return SAECLIB_HASH_KEY_GENERIC;
+}
+
+
 saeclib_error_e saeclib_hash_table_init(saeclib_hash_table_t* sht,
                                         void* keyspace,
                                         void* valuespace,
@@ -43,33 +404,91 @@ saeclib_error_e saeclib_hash_table_init(saeclib_hash_table_t* sht,
 
     sht->hash_fn = hash_fn;
     sht->cmp = cmp;
+    sht->key_kind = key_kind_for(key_size, cmp);
+
+    sht->mask = 0;
+    sht->probe_dist = NULL;
+    sht->hashes = NULL;
+    sht->migrating = NULL;
+    sht->migrate_pos = 0;
+    sht->seq = 0;
 
     return SAECLIB_ERROR_NOERROR;
 }
 
 
-saeclib_error_e saeclib_hash_insert(saeclib_hash_table_t* sht,
-                                    const void* key,
-                                    const void* value)
+saeclib_error_e saeclib_hash_table_init_pow2(saeclib_hash_table_t* sht,
+                                             void* keyspace,
+                                             void* valuespace,
+                                             void* bucketspace,
+                                             size_t keyspace_size,
+                                             size_t key_size,
+                                             size_t value_size,
+                                             unsigned int (*hash_fn)(const void*),
+                                             int (*cmp)(const void*, const void*))
 {
-    // find first empty bucket at our hash location.
-    const int start_idx = sht->hash_fn(key) % sht->capacity;
-    int idx = start_idx;
-    while (1) {
-        // if we came across an empty bucket, we can put our data there.
-        if (sht->bucket_filled[idx] == 0)
-            break;
+    const size_t capacity = keyspace_size / key_size;
+    if ((capacity < 2) || ((capacity & (capacity - 1)) != 0))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
 
-        // if we came across a bucket that already matches our key, we can't insert.
-        if (!sht->cmp(key, get_keyptr_at_idx(sht, idx)))
-            return SAECLIB_ERROR_DUPLICATE_KEY;
+    saeclib_hash_table_init(sht, keyspace, valuespace, bucketspace, keyspace_size, key_size,
+                            value_size, hash_fn, cmp);
+    sht->mask = capacity - 1;
 
-        // linear probing
-        idx = (idx + 1) % sht->capacity;
-        if (idx == start_idx)
-            return SAECLIB_ERROR_OVERFLOW;
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_hash_table_enable_robin_hood(saeclib_hash_table_t* sht, uint8_t* distspace)
+{
+    for (size_t i = 0; i < sht->capacity; i++) {
+        if (sht->bucket_filled[i] != CTRL_EMPTY)
+            return SAECLIB_ERROR_BAD_STRUCTURE;
+    }
+
+    begin_write(sht);
+    memset(distspace, 0, sht->capacity);
+    sht->probe_dist = distspace;
+    end_write(sht);
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_hash_table_enable_hash_cache(saeclib_hash_table_t* sht,
+                                                     unsigned int* hashspace)
+{
+    for (size_t i = 0; i < sht->capacity; i++) {
+        if (sht->bucket_filled[i] != CTRL_EMPTY)
+            hashspace[i] = sht->hash_fn(get_keyptr_at_idx(sht, i));
     }
 
+    begin_write(sht);
+    sht->hashes = hashspace;
+    end_write(sht);
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+/**
+ * saeclib_hash_insert, for a key that's already been hashed.
+ */
+static saeclib_error_e insert_hashed(saeclib_hash_table_t* sht,
+                                     const void* key,
+                                     const void* value,
+                                     unsigned int hash)
+{
+    // find the first empty bucket at our hash location, making sure the key isn't there already.
+    int idx;
+    if (probe(sht, key, hash, &idx) != -1)
+        return SAECLIB_ERROR_DUPLICATE_KEY;
+    if (idx == -1)
+        return SAECLIB_ERROR_OVERFLOW;
+
+    if (sht->probe_dist != NULL)
+        return robin_hood_insert(sht, key, value, hash, idx);
+
     // copy the key and the data into the bucket
     void* keyptr = get_keyptr_at_idx(sht, idx);
     void* valptr = get_valptr_at_idx(sht, idx);
@@ -77,37 +496,98 @@ saeclib_error_e saeclib_hash_insert(saeclib_hash_table_t* sht,
     memcpy(valptr, value, sht->value_elt_size);
 
     // mark the bucket as filled.
-    sht->bucket_filled[idx] = 1;
+    sht->bucket_filled[idx] = ctrl_for_hash(hash);
+    if (sht->hashes != NULL)
+        sht->hashes[idx] = hash;
 
     return SAECLIB_ERROR_NOERROR;
 }
 
 
 /**
- * Returns the index of the bucket containing a given key in the hash.
- * If no bucket is found, returns -1.
+ * Moves up to nbuckets of the old table's buckets into the new one while the table is growing.
+ * Moved keys leave tombstones behind, so that nothing in the old table has to be shuffled around
+ * and keys that haven't been moved yet can still be found.
  */
-static int saeclib_hash_search_bucket_idx(saeclib_hash_table_t* sht,
-                                          const void* key)
+static saeclib_error_e migrate_some(saeclib_hash_table_t* sht, size_t nbuckets)
 {
-    const int start_idx = (int)(sht->hash_fn(key) % sht->capacity);
-    int idx = start_idx;
-    while (1) {
-        // if we came across an empty bucket, we didn't find our key.
-        if (sht->bucket_filled[idx] != 1)
-            return -1;
+    saeclib_hash_table_t* old = sht->migrating;
+    if (old == NULL)
+        return SAECLIB_ERROR_NOERROR;
 
-        // we know that we aren't looking at an empty bucket, check and see if its a match for our
-        // key.
-        if (!sht->cmp(key, get_keyptr_at_idx(sht, idx)))
-            return idx;
+    for (; (nbuckets > 0) && (sht->migrate_pos < old->capacity); nbuckets--) {
+        const size_t idx = sht->migrate_pos;
+        if (old->bucket_filled[idx] & CTRL_FULL) {
+            saeclib_error_e err = insert_hashed(sht, get_keyptr_at_idx(old, idx),
+                                                get_valptr_at_idx(old, idx),
+                                                bucket_hash(old, idx));
+            if (err != SAECLIB_ERROR_NOERROR)
+                return err;
+            old->bucket_filled[idx] = CTRL_TOMBSTONE;
+        }
+        sht->migrate_pos++;
+    }
 
-        // linear probing
-        idx = (idx + 1) % sht->capacity;
+    // once everything has been moved, the old table is handed back to the caller, empty.
+    if (sht->migrate_pos == old->capacity) {
+        memset(old->bucket_filled, CTRL_EMPTY, old->capacity);
+        sht->migrating = NULL;
+    }
 
-        // if we made it all the way around the array, then we also didn't find our key.
-        if (idx == start_idx)
-            return -1;
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+/**
+ * insert_hashed, checking the old table for the key too if the table is growing, and doing a bit
+ * of migration afterwards.
+ */
+static saeclib_error_e insert_checked(saeclib_hash_table_t* sht,
+                                      const void* key,
+                                      const void* value,
+                                      unsigned int hash)
+{
+    int stop_idx;
+    if ((sht->migrating != NULL) && (probe(sht->migrating, key, hash, &stop_idx) != -1))
+        return SAECLIB_ERROR_DUPLICATE_KEY;
+
+    begin_write(sht);
+    saeclib_error_e err = insert_hashed(sht, key, value, hash);
+
+    // if the new region has filled up, the keys that are left just stay where they are.
+    if (err == SAECLIB_ERROR_NOERROR)
+        migrate_some(sht, MIGRATE_BUCKETS_PER_OP);
+    end_write(sht);
+
+    return err;
+}
+
+
+saeclib_error_e saeclib_hash_insert(saeclib_hash_table_t* sht,
+                                    const void* key,
+                                    const void* value)
+{
+    return insert_checked(sht, key, value, sht->hash_fn(key));
+}
+
+
+/**
+ * Returns the index of the bucket containing a given key in the hash, and sets *table to the
+ * table that bucket belongs to, which is sht unless sht is growing and the key hasn't been
+ * migrated yet. If no bucket is found, returns -1.
+ */
+static int saeclib_hash_search_bucket_idx(saeclib_hash_table_t* sht,
+                                          const void* key,
+                                          unsigned int hash,
+                                          saeclib_hash_table_t** table)
+{
+    int stop_idx;
+    int idx = probe(sht, key, hash, &stop_idx);
+    *table = sht;
+
+    if ((idx == -1) && (sht->migrating != NULL)) {
+        idx = probe(sht->migrating, key, hash, &stop_idx);
+        *table = sht->migrating;
     }
 
     return idx;
@@ -133,67 +613,411 @@ saeclib_error_e saeclib_hash_search_ref(saeclib_hash_table_t* sht,
                                         const void* key,
                                         void** out)
 {
-    int bucket_idx = saeclib_hash_search_bucket_idx(sht, key);
+    saeclib_hash_table_t* table;
+    int bucket_idx = saeclib_hash_search_bucket_idx(sht, key, sht->hash_fn(key), &table);
     if (bucket_idx == -1)
         return SAECLIB_ERROR_UNDERFLOW;
 
-    *out = get_valptr_at_idx(sht, bucket_idx);
+    *out = get_valptr_at_idx(table, bucket_idx);
     return SAECLIB_ERROR_NOERROR;
 }
 
 
-saeclib_error_e saeclib_hash_delete(saeclib_hash_table_t* sht,
-                                    const void* key)
+saeclib_error_e saeclib_hash_search_optimistic(const saeclib_hash_table_t* sht,
+                                               const void* key,
+                                               void* out)
 {
-    int bucket_idx = saeclib_hash_search_bucket_idx(sht, key);
-    if (bucket_idx == -1)
-        return SAECLIB_ERROR_UNDERFLOW;
+    while (1) {
+        uint32_t seq = __atomic_load_n(&sht->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            // a write is in progress; back off rather than hammer the line the writer is using.
+            spin_pause();
+            continue;
+        }
+
+        // Work from a copy of the table struct, so that a grow can't change its fields under us.
+        // A copy that's torn by a grow is caught by the check below before anything is returned,
+        // and until then, every pointer in it still points into a valid region.
+        saeclib_hash_table_t snap;
+        memcpy(&snap, sht, sizeof(snap));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&sht->seq, __ATOMIC_RELAXED) != seq)
+            continue;
+
+        saeclib_hash_table_t* table;
+        const unsigned int hash = snap.hash_fn(key);
+        int idx = saeclib_hash_search_bucket_idx(&snap, key, hash, &table);
+        if (idx != -1)
+            memcpy(out, get_valptr_at_idx(table, idx), snap.value_elt_size);
 
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&sht->seq, __ATOMIC_RELAXED) == seq)
+            return (idx == -1) ? SAECLIB_ERROR_UNDERFLOW : SAECLIB_ERROR_NOERROR;
+    }
+}
+
+
+/**
+ * Empties bucket bucket_idx, compacting the hash chain after it.
+ */
+static void delete_at(saeclib_hash_table_t* sht, int bucket_idx)
+{
     int del_idx = bucket_idx;
     int rpl_idx = del_idx;
 
     while (1) {
         // linear probe to find the following index
-        rpl_idx = (rpl_idx + 1) % sht->capacity;
+        rpl_idx = next_idx(sht, rpl_idx);
 
         //
-        if (sht->bucket_filled[rpl_idx] != 1)
+        if (sht->bucket_filled[rpl_idx] == CTRL_EMPTY)
             break;
 
         // if we loop all the way back around to the start, we can stop
         if (rpl_idx == bucket_idx)
             break;
 
+        // with Robin Hood insertion, keys are ordered by home bucket, so nothing from a key that's
+        // already home onwards can be moved.
+        if ((sht->probe_dist != NULL) && (sht->probe_dist[rpl_idx] == 0))
+            break;
+
         // If the 'default' hash position for the replacement candidate falls outside the range
         // between the bucket to be deleted and the bucket from which it will be replaced, a hash
         // chain will broken. The hash chain must be compacted to preserve it.
         //
         // Note that this relies on the mathmatics of linear probing. Modification would be requred
         // for a different probing scheme.
-        int replacement_hash = sht->hash_fn(get_keyptr_at_idx(sht, rpl_idx)) % sht->capacity;
+        int replacement_hash = home_idx(sht, bucket_hash(sht, rpl_idx));
         if (rpl_idx < del_idx) {
             // handle wraparound case.
             if ((replacement_hash <= del_idx) && (replacement_hash > rpl_idx)) {
-                memcpy(get_keyptr_at_idx(sht, del_idx), get_keyptr_at_idx(sht, rpl_idx),
-                       sht->key_elt_size);
-                memcpy(get_valptr_at_idx(sht, del_idx), get_valptr_at_idx(sht, rpl_idx),
-                       sht->value_elt_size);
+                move_bucket(sht, del_idx, rpl_idx);
+                set_probe_dist(sht, del_idx, replacement_hash);
                 del_idx = rpl_idx;
             }
         } else {
             if ((replacement_hash <= del_idx) || (replacement_hash > rpl_idx)) {
-                memcpy(get_keyptr_at_idx(sht, del_idx), get_keyptr_at_idx(sht, rpl_idx),
-                       sht->key_elt_size);
-                memcpy(get_valptr_at_idx(sht, del_idx), get_valptr_at_idx(sht, rpl_idx),
-                       sht->value_elt_size);
+                move_bucket(sht, del_idx, rpl_idx);
+                set_probe_dist(sht, del_idx, replacement_hash);
                 del_idx = rpl_idx;
             }
         }
     }
 
     // at the end of this shuffle, del_idx points to a cell that can be deleted.
-    assert(sht->bucket_filled[del_idx] == 1);
-    sht->bucket_filled[del_idx] = 0;
+    assert(sht->bucket_filled[del_idx] & CTRL_FULL);
+    sht->bucket_filled[del_idx] = CTRL_EMPTY;
+}
+
+
+saeclib_error_e saeclib_hash_delete(saeclib_hash_table_t* sht,
+                                    const void* key)
+{
+    saeclib_hash_table_t* table;
+    int bucket_idx = saeclib_hash_search_bucket_idx(sht, key, sht->hash_fn(key), &table);
+    if (bucket_idx == -1)
+        return SAECLIB_ERROR_UNDERFLOW;
+
+    begin_write(sht);
+
+    // keys in the table we're migrating out of aren't moved around, just marked as gone.
+    if (table != sht) {
+        table->bucket_filled[bucket_idx] = CTRL_TOMBSTONE;
+    } else {
+        delete_at(sht, bucket_idx);
+    }
+
+    migrate_some(sht, MIGRATE_BUCKETS_PER_OP);
+    end_write(sht);
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_hash_table_grow(saeclib_hash_table_t* sht, saeclib_hash_table_t* newtable)
+{
+    if ((sht->migrating != NULL) || (newtable->migrating != NULL) ||
+        (newtable->capacity <= sht->capacity) ||
+        (newtable->key_elt_size != sht->key_elt_size) ||
+        (newtable->value_elt_size != sht->value_elt_size))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    // keys already in newtable would never be checked against the ones migrated in.
+    for (size_t i = 0; i < newtable->capacity; i++) {
+        if (newtable->bucket_filled[i] != CTRL_EMPTY)
+            return SAECLIB_ERROR_BAD_STRUCTURE;
+    }
+
+    begin_write(sht);
+
+    // sht's sequence number has to carry on through the swap. The old region's copy was taken
+    // halfway through this write, so its sequence number is odd; it's handed back even, as if the
+    // write had finished, so that it reads as idle if it's reused as a table of its own.
+    saeclib_hash_table_t old = *sht;
+    newtable->seq = sht->seq;
+    *sht = *newtable;
+    *newtable = old;
+    newtable->seq = old.seq + 1;
+
+    sht->migrating = newtable;
+    sht->migrate_pos = 0;
+
+    end_write(sht);
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_hash_table_migrate(saeclib_hash_table_t* sht, size_t nbuckets)
+{
+    begin_write(sht);
+    saeclib_error_e err = migrate_some(sht, nbuckets);
+    end_write(sht);
+
+    return err;
+}
+
+
+bool saeclib_hash_table_migrating(const saeclib_hash_table_t* sht)
+{
+    return (sht->migrating != NULL);
+}
+
+
+// How many keys the batch functions hash and prefetch before going back to probe them. Enough to
+// keep plenty of cache misses in flight without the prefetched lines being evicted again.
+#define BATCH_CHUNK 16
+
+// __builtin_prefetch needs its read/write argument to be a constant.
+#define PREFETCH(addr, write) \
+    ((write) ? __builtin_prefetch((addr), 1, 3) : __builtin_prefetch((addr), 0, 3))
+
+/**
+ * Hashes n keys (at most BATCH_CHUNK of them) into hashes[] and prefetches the parts of the table
+ * that probing their home buckets will touch first.
+ */
+static void hash_and_prefetch(saeclib_hash_table_t* sht,
+                              const uint8_t* keys,
+                              size_t n,
+                              unsigned int* hashes,
+                              bool write)
+{
+    for (size_t i = 0; i < n; i++) {
+        hashes[i] = sht->hash_fn(keys + (i * sht->key_elt_size));
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        size_t home = home_idx(sht, hashes[i]);
+        PREFETCH(&sht->bucket_filled[home], write);
+        PREFETCH(get_keyptr_at_idx(sht, home), write);
+        if (sht->hashes != NULL)
+            PREFETCH(&sht->hashes[home], write);
+        if (sht->probe_dist != NULL)
+            PREFETCH(&sht->probe_dist[home], write);
+    }
+}
+
+
+saeclib_error_e saeclib_hash_search_batch(saeclib_hash_table_t* sht,
+                                          const void* keys,
+                                          size_t n,
+                                          void* out,
+                                          uint64_t* found_mask)
+{
+    const uint8_t* key_bytes = keys;
+    uint8_t* out_bytes = out;
+    saeclib_error_e err = SAECLIB_ERROR_NOERROR;
+
+    for (size_t i = 0; i < ((n + 63) / 64); i++) {
+        found_mask[i] = 0;
+    }
+
+    for (size_t base = 0; base < n; base += BATCH_CHUNK) {
+        const size_t count = ((n - base) < BATCH_CHUNK) ? (n - base) : BATCH_CHUNK;
+        const uint8_t* chunk_keys = key_bytes + (base * sht->key_elt_size);
+        unsigned int hashes[BATCH_CHUNK];
+        int idxs[BATCH_CHUNK];
+
+        hash_and_prefetch(sht, chunk_keys, count, hashes, false);
+
+        // probe everything, and prefetch the values of the keys that were found before copying
+        // any of them out.
+        saeclib_hash_table_t* tables[BATCH_CHUNK];
+        for (size_t i = 0; i < count; i++) {
+            idxs[i] = saeclib_hash_search_bucket_idx(sht, chunk_keys + (i * sht->key_elt_size),
+                                                     hashes[i], &tables[i]);
+            if (idxs[i] != -1)
+                __builtin_prefetch(get_valptr_at_idx(tables[i], idxs[i]), 0, 3);
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            const size_t k = base + i;
+            if (idxs[i] == -1) {
+                err = SAECLIB_ERROR_UNDERFLOW;
+                continue;
+            }
+            memcpy(out_bytes + (k * sht->value_elt_size), get_valptr_at_idx(tables[i], idxs[i]),
+                   sht->value_elt_size);
+            found_mask[k / 64] |= ((uint64_t)1) << (k % 64);
+        }
+    }
+
+    return err;
+}
+
+
+saeclib_error_e saeclib_hash_insert_batch(saeclib_hash_table_t* sht,
+                                          const void* keys,
+                                          const void* values,
+                                          size_t n,
+                                          saeclib_error_e* errs)
+{
+    const uint8_t* key_bytes = keys;
+    const uint8_t* value_bytes = values;
+    saeclib_error_e first_err = SAECLIB_ERROR_NOERROR;
+
+    for (size_t base = 0; base < n; base += BATCH_CHUNK) {
+        const size_t count = ((n - base) < BATCH_CHUNK) ? (n - base) : BATCH_CHUNK;
+        unsigned int hashes[BATCH_CHUNK];
+
+        hash_and_prefetch(sht, key_bytes + (base * sht->key_elt_size), count, hashes, true);
+
+        for (size_t i = 0; i < count; i++) {
+            const size_t k = base + i;
+            saeclib_error_e err = insert_checked(sht, key_bytes + (k * sht->key_elt_size),
+                                                 value_bytes + (k * sht->value_elt_size),
+                                                 hashes[i]);
+            if (errs != NULL)
+                errs[k] = err;
+            if ((err != SAECLIB_ERROR_NOERROR) && (first_err == SAECLIB_ERROR_NOERROR))
+                first_err = err;
+        }
+    }
+
+    return first_err;
+}
+
+
+#if defined(__SSE2__)
+#define SCAN_GROUP 16
+#else
+#define SCAN_GROUP 8
+#endif
+
+/**
+ * Bit i is set if bucket idx + i is filled, for the SCAN_GROUP buckets starting at idx, which must
+ * all be inside the table. Filled buckets are the only ones with the top bit of their control byte
+ * set, so that's all that needs looking at.
+ */
+static inline uint32_t filled_group(const saeclib_hash_table_t* table, size_t idx)
+{
+#if defined(__SSE2__)
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(table->bucket_filled + idx)));
+#else
+    uint64_t w;
+    memcpy(&w, table->bucket_filled + idx, sizeof(w));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    // the multiply gathers bit 7 of byte i into bit 56 + i.
+    return (uint32_t)((((w >> 7) & 0x0101010101010101ull) * 0x0102040810204080ull) >> 56);
+#endif
+}
+
+
+/**
+ * Index of the first filled bucket at or after idx, or the table's capacity if there isn't one.
+ */
+static size_t next_filled(const saeclib_hash_table_t* table, size_t idx)
+{
+    for (; (idx + SCAN_GROUP) <= table->capacity; idx += SCAN_GROUP) {
+        uint32_t filled = filled_group(table, idx);
+        if (filled != 0)
+            return idx + __builtin_ctz(filled);
+    }
+    for (; idx < table->capacity; idx++) {
+        if (table->bucket_filled[idx] & CTRL_FULL)
+            return idx;
+    }
+    return idx;
+}
+
+
+/**
+ * Moves it to the first filled bucket at or after idx in it->table, going on to the region being
+ * migrated out of once it->table runs out.
+ */
+static saeclib_error_e iterator_seek(saeclib_hash_table_t* sht,
+                                     saeclib_hash_iterator_t* it,
+                                     size_t idx)
+{
+    while (1) {
+        it->idx = next_filled(it->table, idx);
+        if (it->idx < it->table->capacity)
+            return SAECLIB_ERROR_NOERROR;
+        if ((it->table != sht) || (sht->migrating == NULL))
+            return SAECLIB_ERROR_UNDERFLOW;
+
+        it->table = sht->migrating;
+        idx = 0;
+    }
+}
+
+
+saeclib_error_e saeclib_hash_iterator_init(saeclib_hash_table_t* sht, saeclib_hash_iterator_t* it)
+{
+    it->table = sht;
+    return iterator_seek(sht, it, 0);
+}
+
+
+saeclib_error_e saeclib_hash_iterator_next(saeclib_hash_table_t* sht, saeclib_hash_iterator_t* it)
+{
+    return iterator_seek(sht, it, it->idx + 1);
+}
+
+
+void* saeclib_hash_iterator_key(const saeclib_hash_iterator_t* it)
+{
+    return get_keyptr_at_idx(it->table, it->idx);
+}
+
+
+void* saeclib_hash_iterator_value(const saeclib_hash_iterator_t* it)
+{
+    return get_valptr_at_idx(it->table, it->idx);
+}
+
+
+/**
+ * saeclib_hash_for_each for a single region.
+ */
+static void for_each_in(saeclib_hash_table_t* table,
+                        void (*fn)(void* key, void* value, void* ctx),
+                        void* ctx)
+{
+    size_t idx = 0;
+    for (; (idx + SCAN_GROUP) <= table->capacity; idx += SCAN_GROUP) {
+        for (uint32_t filled = filled_group(table, idx); filled != 0; filled &= (filled - 1)) {
+            size_t i = idx + __builtin_ctz(filled);
+            fn(get_keyptr_at_idx(table, i), get_valptr_at_idx(table, i), ctx);
+        }
+    }
+    for (; idx < table->capacity; idx++) {
+        if (table->bucket_filled[idx] & CTRL_FULL)
+            fn(get_keyptr_at_idx(table, idx), get_valptr_at_idx(table, idx), ctx);
+    }
+}
+
+
+saeclib_error_e saeclib_hash_for_each(saeclib_hash_table_t* sht,
+                                      void (*fn)(void* key, void* value, void* ctx),
+                                      void* ctx)
+{
+    for_each_in(sht, fn, ctx);
+    if (sht->migrating != NULL)
+        for_each_in(sht->migrating, fn, ctx);
 
     return SAECLIB_ERROR_NOERROR;
 }
@@ -211,6 +1035,18 @@ int saeclib_hash_table_u32_cmp(const void* a, const void* b)
     return 0;
 }
 
+int saeclib_hash_table_u64_cmp(const void* a, const void* b)
+{
+    if (*((uint64_t*)a) > *((uint64_t*)b)) return 1;
+    if (*((uint64_t*)a) < *((uint64_t*)b)) return -1;
+    return 0;
+}
+
+int saeclib_hash_table_u128_cmp(const void* a, const void* b)
+{
+    return memcmp(a, b, 16);
+}
+
 // This is not mine, it is a famous public-domain code snippet from sdbm
 unsigned int saeclib_hash_table_str_hash(const void* a)
 {
@@ -1,6 +1,7 @@
 #ifndef _SAECLIB_HASH_H
 #define _SAECLIB_HASH_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 #include "saeclib_error.h"
@@ -13,21 +14,51 @@
  * much work when open addressing works perfectly fine.
  */
 
+// Bit that's set in the control byte (bucket_filled) of every bucket that holds a key.
+#define SAECLIB_HASH_CTRL_FULL 0x80
+
+/**
+ * Kinds of key that the table compares inline instead of calling cmp. A table picks its kind when
+ * it's initialized, from its key size and compare function: saeclib_hash_table_u32_cmp,
+ * saeclib_hash_table_u64_cmp and saeclib_hash_table_u128_cmp with keys of 4, 8 and 16 bytes. Any
+ * other compare function, even one that does the same thing, makes a generic table.
+ */
+typedef enum saeclib_hash_key_kind
+{
+    SAECLIB_HASH_KEY_GENERIC = 0,
+    SAECLIB_HASH_KEY_U32,
+    SAECLIB_HASH_KEY_U64,
+    SAECLIB_HASH_KEY_U128
+} saeclib_hash_key_kind_e;
+
 typedef struct saeclib_hash_table
 {
     // Pointer to the memory region that holds keys and values respectively for this hash table.
     uint8_t* key_data;
     uint8_t* value_data;
 
-    // Array of bools; each entry records whether an entry is nil (0), filled (1), or deleted (2).
-    // Note that at the moment, we don't use deleted entries.
-    // This could be implemented with a bitpacked array, but I've chosen for the time being to
-    // just use bytes.
+    // One control byte per bucket. 0 means that the bucket is empty. A filled bucket has its top
+    // bit set and 7 bits of its key's hash in the low bits, so most mismatched keys can be ruled
+    // out without calling cmp, and 16 buckets can be checked at once with SSE2. While a table is
+    // being migrated out of (see saeclib_hash_table_grow), 1 marks a key that's been moved or
+    // deleted.
+    // Zeroed memory is an empty table.
     uint8_t* bucket_filled;
 
+    // If Robin Hood insertion is enabled, how far each filled bucket is from its key's home bucket.
+    // NULL otherwise.
+    uint8_t* probe_dist;
+
+    // If the hash cache is enabled, the full hash of the key in each filled bucket. NULL otherwise.
+    unsigned int* hashes;
+
     // How many elements can be stored in the hash table.
     size_t capacity;
 
+    // capacity - 1 for tables initialized with saeclib_hash_table_init_pow2, 0 otherwise. Those
+    // tables mix the user's hash and mask it to find a key's home bucket instead of dividing.
+    size_t mask;
+
     // How many bytes is each element?
     size_t key_elt_size;
     size_t value_elt_size;
@@ -39,6 +70,19 @@ typedef struct saeclib_hash_table
     // Compare function for the keys stored within the hash.
     // It should return 0 if they are equal and non-zero if they are not.
     int (*cmp)(const void*, const void*);
+
+    // Set from key_elt_size and cmp at init. For anything but SAECLIB_HASH_KEY_GENERIC, probes
+    // compare keys directly and never call cmp.
+    saeclib_hash_key_kind_e key_kind;
+
+    // While the table is growing, the table that keys are still being migrated out of, and the
+    // next of its buckets to migrate. NULL otherwise.
+    struct saeclib_hash_table* migrating;
+    size_t migrate_pos;
+
+    // Odd while the table is being modified, and bumped again once it's done. Only used so that
+    // saeclib_hash_search_optimistic can tell whether a write overlapped its read.
+    uint32_t seq;
 } saeclib_hash_table_t;
 
 /**
@@ -114,6 +158,111 @@ saeclib_error_e saeclib_hash_table_init(saeclib_hash_table_t* sht,
       sht; \
       })
 
+/**
+ * Same as saeclib_hash_table_init, but for a table whose capacity is a power of two. Home buckets
+ * are found by running the user's hash through a finalizer and masking it, which is much cheaper
+ * than the division the plain table uses, and stops weak hashes like saeclib_hash_table_u32_hash
+ * from piling sequential or strided keys up into long runs.
+ *
+ * @return SAECLIB_ERROR_BAD_STRUCTURE if keyspace_size / key_size isn't a power of two of at least 2.
+ */
+saeclib_error_e saeclib_hash_table_init_pow2(saeclib_hash_table_t* sht,
+                                             void* keyspace,
+                                             void* valuespace,
+                                             void* bucketspace,
+                                             size_t keyspace_size,
+                                             size_t key_size,
+                                             size_t value_size,
+                                             unsigned int (*hash_fn)(const void*),
+                                             int (*cmp)(const void*, const void*));
+
+/**
+ * Smallest power of two that's at least n. Usable in array sizes.
+ */
+#define SAECLIB_NEXT_POW2(n) \
+    ((size_t)1 << (((n) <= 1) ? 0 : (64 - __builtin_clzll((unsigned long long)(n) - 1))))
+
+/**
+ * Same as saeclib_hash_table_salloc, but rounds capacity up to a power of two and calls
+ * saeclib_hash_table_init_pow2.
+ */
+#define saeclib_hash_table_pow2_salloc(capacity, keysize, valuesize, hash_fn, cmp) \
+    ({ \
+    saeclib_hash_table_t sht; \
+    static uint8_t keyspace[SAECLIB_NEXT_POW2(capacity) * (keysize)] = { 0 };     \
+    static uint8_t valuespace[SAECLIB_NEXT_POW2(capacity) * (valuesize)] = { 0 }; \
+    static uint8_t status[SAECLIB_NEXT_POW2(capacity)] = { 0 };                   \
+    saeclib_hash_table_init_pow2(&sht, keyspace, valuespace, status, sizeof(keyspace), \
+                                 keysize, valuesize, hash_fn, cmp);                    \
+    sht; \
+    })
+
+
+/**
+ * Switches an empty hash table over to Robin Hood insertion. Keys that are further from their home
+ * bucket take the place of keys that are closer to theirs, which keeps probe sequences short and
+ * even, and a failed search can stop as soon as it reaches a key that's closer to its home bucket
+ * than the missing key would be.
+ *
+ * @param[in,out] sht       Empty hash table.
+ * @param[in]     distspace Pointer to a statically allocated memory region with room for one byte
+ *                          per bucket. Should be 'capacity' bytes.
+ *
+ * @return SAECLIB_ERROR_BAD_STRUCTURE if the hash table isn't empty.
+ *
+ * Once enabled, an insert that would leave a key more than 255 buckets from its home bucket fails
+ * with SAECLIB_ERROR_OVERFLOW, even if there's space left in the table.
+ */
+saeclib_error_e saeclib_hash_table_enable_robin_hood(saeclib_hash_table_t* sht, uint8_t* distspace);
+
+/**
+ * Makes the hash table keep the full hash of every key it holds. Searches then compare hashes
+ * before calling cmp, and deletes never need to call hash_fn on the keys that they move, which
+ * saves a lot of pointer chasing for keys like strings. Keys already in the table are hashed once
+ * here.
+ *
+ * @param[in,out] sht       Hash table.
+ * @param[in]     hashspace Pointer to a statically allocated memory region with room for one
+ *                          unsigned int per bucket. Should be 'capacity * sizeof(unsigned int)'
+ *                          bytes.
+ */
+saeclib_error_e saeclib_hash_table_enable_hash_cache(saeclib_hash_table_t* sht,
+                                                     unsigned int* hashspace);
+
+/**
+ * Starts growing a hash table into a bigger memory region, without stopping to rehash everything
+ * at once. Every insert and delete moves a few of the old buckets' keys into the new region, and
+ * until they've all been moved, searches look in both.
+ *
+ * @param[in,out] sht       Hash table to grow.
+ * @param[in,out] newtable  An empty hash table with more capacity, initialized on the bigger region
+ *                          with the same key size, value size, hash_fn and cmp. It may have its own
+ *                          options (Robin Hood insertion, hash cache). sht takes it over, and
+ *                          newtable is left holding the old region. newtable must stay valid until
+ *                          migration is done; after that, it's an empty table again that can be
+ *                          used as it is, optimistic searches included, or have its memory reused.
+ *
+ * @return SAECLIB_ERROR_BAD_STRUCTURE if sht is already growing, or newtable isn't empty, is
+ *         growing itself, isn't bigger or doesn't have the same key and value sizes.
+ *
+ * To be sure that migration finishes before the new region fills up, grow into at least twice the
+ * capacity. Searches never migrate keys, so a table that's only ever searched stays migrating
+ * unless saeclib_hash_table_migrate is called.
+ */
+saeclib_error_e saeclib_hash_table_grow(saeclib_hash_table_t* sht, saeclib_hash_table_t* newtable);
+
+/**
+ * Migrates up to nbuckets more of the old region's buckets while a hash table is growing, for
+ * instance from an idle loop. Pass SIZE_MAX to finish migrating right away.
+ *
+ * @return SAECLIB_ERROR_OVERFLOW if the new region is full. Otherwise SAECLIB_ERROR_NOERROR.
+ */
+saeclib_error_e saeclib_hash_table_migrate(saeclib_hash_table_t* sht, size_t nbuckets);
+
+/**
+ * Returns true while a hash table is growing.
+ */
+bool saeclib_hash_table_migrating(const saeclib_hash_table_t* sht);
 
 /**
  * Inserts a new key-value pair into the hash.
@@ -146,11 +295,134 @@ saeclib_error_e saeclib_hash_search_ref(saeclib_hash_table_t* sht,
 saeclib_error_e saeclib_hash_delete(saeclib_hash_table_t* sht,
                                     const void* key);
 
+/**
+ * Same as saeclib_hash_search, but safe to call from any number of threads while one other thread
+ * writes to the table, without any locks. The search runs without synchronizing with the writer,
+ * then checks the table's sequence counter to see whether anything was written in the meantime,
+ * and if so, tries again. Readers never write to shared memory, so they don't slow each other
+ * down.
+ *
+ * Keys can be moved around by the writer (for instance, by the backward shift in
+ * saeclib_hash_delete) while hash_fn and cmp are looking at them, so hash_fn and cmp must be
+ * able to cope with a key that's half written. The result is thrown away in that case, but they
+ * mustn't crash: plain-data keys are fine, while for keys that are pointers, like the strings
+ * used with saeclib_hash_table_str_cmp, the writer mustn't free anything that a key in the table
+ * might have pointed to since the reader started.
+ *
+ * The table's memory regions must stay mapped while readers use them, including the region a
+ * growing table is migrating out of.
+ *
+ * out may be written to by an attempt that gets thrown away, even if the key turns out not to be
+ * there.
+ *
+ * The writer uses the ordinary functions; saeclib_hash_search_ref's pointer can't be used to
+ * modify a value without the readers seeing a half-written value, though.
+ */
+saeclib_error_e saeclib_hash_search_optimistic(const saeclib_hash_table_t* sht,
+                                               const void* key,
+                                               void* out);
+
+/**
+ * Looks up n keys at once. All of the keys are hashed and their home buckets prefetched before
+ * any of them are probed, so that when the table is too big for the cache, the memory accesses for
+ * different keys overlap instead of stalling one after the other.
+ *
+ * @param[in]     sht         Hash table to search.
+ * @param[in]     keys        n keys, packed one after the other.
+ * @param[in]     n           Number of keys.
+ * @param[out]    out         Room for n values. Values for keys that aren't found are left alone.
+ * @param[out]    found_mask  Bit (i % 64) of found_mask[i / 64] is set if keys[i] was found and
+ *                            cleared otherwise. Should have room for (n + 63) / 64 words.
+ *
+ * @return SAECLIB_ERROR_NOERROR if every key was found, SAECLIB_ERROR_UNDERFLOW otherwise.
+ */
+saeclib_error_e saeclib_hash_search_batch(saeclib_hash_table_t* sht,
+                                          const void* keys,
+                                          size_t n,
+                                          void* out,
+                                          uint64_t* found_mask);
+
+/**
+ * Inserts n key-value pairs, prefetching their home buckets first like saeclib_hash_search_batch.
+ * The keys are inserted in order, so if the same key appears twice, the second one is a duplicate.
+ *
+ * @param[in]     sht         Hash table to insert into.
+ * @param[in]     keys        n keys, packed one after the other.
+ * @param[in]     values      n values, packed one after the other.
+ * @param[in]     n           Number of key-value pairs.
+ * @param[out]    errs        What saeclib_hash_insert would have returned for each pair. May be
+ *                            NULL.
+ *
+ * @return SAECLIB_ERROR_NOERROR if every pair was inserted, otherwise the first error.
+ */
+saeclib_error_e saeclib_hash_insert_batch(saeclib_hash_table_t* sht,
+                                          const void* keys,
+                                          const void* values,
+                                          size_t n,
+                                          saeclib_error_e* errs);
+
+/**
+ * Iterates over the key-value pairs in a hash table, in no particular order, including the ones
+ * still in the old region of a growing table.
+ *
+ * Filled buckets are found by scanning the top bit of the control bytes 16 (with SSE2) or 8 at a
+ * time, so runs of empty buckets are skipped quickly and keys and values are only touched for
+ * filled buckets.
+ *
+ * The table mustn't be inserted into or deleted from while it's being iterated over, since both
+ * can move keys around; values can be modified in place through saeclib_hash_iterator_value.
+ */
+typedef struct saeclib_hash_iterator
+{
+    // region that idx is in: the table itself, or the region a growing table is migrating out of.
+    saeclib_hash_table_t* table;
+    size_t idx;
+} saeclib_hash_iterator_t;
+
+/**
+ * Points an iterator at the first key-value pair in a hash table.
+ *
+ * @return SAECLIB_ERROR_UNDERFLOW if the hash table is empty.
+ */
+saeclib_error_e saeclib_hash_iterator_init(saeclib_hash_table_t* sht, saeclib_hash_iterator_t* it);
+
+/**
+ * Moves an iterator on to the next key-value pair.
+ *
+ * @return SAECLIB_ERROR_UNDERFLOW if there are no more.
+ */
+saeclib_error_e saeclib_hash_iterator_next(saeclib_hash_table_t* sht, saeclib_hash_iterator_t* it);
+
+/**
+ * Pointers to the key and value that an iterator points at, in the table's own memory.
+ */
+void* saeclib_hash_iterator_key(const saeclib_hash_iterator_t* it);
+void* saeclib_hash_iterator_value(const saeclib_hash_iterator_t* it);
+
+/**
+ * Calls fn on every key-value pair in a hash table, in no particular order. This is quicker than
+ * an iterator, since the control bytes for a whole group of buckets are only looked at once.
+ *
+ * @param[in,out] sht       Hash table. The same restrictions apply as for iterators.
+ * @param[in]     fn        Called with pointers to the key and value in the table's own memory,
+ *                          and ctx.
+ * @param[in]     ctx       Passed through to fn.
+ */
+saeclib_error_e saeclib_hash_for_each(saeclib_hash_table_t* sht,
+                                      void (*fn)(void* key, void* value, void* ctx),
+                                      void* ctx);
+
 ////////////////////////////////////////////////////////////////
 // courtesy hash and compare functions for u32 and string
 unsigned int saeclib_hash_table_u32_hash(const void* a);
 int saeclib_hash_table_u32_cmp(const void* a, const void* b);
 
+// compare functions for uint64_t keys and 16 byte keys, like UUIDs or IPv6 addresses, which are
+// compared as plain bytes. saeclib_hash_u64 and SAECLIB_DEFINE_BYTES_HASH from
+// saeclib_hash_functions.h make hash functions for them.
+int saeclib_hash_table_u64_cmp(const void* a, const void* b);
+int saeclib_hash_table_u128_cmp(const void* a, const void* b);
+
 unsigned int saeclib_hash_table_str_hash(const void* a);
 int saeclib_hash_table_str_cmp(const void* a, const void* b);
 
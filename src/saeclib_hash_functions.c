@@ -0,0 +1,135 @@
+#include "saeclib_hash_functions.h"
+
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define SAECLIB_CRC32C_X86 1
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+unsigned int saeclib_hash_u32(const void* key)
+{
+    uint32_t k;
+    memcpy(&k, key, sizeof(k));
+    return (unsigned int)saeclib_hash_mix64(k);
+}
+
+
+unsigned int saeclib_hash_u64(const void* key)
+{
+    uint64_t k;
+    memcpy(&k, key, sizeof(k));
+    return (unsigned int)saeclib_hash_mix64(k);
+}
+
+
+uint64_t saeclib_hash_cstr(const char* str, uint64_t seed)
+{
+    return saeclib_hash_bytes(str, strlen(str), seed);
+}
+
+
+unsigned int saeclib_hash_str(const void* key)
+{
+    return (unsigned int)saeclib_hash_cstr(*((const char* const*)key), 0);
+}
+
+
+////////////////////////////////////////////////////////////////
+// CRC32C
+
+// Reflected Castagnoli polynomial.
+#define CRC32C_POLY 0x82f63b78u
+
+static uint32_t crc32c_table[256];
+static bool crc32c_table_ready = false;
+
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t* p, size_t len)
+{
+    // Filling the table twice from two threads is harmless, since both write the same values.
+    if (!__atomic_load_n(&crc32c_table_ready, __ATOMIC_ACQUIRE)) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c >> 1) ^ ((c & 1) ? CRC32C_POLY : 0);
+            }
+            crc32c_table[i] = c;
+        }
+        __atomic_store_n(&crc32c_table_ready, true, __ATOMIC_RELEASE);
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        crc = crc32c_table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(SAECLIB_CRC32C_X86)
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const uint8_t* p, size_t len)
+{
+#if defined(__x86_64__)
+    uint64_t c = crc;
+    for (; len >= 8; len -= 8, p += 8) {
+        c = _mm_crc32_u64(c, saeclib_hash_read64(p));
+    }
+    crc = (uint32_t)c;
+#endif
+    for (; len >= 4; len -= 4, p += 4) {
+        crc = _mm_crc32_u32(crc, (uint32_t)saeclib_hash_read32(p));
+    }
+    for (; len > 0; len--, p++) {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+    return crc;
+}
+#elif defined(__ARM_FEATURE_CRC32)
+static uint32_t crc32c_hw(uint32_t crc, const uint8_t* p, size_t len)
+{
+    for (; len >= 8; len -= 8, p += 8) {
+        crc = __crc32cd(crc, saeclib_hash_read64(p));
+    }
+    for (; len > 0; len--, p++) {
+        crc = __crc32cb(crc, *p);
+    }
+    return crc;
+}
+#endif
+
+typedef uint32_t (*crc32c_fn_t)(uint32_t, const uint8_t*, size_t);
+
+static crc32c_fn_t crc32c_select(void)
+{
+#if defined(SAECLIB_CRC32C_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2"))
+        return crc32c_hw;
+    return crc32c_sw;
+#elif defined(__ARM_FEATURE_CRC32)
+    return crc32c_hw;
+#else
+    return crc32c_sw;
+#endif
+}
+
+
+uint32_t saeclib_crc32c(uint32_t crc, const void* data, size_t len)
+{
+    static crc32c_fn_t impl = NULL;
+
+    crc32c_fn_t fn = __atomic_load_n(&impl, __ATOMIC_RELAXED);
+    if (fn == NULL) {
+        fn = crc32c_select();
+        __atomic_store_n(&impl, fn, __ATOMIC_RELAXED);
+    }
+
+    return ~fn(~crc, data, len);
+}
+
+
+unsigned int saeclib_hash_crc32c_u32(const void* key)
+{
+    return saeclib_crc32c(0, key, sizeof(uint32_t));
+}
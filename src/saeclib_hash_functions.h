@@ -0,0 +1,155 @@
+#ifndef _SAECLIB_HASH_FUNCTIONS_H
+#define _SAECLIB_HASH_FUNCTIONS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Fast, well-distributed hash functions to use with saeclib's hash tables in place of the courtesy
+ * functions in saeclib_hash.h.
+ *
+ * The functions with the (const void*) -> unsigned int signature can be passed straight to
+ * saeclib_hash_table_init as hash_fn.
+ */
+
+/**
+ * 64-bit finalizer (the one from splitmix64). Every input bit affects every output bit.
+ */
+static inline uint64_t saeclib_hash_mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * Multiplies a and b into 128 bits and folds the halves together. This is what gives the bytes
+ * hash its speed: one multiply mixes 16 bytes of input.
+ */
+static inline uint64_t saeclib_hash_mum(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    // 32-bit targets don't have a 64x64->128 multiply; build it out of four 32x32->64 ones.
+    uint64_t ha = a >> 32, la = (uint32_t)a, hb = b >> 32, lb = (uint32_t)b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = (t < rl);
+    uint64_t lo = t + (rm1 << 32);
+    c += (lo < t);
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    return lo ^ hi;
+#endif
+}
+
+static inline uint64_t saeclib_hash_read64(const uint8_t* p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t saeclib_hash_read32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+/**
+ * Hashes len bytes, 16 at a time, in the style of wyhash. It's static inline so that when len is
+ * a constant, like the key size of a hash table, the compiler can throw away the branches that
+ * don't apply and unroll the loop.
+ *
+ * Different lengths of the same bytes (for instance, runs of zeros) hash differently.
+ */
+static inline uint64_t saeclib_hash_bytes(const void* data, size_t len, uint64_t seed)
+{
+    const uint64_t k0 = 0xa0761d6478bd642full;
+    const uint64_t k1 = 0xe7037ed1a0b428dbull;
+    const uint8_t* p = data;
+
+    uint64_t a, b;
+    seed ^= saeclib_hash_mum(seed ^ k0, len ^ k1);
+
+    if (len <= 16) {
+        if (len >= 8) {
+            a = saeclib_hash_read64(p);
+            b = saeclib_hash_read64(p + len - 8);
+        } else if (len >= 4) {
+            a = saeclib_hash_read32(p);
+            b = saeclib_hash_read32(p + len - 4);
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        while (i > 16) {
+            seed = saeclib_hash_mum(saeclib_hash_read64(p) ^ k1,
+                                    saeclib_hash_read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        // the last 16 bytes, which may overlap bytes that have already been hashed.
+        a = saeclib_hash_read64(p + i - 16);
+        b = saeclib_hash_read64(p + i - 8);
+    }
+
+    return saeclib_hash_mum(k1 ^ len, saeclib_hash_mum(a ^ k1, b ^ seed));
+}
+
+/**
+ * Defines a hash_fn called name for keys that are size bytes long.
+ *
+ * Example usage:
+ *     SAECLIB_DEFINE_BYTES_HASH(point_hash, sizeof(point_t))
+ *     saeclib_hash_table_t sht = saeclib_hash_table_salloc(1024, sizeof(point_t), 4, point_hash,
+ *                                                          point_cmp);
+ */
+#define SAECLIB_DEFINE_BYTES_HASH(name, size)                         \
+    static unsigned int name(const void* key)                         \
+    {                                                                 \
+        return (unsigned int)saeclib_hash_bytes(key, (size), 0);      \
+    }
+
+/**
+ * hash_fn for uint32_t and uint64_t keys.
+ */
+unsigned int saeclib_hash_u32(const void* key);
+unsigned int saeclib_hash_u64(const void* key);
+
+/**
+ * hash_fn for string keys, stored as char* like the keys for saeclib_hash_table_str_hash.
+ */
+unsigned int saeclib_hash_str(const void* key);
+
+/**
+ * Hashes a nul-terminated string. The string's length goes into the hash.
+ */
+uint64_t saeclib_hash_cstr(const char* str, uint64_t seed);
+
+/**
+ * Computes the CRC32C (Castagnoli) of len bytes, carrying on from crc. Pass 0 to start a new CRC.
+ *
+ * On x86, the SSE4.2 crc32 instruction is used if cpuid says the processor has it; this is
+ * checked once, on the first call. On ARM, the CRC32 instructions are used if the compiler is
+ * allowed to generate them. Otherwise, a table is used.
+ */
+uint32_t saeclib_crc32c(uint32_t crc, const void* data, size_t len);
+
+/**
+ * hash_fn for uint32_t keys using CRC32C. It's not as well mixed as saeclib_hash_u32, but with
+ * hardware support it costs a single instruction.
+ */
+unsigned int saeclib_hash_crc32c_u32(const void* key);
+
+#endif
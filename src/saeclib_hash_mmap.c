@@ -0,0 +1,246 @@
+#include "saeclib_hash_mmap.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Every section of the file starts at a multiple of this, so that it's page-aligned once mapped.
+#define SECTION_ALIGN 4096
+
+#define FILE_MAGIC   "SAECHTBL"
+#define FILE_VERSION 1
+
+// Written as a native uint32_t; reads back differently on a machine with the other byte order.
+#define BYTE_ORDER_MARK 0x01020304u
+
+#define FLAG_ROBIN_HOOD (1u << 0)
+#define FLAG_HASH_CACHE (1u << 1)
+#define FLAG_HAS_CHECK  (1u << 2)
+
+typedef struct file_header
+{
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint32_t flags;
+
+    // hash of the key in bucket check_idx when the table was written, if FLAG_HAS_CHECK is set.
+    uint32_t check_hash;
+    uint64_t check_idx;
+
+    uint64_t capacity;
+    uint64_t mask;
+    uint64_t key_size;
+    uint64_t value_size;
+
+    // file offsets of each section, or 0 for sections the table doesn't have.
+    uint64_t ctrl_off;
+    uint64_t key_off;
+    uint64_t value_off;
+    uint64_t dist_off;
+    uint64_t hash_off;
+} file_header_t;
+
+
+static uint64_t align_up(uint64_t n)
+{
+    return (n + SECTION_ALIGN - 1) & ~(uint64_t)(SECTION_ALIGN - 1);
+}
+
+
+static saeclib_error_e write_all(int fd, const void* buf, size_t len)
+{
+    const uint8_t* p = buf;
+    while (len > 0) {
+        ssize_t ret = write(fd, p, len);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return SAECLIB_ERROR_IO;
+        }
+        p += ret;
+        len -= ret;
+    }
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+/**
+ * Writes len bytes of section data at file offset *pos, after zeros to get from *pos up to off.
+ */
+static saeclib_error_e write_section(int fd, uint64_t* pos, uint64_t off, const void* data,
+                                     size_t len)
+{
+    static const uint8_t zeros[SECTION_ALIGN];
+    if (write_all(fd, zeros, off - *pos) != SAECLIB_ERROR_NOERROR)
+        return SAECLIB_ERROR_IO;
+    if (write_all(fd, data, len) != SAECLIB_ERROR_NOERROR)
+        return SAECLIB_ERROR_IO;
+
+    *pos = off + len;
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_hash_mmap_write(const saeclib_hash_table_t* sht, int fd)
+{
+    if (sht->migrating != NULL)
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    const size_t capacity = sht->capacity;
+    const size_t key_len = capacity * sht->key_elt_size;
+    const size_t value_len = capacity * sht->value_elt_size;
+    const size_t hash_len = capacity * sizeof(unsigned int);
+
+    file_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, FILE_MAGIC, sizeof(hdr.magic));
+    hdr.byte_order = BYTE_ORDER_MARK;
+    hdr.version = FILE_VERSION;
+    hdr.capacity = capacity;
+    hdr.mask = sht->mask;
+    hdr.key_size = sht->key_elt_size;
+    hdr.value_size = sht->value_elt_size;
+
+    hdr.ctrl_off = align_up(sizeof(hdr));
+    hdr.key_off = align_up(hdr.ctrl_off + capacity);
+    hdr.value_off = align_up(hdr.key_off + key_len);
+    uint64_t end = hdr.value_off + value_len;
+    if (sht->probe_dist != NULL) {
+        hdr.flags |= FLAG_ROBIN_HOOD;
+        hdr.dist_off = align_up(end);
+        end = hdr.dist_off + capacity;
+    }
+    if (sht->hashes != NULL) {
+        hdr.flags |= FLAG_HASH_CACHE;
+        hdr.hash_off = align_up(end);
+    }
+
+    for (size_t i = 0; i < capacity; i++) {
+        if (sht->bucket_filled[i] & SAECLIB_HASH_CTRL_FULL) {
+            hdr.flags |= FLAG_HAS_CHECK;
+            hdr.check_idx = i;
+            hdr.check_hash = sht->hash_fn(sht->key_data + (i * sht->key_elt_size));
+            break;
+        }
+    }
+
+    uint64_t pos = 0;
+    saeclib_error_e err = write_section(fd, &pos, 0, &hdr, sizeof(hdr));
+    if (err == SAECLIB_ERROR_NOERROR)
+        err = write_section(fd, &pos, hdr.ctrl_off, sht->bucket_filled, capacity);
+    if (err == SAECLIB_ERROR_NOERROR)
+        err = write_section(fd, &pos, hdr.key_off, sht->key_data, key_len);
+    if (err == SAECLIB_ERROR_NOERROR)
+        err = write_section(fd, &pos, hdr.value_off, sht->value_data, value_len);
+    if ((err == SAECLIB_ERROR_NOERROR) && (hdr.flags & FLAG_ROBIN_HOOD))
+        err = write_section(fd, &pos, hdr.dist_off, sht->probe_dist, capacity);
+    if ((err == SAECLIB_ERROR_NOERROR) && (hdr.flags & FLAG_HASH_CACHE))
+        err = write_section(fd, &pos, hdr.hash_off, sht->hashes, hash_len);
+
+    return err;
+}
+
+
+/**
+ * true if a section of len bytes at off fits in a file of file_len bytes.
+ */
+static bool section_fits(uint64_t off, uint64_t len, uint64_t file_len)
+{
+    return (off >= sizeof(file_header_t)) && (off <= file_len) && (len <= (file_len - off));
+}
+
+
+static saeclib_error_e check_header(const file_header_t* hdr, uint64_t file_len)
+{
+    if ((memcmp(hdr->magic, FILE_MAGIC, sizeof(hdr->magic)) != 0) ||
+        (hdr->byte_order != BYTE_ORDER_MARK) || (hdr->version != FILE_VERSION))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    const uint64_t capacity = hdr->capacity;
+    if ((capacity == 0) || (hdr->key_size == 0) ||
+        ((hdr->mask != 0) && ((hdr->mask != (capacity - 1)) || (capacity & (capacity - 1)))))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    // sizes are checked by dividing so that a corrupt header can't overflow them.
+    if (((file_len / hdr->key_size) < capacity) ||
+        ((hdr->value_size != 0) && ((file_len / hdr->value_size) < capacity)))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    if (!section_fits(hdr->ctrl_off, capacity, file_len) ||
+        !section_fits(hdr->key_off, capacity * hdr->key_size, file_len) ||
+        !section_fits(hdr->value_off, capacity * hdr->value_size, file_len))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+    if ((hdr->flags & FLAG_ROBIN_HOOD) && !section_fits(hdr->dist_off, capacity, file_len))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+    if ((hdr->flags & FLAG_HASH_CACHE) &&
+        !section_fits(hdr->hash_off, capacity * sizeof(unsigned int), file_len))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+    if ((hdr->flags & FLAG_HAS_CHECK) && (hdr->check_idx >= capacity))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_hash_mmap_open(saeclib_hash_mmap_t* map,
+                                       saeclib_hash_table_t* sht,
+                                       int fd,
+                                       unsigned int (*hash_fn)(const void*),
+                                       int (*cmp)(const void*, const void*))
+{
+    map->base = NULL;
+    map->len = 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return SAECLIB_ERROR_IO;
+    if ((uint64_t)st.st_size < sizeof(file_header_t))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED)
+        return SAECLIB_ERROR_IO;
+    map->base = base;
+    map->len = st.st_size;
+
+    const file_header_t* hdr = base;
+    saeclib_error_e err = check_header(hdr, st.st_size);
+    if (err != SAECLIB_ERROR_NOERROR) {
+        saeclib_hash_mmap_close(map);
+        return err;
+    }
+
+    uint8_t* bytes = base;
+    saeclib_hash_table_init(sht, bytes + hdr->key_off, bytes + hdr->value_off,
+                            bytes + hdr->ctrl_off, hdr->capacity * hdr->key_size, hdr->key_size,
+                            hdr->value_size, hash_fn, cmp);
+    sht->mask = hdr->mask;
+    if (hdr->flags & FLAG_ROBIN_HOOD)
+        sht->probe_dist = bytes + hdr->dist_off;
+    if (hdr->flags & FLAG_HASH_CACHE)
+        sht->hashes = (unsigned int*)(bytes + hdr->hash_off);
+
+    if ((hdr->flags & FLAG_HAS_CHECK) &&
+        (hash_fn(sht->key_data + (hdr->check_idx * hdr->key_size)) != hdr->check_hash)) {
+        saeclib_hash_mmap_close(map);
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+    }
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_hash_mmap_close(saeclib_hash_mmap_t* map)
+{
+    if (map->base == NULL)
+        return SAECLIB_ERROR_NOERROR;
+
+    int ret = munmap(map->base, map->len);
+    map->base = NULL;
+    map->len = 0;
+
+    return (ret == 0) ? SAECLIB_ERROR_NOERROR : SAECLIB_ERROR_IO;
+}
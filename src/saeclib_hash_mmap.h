@@ -0,0 +1,80 @@
+#ifndef _SAECLIB_HASH_MMAP_H
+#define _SAECLIB_HASH_MMAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "saeclib_error.h"
+#include "saeclib_hash.h"
+
+/**
+ * Saves a saeclib_hash_table_t to a file, and loads it back by mapping the file into memory, with
+ * the table's buckets used in place. Loading is just an mmap and a few checks, however big the
+ * table is, and every process that maps the same file shares its pages in the page cache.
+ *
+ * The file holds a header followed by the table's control bytes, keys, values, and Robin Hood
+ * distances and cached hashes if the table has them, each at a page-aligned offset. Offsets are
+ * relative to the start of the file, so the format doesn't depend on where the file is mapped.
+ * Numbers are stored in the byte order of the machine that wrote them; a file from a machine with
+ * the other byte order is rejected.
+ *
+ * Keys and values are written byte for byte, so they must be plain data: a key that's a pointer,
+ * like the strings used with saeclib_hash_table_str_cmp, means nothing in another process. The
+ * table must be loaded with the same hash function that it was built with; the loader checks this
+ * by rehashing one key.
+ *
+ * A loaded table is read-only. It can be searched (with saeclib_hash_search, search_ref,
+ * search_batch and search_optimistic) and iterated over, but not inserted into or deleted from,
+ * and values mustn't be written through the pointers that search_ref and iterators give out.
+ *
+ * This is a hosted-only (POSIX) part of saeclib.
+ */
+
+typedef struct saeclib_hash_mmap
+{
+    // the whole file, as mapped.
+    void* base;
+    size_t len;
+} saeclib_hash_mmap_t;
+
+/**
+ * Writes a hash table to a file, starting at the file's current offset.
+ *
+ * @param[in]     sht       Hash table to write. It mustn't be growing; finish migrating it first
+ *                          with saeclib_hash_table_migrate.
+ * @param[in]     fd        File descriptor open for writing. Should be at offset 0, since the
+ *                          loader maps the file from its start.
+ *
+ * @return SAECLIB_ERROR_BAD_STRUCTURE if the table is growing.
+ *         SAECLIB_ERROR_IO if a write fails.
+ */
+saeclib_error_e saeclib_hash_mmap_write(const saeclib_hash_table_t* sht, int fd);
+
+/**
+ * Maps a file written by saeclib_hash_mmap_write and sets up a hash table that searches it in
+ * place.
+ *
+ * @param[out]    map       Filled in with the mapping, to be passed to saeclib_hash_mmap_close.
+ * @param[out]    sht       Hash table on top of the mapping.
+ * @param[in]     fd        File descriptor open for reading. It can be closed once this returns.
+ * @param[in]     hash_fn   Same hash function that the table was built with.
+ * @param[in]     cmp       Compare function for keys.
+ *
+ * @return SAECLIB_ERROR_IO if the file can't be mapped.
+ *         SAECLIB_ERROR_BAD_STRUCTURE if it isn't a hash table file, was written on a machine with
+ *         the other byte order, is truncated, or hash_fn doesn't give the same hashes as the
+ *         table's.
+ */
+saeclib_error_e saeclib_hash_mmap_open(saeclib_hash_mmap_t* map,
+                                       saeclib_hash_table_t* sht,
+                                       int fd,
+                                       unsigned int (*hash_fn)(const void*),
+                                       int (*cmp)(const void*, const void*));
+
+/**
+ * Unmaps a file mapped by saeclib_hash_mmap_open. Hash tables on top of it can't be used after
+ * this.
+ */
+saeclib_error_e saeclib_hash_mmap_close(saeclib_hash_mmap_t* map);
+
+#endif
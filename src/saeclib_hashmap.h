@@ -0,0 +1,210 @@
+#ifndef _SAECLIB_HASHMAP_H
+#define _SAECLIB_HASHMAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "saeclib_error.h"
+#include "saeclib_hash.h"
+
+/**
+ * SAECLIB_DEFINE_HASHMAP generates a hash map type for one key type and one value type, along with
+ * static inline functions to work with it. Because the key and value types are known, and the hash
+ * and equality functions are called directly instead of through pointers, the compiler can inline
+ * everything and copy keys and values with plain loads and stores. Use saeclib_hash_table_t when
+ * key and value sizes are only known at runtime.
+ *
+ * The generated table is laid out like a power-of-two saeclib_hash_table_t: open addressing with
+ * linear probing, one control byte per bucket (0 for empty, 0x80 | 7 bits of hash for filled)
+ * and backward-shift deletes. The keys, values and control bytes live inside the map struct
+ * itself, so a map declared static needs no other memory and starts out empty.
+ *
+ * @param[in] name   Prefix for the generated type (name_t) and functions (name_insert, ...).
+ * @param[in] K      Key type.
+ * @param[in] V      Value type.
+ * @param[in] hash   Function or macro called as hash(K key), returning an unsigned integer. It
+ *                   doesn't need to be well mixed; the result is spread out with a Fibonacci
+ *                   multiply.
+ * @param[in] eq     Function or macro called as eq(K a, K b), returning non-zero if the keys are
+ *                   equal.
+ * @param[in] N      Number of elements that the map must be able to hold, at least 2. It is
+ *                   rounded up to a power of two.
+ *
+ * Generated functions, which follow the saeclib_hash_table_t functions of the same names:
+ *     saeclib_error_e name_insert(name_t* m, K key, V value);
+ *     saeclib_error_e name_search(const name_t* m, K key, V* out);
+ *     saeclib_error_e name_search_ref(name_t* m, K key, V** out);
+ *     saeclib_error_e name_delete(name_t* m, K key);
+ *     size_t          name_size(const name_t* m);
+ *     saeclib_error_e name_iterator_init(const name_t* m, name_iterator_t* it);
+ *     saeclib_error_e name_iterator_next(const name_t* m, name_iterator_t* it);
+ *     K*              name_iterator_key(name_t* m, const name_iterator_t* it);
+ *     V*              name_iterator_value(name_t* m, const name_iterator_t* it);
+ *
+ * Example usage:
+ *     #define u32_hash(k) (k)
+ *     #define u32_eq(a, b) ((a) == (b))
+ *     SAECLIB_DEFINE_HASHMAP(particle_map, uint32_t, particle_t, u32_hash, u32_eq, 1024)
+ *
+ *     static particle_map_t particles;
+ *     particle_map_insert(&particles, id, p);
+ */
+#define SAECLIB_DEFINE_HASHMAP(name, K, V, hash, eq, N)                                           \
+                                                                                                  \
+enum { name##_capacity = SAECLIB_NEXT_POW2(N) };                                                  \
+                                                                                                  \
+typedef struct name                                                                               \
+{                                                                                                 \
+    K keys[name##_capacity];                                                                      \
+    V values[name##_capacity];                                                                    \
+    uint8_t ctrl[name##_capacity];                                                                \
+    size_t size;                                                                                  \
+} name##_t;                                                                                       \
+                                                                                                  \
+typedef struct name##_iterator                                                                    \
+{                                                                                                 \
+    size_t idx;                                                                                   \
+} name##_iterator_t;                                                                              \
+                                                                                                  \
+/* Fibonacci hashing: the top bits of the product pick the home bucket and the 7 bits below them \
+ * go in the control byte. */                                                                     \
+static inline uint64_t name##_hash_product(K key)                                                 \
+{                                                                                                 \
+    return (uint64_t)(hash(key)) * 0x9e3779b97f4a7c15ull;                                         \
+}                                                                                                 \
+                                                                                                  \
+static inline size_t name##_home_idx(uint64_t product)                                            \
+{                                                                                                 \
+    return product >> (64 - __builtin_ctzll(name##_capacity));                                    \
+}                                                                                                 \
+                                                                                                  \
+static inline uint8_t name##_ctrl_for(uint64_t product)                                           \
+{                                                                                                 \
+    return 0x80 | ((product >> (57 - __builtin_ctzll(name##_capacity))) & 0x7f);                  \
+}                                                                                                 \
+                                                                                                  \
+/* Returns the bucket holding key, or -1. *stop_idx gets the empty bucket that ended the search, \
+ * or -1 if the map is full. */                                                                   \
+static inline int name##_probe(const name##_t* m, K key, uint64_t product, int* stop_idx)        \
+{                                                                                                 \
+    const uint8_t ctrl = name##_ctrl_for(product);                                                \
+    size_t idx = name##_home_idx(product);                                                        \
+    for (size_t probed = 0; probed < name##_capacity; probed++) {                                 \
+        if (m->ctrl[idx] == 0) {                                                                  \
+            *stop_idx = idx;                                                                      \
+            return -1;                                                                            \
+        }                                                                                         \
+        if ((m->ctrl[idx] == ctrl) && (eq(m->keys[idx], key)))                                    \
+            return idx;                                                                           \
+        idx = (idx + 1) & (name##_capacity - 1);                                                  \
+    }                                                                                             \
+    *stop_idx = -1;                                                                               \
+    return -1;                                                                                    \
+}                                                                                                 \
+                                                                                                  \
+static inline saeclib_error_e name##_insert(name##_t* m, K key, V value)                          \
+{                                                                                                 \
+    const uint64_t product = name##_hash_product(key);                                            \
+    int idx;                                                                                      \
+    if (name##_probe(m, key, product, &idx) != -1)                                                \
+        return SAECLIB_ERROR_DUPLICATE_KEY;                                                       \
+    if (idx == -1)                                                                                \
+        return SAECLIB_ERROR_OVERFLOW;                                                            \
+                                                                                                  \
+    m->keys[idx] = key;                                                                           \
+    m->values[idx] = value;                                                                       \
+    m->ctrl[idx] = name##_ctrl_for(product);                                                      \
+    m->size++;                                                                                    \
+    return SAECLIB_ERROR_NOERROR;                                                                 \
+}                                                                                                 \
+                                                                                                  \
+static inline saeclib_error_e name##_search_ref(name##_t* m, K key, V** out)                      \
+{                                                                                                 \
+    int stop_idx;                                                                                 \
+    int idx = name##_probe(m, key, name##_hash_product(key), &stop_idx);                          \
+    if (idx == -1)                                                                                \
+        return SAECLIB_ERROR_UNDERFLOW;                                                           \
+                                                                                                  \
+    *out = &m->values[idx];                                                                       \
+    return SAECLIB_ERROR_NOERROR;                                                                 \
+}                                                                                                 \
+                                                                                                  \
+static inline saeclib_error_e name##_search(const name##_t* m, K key, V* out)                     \
+{                                                                                                 \
+    int stop_idx;                                                                                 \
+    int idx = name##_probe(m, key, name##_hash_product(key), &stop_idx);                          \
+    if (idx == -1)                                                                                \
+        return SAECLIB_ERROR_UNDERFLOW;                                                           \
+                                                                                                  \
+    *out = m->values[idx];                                                                        \
+    return SAECLIB_ERROR_NOERROR;                                                                 \
+}                                                                                                 \
+                                                                                                  \
+/* Same backward-shift delete as saeclib_hash_delete: keys after the deleted one are moved back \
+ * into the hole unless that would put them before their home bucket. */                         \
+static inline saeclib_error_e name##_delete(name##_t* m, K key)                                   \
+{                                                                                                 \
+    const size_t mask = name##_capacity - 1;                                                      \
+    int stop_idx;                                                                                 \
+    int found = name##_probe(m, key, name##_hash_product(key), &stop_idx);                        \
+    if (found == -1)                                                                              \
+        return SAECLIB_ERROR_UNDERFLOW;                                                           \
+                                                                                                  \
+    size_t del_idx = found;                                                                       \
+    for (size_t rpl_idx = (del_idx + 1) & mask; rpl_idx != (size_t)found;                         \
+         rpl_idx = (rpl_idx + 1) & mask) {                                                        \
+        if (m->ctrl[rpl_idx] == 0)                                                                \
+            break;                                                                                \
+                                                                                                  \
+        size_t home = name##_home_idx(name##_hash_product(m->keys[rpl_idx]));                     \
+        if (((rpl_idx - home) & mask) >= ((rpl_idx - del_idx) & mask)) {                          \
+            m->keys[del_idx] = m->keys[rpl_idx];                                                  \
+            m->values[del_idx] = m->values[rpl_idx];                                              \
+            m->ctrl[del_idx] = m->ctrl[rpl_idx];                                                  \
+            del_idx = rpl_idx;                                                                    \
+        }                                                                                         \
+    }                                                                                             \
+                                                                                                  \
+    m->ctrl[del_idx] = 0;                                                                         \
+    m->size--;                                                                                    \
+    return SAECLIB_ERROR_NOERROR;                                                                 \
+}                                                                                                 \
+                                                                                                  \
+static inline size_t name##_size(const name##_t* m)                                               \
+{                                                                                                 \
+    return m->size;                                                                               \
+}                                                                                                 \
+                                                                                                  \
+/* Moves it to the first filled bucket at or after start. */                                     \
+static inline saeclib_error_e name##_iterator_seek(const name##_t* m, name##_iterator_t* it,     \
+                                                   size_t start)                                  \
+{                                                                                                 \
+    for (it->idx = start; it->idx < name##_capacity; it->idx++) {                                 \
+        if (m->ctrl[it->idx] != 0)                                                                \
+            return SAECLIB_ERROR_NOERROR;                                                         \
+    }                                                                                             \
+    return SAECLIB_ERROR_UNDERFLOW;                                                               \
+}                                                                                                 \
+                                                                                                  \
+static inline saeclib_error_e name##_iterator_init(const name##_t* m, name##_iterator_t* it)     \
+{                                                                                                 \
+    return name##_iterator_seek(m, it, 0);                                                        \
+}                                                                                                 \
+                                                                                                  \
+static inline saeclib_error_e name##_iterator_next(const name##_t* m, name##_iterator_t* it)     \
+{                                                                                                 \
+    return name##_iterator_seek(m, it, it->idx + 1);                                              \
+}                                                                                                 \
+                                                                                                  \
+static inline K* name##_iterator_key(name##_t* m, const name##_iterator_t* it)                   \
+{                                                                                                 \
+    return &m->keys[it->idx];                                                                     \
+}                                                                                                 \
+                                                                                                  \
+static inline V* name##_iterator_value(name##_t* m, const name##_iterator_t* it)                 \
+{                                                                                                 \
+    return &m->values[it->idx];                                                                   \
+}
+
+#endif
@@ -0,0 +1,146 @@
+#include "saeclib_intern.h"
+
+#include <string.h>
+
+#include "saeclib_hash_functions.h"
+
+static inline uint32_t intern_hash(const char* str, size_t len)
+{
+    return (uint32_t)saeclib_hash_bytes(str, len, 0);
+}
+
+/**
+ * Probes for a string. Returns its id + 1 if it's in the pool, or 0, with *slot set to the table
+ * slot where the search ended: the string's slot, or the empty one where it would go.
+ */
+static uint32_t probe(const saeclib_intern_pool_t* pool, const char* str, size_t len,
+                      uint32_t hash, size_t* slot)
+{
+    size_t idx = hash & pool->table_mask;
+    for (;;) {
+        const uint32_t id1 = pool->table[idx];
+        if (id1 == 0)
+            break;
+
+        const saeclib_intern_entry_t* e = &pool->entries[id1 - 1];
+        if ((e->hash == hash) && (e->len == len) && !memcmp(pool->arena + e->offset, str, len))
+            break;
+
+        idx = (idx + 1) & pool->table_mask;
+    }
+
+    *slot = idx;
+    return pool->table[idx];
+}
+
+
+saeclib_error_e saeclib_intern_pool_init(saeclib_intern_pool_t* pool,
+                                         void* arenaspace,
+                                         size_t arenaspace_size,
+                                         saeclib_intern_entry_t* entryspace,
+                                         size_t entryspace_size,
+                                         uint32_t* tablespace,
+                                         size_t tablespace_size)
+{
+    const size_t max_strings = entryspace_size / sizeof(saeclib_intern_entry_t);
+    const size_t nslots = tablespace_size / sizeof(uint32_t);
+    if ((nslots <= max_strings) || ((nslots & (nslots - 1)) != 0) ||
+        (arenaspace_size > UINT32_MAX))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    pool->arena = arenaspace;
+    pool->arena_size = arenaspace_size;
+    pool->entries = entryspace;
+    pool->max_strings = max_strings;
+    pool->table = tablespace;
+    pool->table_mask = nslots - 1;
+    saeclib_intern_pool_clear(pool);
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_intern_add(saeclib_intern_pool_t* pool,
+                                   const char* str,
+                                   size_t len,
+                                   uint32_t* id)
+{
+    const uint32_t hash = intern_hash(str, len);
+    size_t slot;
+    const uint32_t found = probe(pool, str, len, hash, &slot);
+    if (found != 0) {
+        *id = found - 1;
+        return SAECLIB_ERROR_NOERROR;
+    }
+
+    if ((pool->count == pool->max_strings) || ((pool->arena_size - pool->arena_used) < (len + 1)))
+        return SAECLIB_ERROR_OVERFLOW;
+
+    char* dst = pool->arena + pool->arena_used;
+    memcpy(dst, str, len);
+    dst[len] = '\0';
+
+    const uint32_t new_id = pool->count;
+    pool->entries[new_id] = (saeclib_intern_entry_t){
+        .offset = pool->arena_used,
+        .len = len,
+        .hash = hash,
+    };
+    pool->table[slot] = new_id + 1;
+    pool->arena_used += len + 1;
+    pool->count++;
+
+    *id = new_id;
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_intern_add_cstr(saeclib_intern_pool_t* pool, const char* str, uint32_t* id)
+{
+    return saeclib_intern_add(pool, str, strlen(str), id);
+}
+
+
+saeclib_error_e saeclib_intern_find(const saeclib_intern_pool_t* pool,
+                                    const char* str,
+                                    size_t len,
+                                    uint32_t* id)
+{
+    size_t slot;
+    const uint32_t found = probe(pool, str, len, intern_hash(str, len), &slot);
+    if (found == 0)
+        return SAECLIB_ERROR_UNDERFLOW;
+
+    *id = found - 1;
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+const char* saeclib_intern_str(const saeclib_intern_pool_t* pool, uint32_t id)
+{
+    if (id >= pool->count)
+        return NULL;
+    return pool->arena + pool->entries[id].offset;
+}
+
+
+size_t saeclib_intern_len(const saeclib_intern_pool_t* pool, uint32_t id)
+{
+    if (id >= pool->count)
+        return 0;
+    return pool->entries[id].len;
+}
+
+
+size_t saeclib_intern_count(const saeclib_intern_pool_t* pool)
+{
+    return pool->count;
+}
+
+
+void saeclib_intern_pool_clear(saeclib_intern_pool_t* pool)
+{
+    memset(pool->table, 0, (pool->table_mask + 1) * sizeof(uint32_t));
+    pool->arena_used = 0;
+    pool->count = 0;
+}
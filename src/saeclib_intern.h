@@ -0,0 +1,141 @@
+#ifndef _SAECLIB_INTERN_H
+#define _SAECLIB_INTERN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "saeclib_error.h"
+#include "saeclib_hash.h"
+
+/**
+ * A string interning pool. Each different string added to the pool is copied once into a byte
+ * arena and given a 32-bit id, and adding the same string again gives back the same id. Ids are
+ * handed out in order from 0 and never change, so code that has interned its strings can compare
+ * them with == and key tables on them with saeclib_hash_table_u32_hash, or index plain arrays
+ * with them, instead of hashing and comparing whole strings every time.
+ *
+ * Strings are found through an open addressing table of ids that keeps, next to each id, the
+ * string's hash, so a probe only reads the arena when both the hash and the length match.
+ *
+ * Strings are counted, not nul-terminated, so they can be tokens sliced out of a bigger buffer,
+ * and may contain nul bytes. Each one is stored with a nul after it, so that those without one
+ * can be used as C strings. Strings can't be removed, short of clearing the whole pool.
+ */
+
+typedef struct saeclib_intern_entry
+{
+    // where the string starts in the arena, and its length, not counting the nul.
+    uint32_t offset;
+    uint32_t len;
+
+    uint32_t hash;
+} saeclib_intern_entry_t;
+
+typedef struct saeclib_intern_pool
+{
+    // the strings, one after the other, each followed by a nul.
+    char* arena;
+    size_t arena_size;
+    size_t arena_used;
+
+    // one entry per id.
+    saeclib_intern_entry_t* entries;
+    size_t max_strings;
+    size_t count;
+
+    // power-of-two open addressing table, holding id + 1 for each string, or 0 for an empty slot.
+    uint32_t* table;
+    size_t table_mask;
+} saeclib_intern_pool_t;
+
+/**
+ * Initializes an empty pool.
+ *
+ * @param[in,out] pool      Pool to initialize.
+ * @param[in]     arenaspace  Memory for the strings. Each one takes its length plus one bytes.
+ * @param[in]     arenaspace_size  Size of arenaspace in bytes, less than 4 GiB.
+ * @param[in]     entryspace  Memory for one saeclib_intern_entry_t per string.
+ * @param[in]     entryspace_size  Size of entryspace in bytes. This sets how many strings the
+ *                                 pool holds.
+ * @param[in]     tablespace  Memory for the table: a power of two uint32_t that's more than the
+ *                            number of strings. Twice as many keeps probes short. It's cleared
+ *                            here.
+ * @param[in]     tablespace_size  Size of tablespace in bytes.
+ *
+ * @return SAECLIB_ERROR_BAD_STRUCTURE if the table's size isn't a power of two bigger than the
+ *         number of strings, or the arena is too big.
+ */
+saeclib_error_e saeclib_intern_pool_init(saeclib_intern_pool_t* pool,
+                                         void* arenaspace,
+                                         size_t arenaspace_size,
+                                         saeclib_intern_entry_t* entryspace,
+                                         size_t entryspace_size,
+                                         uint32_t* tablespace,
+                                         size_t tablespace_size);
+
+/**
+ * Statically allocates a pool for up to max_strings strings, taking up to arena_size bytes
+ * between them. The same cautions as for saeclib_hash_table_salloc apply.
+ */
+#define saeclib_intern_pool_salloc(max_strings, arena_size)                                       \
+    ({                                                                                            \
+    saeclib_intern_pool_t pool;                                                                   \
+    static char arenaspace[(arena_size)];                                                         \
+    static saeclib_intern_entry_t entryspace[(max_strings)];                                      \
+    static uint32_t tablespace[SAECLIB_NEXT_POW2(2 * (max_strings))];                             \
+    saeclib_intern_pool_init(&pool, arenaspace, sizeof(arenaspace), entryspace,                   \
+                             sizeof(entryspace), tablespace, sizeof(tablespace));                 \
+    pool;                                                                                         \
+    })
+
+/**
+ * Interns len bytes of str: gives the id of the same string if it's already in the pool, and adds
+ * it if not.
+ *
+ * @param[out]    id        The string's id.
+ *
+ * @return SAECLIB_ERROR_OVERFLOW if the string isn't in the pool and there isn't room for it,
+ *         either in the arena or for another id.
+ */
+saeclib_error_e saeclib_intern_add(saeclib_intern_pool_t* pool,
+                                   const char* str,
+                                   size_t len,
+                                   uint32_t* id);
+
+/**
+ * Same as saeclib_intern_add, for a nul-terminated string.
+ */
+saeclib_error_e saeclib_intern_add_cstr(saeclib_intern_pool_t* pool, const char* str, uint32_t* id);
+
+/**
+ * Gives the id of len bytes of str if the string's in the pool, without adding it if it isn't.
+ *
+ * @return SAECLIB_ERROR_UNDERFLOW if the string isn't in the pool.
+ */
+saeclib_error_e saeclib_intern_find(const saeclib_intern_pool_t* pool,
+                                    const char* str,
+                                    size_t len,
+                                    uint32_t* id);
+
+/**
+ * The string with an id, nul-terminated, or NULL if there's no such id. The pointer is good until
+ * the pool is cleared.
+ */
+const char* saeclib_intern_str(const saeclib_intern_pool_t* pool, uint32_t id);
+
+/**
+ * Length of the string with an id, or 0 if there's no such id.
+ */
+size_t saeclib_intern_len(const saeclib_intern_pool_t* pool, uint32_t id);
+
+/**
+ * Number of strings in the pool, which is also the next id that will be handed out.
+ */
+size_t saeclib_intern_count(const saeclib_intern_pool_t* pool);
+
+/**
+ * Empties the pool. Every id and string pointer that it gave out is invalid afterwards.
+ */
+void saeclib_intern_pool_clear(saeclib_intern_pool_t* pool);
+
+#endif
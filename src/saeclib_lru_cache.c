@@ -0,0 +1,228 @@
+#include "saeclib_lru_cache.h"
+
+#include <string.h>
+
+static inline uint8_t* get_keyptr(const saeclib_lru_cache_t* cache, uint32_t s)
+{
+    return cache->key_data + (s * cache->key_elt_size);
+}
+
+static inline uint8_t* get_valptr(const saeclib_lru_cache_t* cache, uint32_t s)
+{
+    return cache->value_data + (s * cache->value_elt_size);
+}
+
+static void list_unlink(saeclib_lru_cache_t* cache, uint32_t s)
+{
+    saeclib_lru_cache_slot_t* slot = &cache->slots[s];
+    if (slot->prev != SAECLIB_LRU_CACHE_NONE)
+        cache->slots[slot->prev].next = slot->next;
+    else
+        cache->head = slot->next;
+
+    if (slot->next != SAECLIB_LRU_CACHE_NONE)
+        cache->slots[slot->next].prev = slot->prev;
+    else
+        cache->tail = slot->prev;
+}
+
+static void list_push_front(saeclib_lru_cache_t* cache, uint32_t s)
+{
+    saeclib_lru_cache_slot_t* slot = &cache->slots[s];
+    slot->prev = SAECLIB_LRU_CACHE_NONE;
+    slot->next = cache->head;
+    if (cache->head != SAECLIB_LRU_CACHE_NONE)
+        cache->slots[cache->head].prev = s;
+    else
+        cache->tail = s;
+    cache->head = s;
+}
+
+/**
+ * Marks the entry in slot s as just used.
+ */
+static inline void touch(saeclib_lru_cache_t* cache, uint32_t s)
+{
+    if (cache->mode == SAECLIB_LRU_CACHE_CLOCK) {
+        // only write if it changes anything, so hits on hot keys leave their cache lines clean.
+        if (!cache->slots[s].referenced)
+            cache->slots[s].referenced = 1;
+    } else if (cache->head != s) {
+        list_unlink(cache, s);
+        list_push_front(cache, s);
+    }
+}
+
+/**
+ * Slot of the entry to evict next. The cache mustn't be empty.
+ */
+static uint32_t victim(saeclib_lru_cache_t* cache)
+{
+    if (cache->mode == SAECLIB_LRU_CACHE_LRU)
+        return cache->tail;
+
+    // Every pass over a slot clears its flag, so this stops within two trips round.
+    for (;;) {
+        const uint32_t s = cache->hand;
+        cache->hand = ((s + 1) == cache->capacity) ? 0 : (s + 1);
+
+        saeclib_lru_cache_slot_t* slot = &cache->slots[s];
+        if (!slot->in_use)
+            continue;
+        if (slot->referenced) {
+            slot->referenced = 0;
+            continue;
+        }
+        return s;
+    }
+}
+
+/**
+ * Removes the entry in slot s and puts the slot on the free list.
+ */
+static void release(saeclib_lru_cache_t* cache, uint32_t s)
+{
+    saeclib_hash_delete(&cache->index, get_keyptr(cache, s));
+    if (cache->mode == SAECLIB_LRU_CACHE_LRU)
+        list_unlink(cache, s);
+
+    saeclib_lru_cache_slot_t* slot = &cache->slots[s];
+    slot->in_use = false;
+    slot->referenced = 0;
+    slot->next = cache->free_head;
+    cache->free_head = s;
+    cache->size--;
+}
+
+
+saeclib_error_e saeclib_lru_cache_init(saeclib_lru_cache_t* cache,
+                                       const saeclib_hash_table_t* index,
+                                       void* keyspace,
+                                       void* valuespace,
+                                       saeclib_lru_cache_slot_t* slotspace,
+                                       size_t capacity,
+                                       size_t value_size,
+                                       saeclib_lru_cache_mode_e mode)
+{
+    if ((capacity == 0) || (capacity >= SAECLIB_LRU_CACHE_NONE) || (index->capacity < capacity) ||
+        (index->value_elt_size != sizeof(uint32_t)))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    cache->index = *index;
+    cache->key_data = keyspace;
+    cache->value_data = valuespace;
+    cache->slots = slotspace;
+    cache->capacity = capacity;
+    cache->key_elt_size = index->key_elt_size;
+    cache->value_elt_size = value_size;
+    cache->size = 0;
+    cache->mode = mode;
+    cache->head = SAECLIB_LRU_CACHE_NONE;
+    cache->tail = SAECLIB_LRU_CACHE_NONE;
+    cache->hand = 0;
+
+    for (uint32_t s = 0; s < capacity; s++) {
+        slotspace[s] = (saeclib_lru_cache_slot_t){
+            .prev = SAECLIB_LRU_CACHE_NONE,
+            .next = ((s + 1) < capacity) ? (s + 1) : SAECLIB_LRU_CACHE_NONE,
+            .in_use = false,
+            .referenced = 0,
+        };
+    }
+    cache->free_head = 0;
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_lru_cache_get(saeclib_lru_cache_t* cache, const void* key, void* out)
+{
+    void* src;
+    saeclib_error_e err = saeclib_lru_cache_get_ref(cache, key, &src);
+    if (err != SAECLIB_ERROR_NOERROR)
+        return err;
+
+    memcpy(out, src, cache->value_elt_size);
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_lru_cache_get_ref(saeclib_lru_cache_t* cache, const void* key, void** out)
+{
+    uint32_t s;
+    if (saeclib_hash_search(&cache->index, key, &s) != SAECLIB_ERROR_NOERROR)
+        return SAECLIB_ERROR_UNDERFLOW;
+
+    touch(cache, s);
+    *out = get_valptr(cache, s);
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_lru_cache_put(saeclib_lru_cache_t* cache,
+                                      const void* key,
+                                      const void* value)
+{
+    uint32_t s;
+    if (saeclib_hash_search(&cache->index, key, &s) == SAECLIB_ERROR_NOERROR) {
+        memcpy(get_valptr(cache, s), value, cache->value_elt_size);
+        touch(cache, s);
+        return SAECLIB_ERROR_NOERROR;
+    }
+
+    if (cache->free_head == SAECLIB_LRU_CACHE_NONE)
+        release(cache, victim(cache));
+
+    s = cache->free_head;
+    saeclib_error_e err = saeclib_hash_insert(&cache->index, key, &s);
+    if (err != SAECLIB_ERROR_NOERROR)
+        return err;
+
+    saeclib_lru_cache_slot_t* slot = &cache->slots[s];
+    cache->free_head = slot->next;
+    memcpy(get_keyptr(cache, s), key, cache->key_elt_size);
+    memcpy(get_valptr(cache, s), value, cache->value_elt_size);
+    slot->in_use = true;
+
+    // A new CLOCK entry starts unreferenced, so one that's never used again goes before the
+    // entries that have been.
+    slot->referenced = 0;
+    if (cache->mode == SAECLIB_LRU_CACHE_LRU)
+        list_push_front(cache, s);
+    cache->size++;
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_lru_cache_evict(saeclib_lru_cache_t* cache, void* key_out, void* value_out)
+{
+    if (cache->size == 0)
+        return SAECLIB_ERROR_UNDERFLOW;
+
+    const uint32_t s = victim(cache);
+    if (key_out != NULL)
+        memcpy(key_out, get_keyptr(cache, s), cache->key_elt_size);
+    if (value_out != NULL)
+        memcpy(value_out, get_valptr(cache, s), cache->value_elt_size);
+    release(cache, s);
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_lru_cache_delete(saeclib_lru_cache_t* cache, const void* key)
+{
+    uint32_t s;
+    if (saeclib_hash_search(&cache->index, key, &s) != SAECLIB_ERROR_NOERROR)
+        return SAECLIB_ERROR_UNDERFLOW;
+
+    release(cache, s);
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+size_t saeclib_lru_cache_size(const saeclib_lru_cache_t* cache)
+{
+    return cache->size;
+}
@@ -0,0 +1,170 @@
+#ifndef _SAECLIB_LRU_CACHE_H
+#define _SAECLIB_LRU_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "saeclib_error.h"
+#include "saeclib_hash.h"
+
+/**
+ * A fixed-capacity cache: a map from keys to values that, once it's full, makes room for each new
+ * key by evicting one that's already there.
+ *
+ * Keys and values live in an array of capacity slots, and a saeclib_hash_table_t maps each key to
+ * the index of its slot. A get is one search of that table. Recency is kept by slot index, so
+ * moving a key to the front or evicting the one at the back never touches the hash table, and
+ * every operation takes constant time whatever the capacity.
+ *
+ * Two eviction policies are available:
+ *  - SAECLIB_LRU_CACHE_LRU keeps the slots on a doubly linked list in order of use, and evicts the
+ *    least recently used key. Every hit relinks its slot at the front of the list.
+ *  - SAECLIB_LRU_CACHE_CLOCK (second chance) only sets a flag in the slot on a hit. Evicting
+ *    sweeps a hand around the slots, clearing flags, until it reaches a slot whose flag is clear,
+ *    and evicts that one. Hits are cheaper and write less, which suits caches that are read far
+ *    more than they're filled; what gets evicted is close to, but not exactly, the least recently
+ *    used key.
+ */
+
+typedef enum {
+    SAECLIB_LRU_CACHE_LRU = 0,
+    SAECLIB_LRU_CACHE_CLOCK,
+} saeclib_lru_cache_mode_e;
+
+// Marks the end of a list of slots.
+#define SAECLIB_LRU_CACHE_NONE UINT32_MAX
+
+typedef struct saeclib_lru_cache_slot
+{
+    // Neighbours on the recency list, towards the most and least recently used ends. Free slots
+    // are kept on a list of their own through next.
+    uint32_t prev;
+    uint32_t next;
+
+    // Whether the slot holds an entry.
+    bool in_use;
+
+    // CLOCK mode: set when the slot's key is used, cleared when the hand passes over it.
+    uint8_t referenced;
+} saeclib_lru_cache_slot_t;
+
+typedef struct saeclib_lru_cache
+{
+    // Maps each key to the index of its slot, as a uint32_t value.
+    saeclib_hash_table_t index;
+
+    // One key, value and slot per entry.
+    uint8_t* key_data;
+    uint8_t* value_data;
+    saeclib_lru_cache_slot_t* slots;
+
+    size_t capacity;
+    size_t key_elt_size;
+    size_t value_elt_size;
+    size_t size;
+
+    saeclib_lru_cache_mode_e mode;
+
+    // LRU mode: the most and least recently used slots.
+    uint32_t head;
+    uint32_t tail;
+
+    // CLOCK mode: the next slot that the hand looks at.
+    uint32_t hand;
+
+    // Slots that don't hold an entry.
+    uint32_t free_head;
+} saeclib_lru_cache_t;
+
+/**
+ * Initializes an empty cache.
+ *
+ * @param[in,out] cache     Cache to initialize.
+ * @param[in]     index     An empty hash table with the cache's key size and hash and compare
+ *                          functions, and uint32_t values, that can hold at least capacity keys.
+ *                          The cache takes it over. A power-of-two table with twice capacity's
+ *                          buckets keeps searches short.
+ * @param[in]     keyspace  Memory for the keys. Should be 'capacity * key_size' bytes, where
+ *                          key_size is index's key size.
+ * @param[in]     valuespace  Memory for the values. Should be 'capacity * value_size' bytes.
+ * @param[in]     slotspace Memory for capacity slots.
+ * @param[in]     capacity  How many entries the cache holds before it starts evicting.
+ * @param[in]     value_size  Size in bytes of each value.
+ * @param[in]     mode      Eviction policy.
+ *
+ * @return SAECLIB_ERROR_BAD_STRUCTURE if index can't hold capacity keys or doesn't have uint32_t
+ *         values, or capacity is 0.
+ */
+saeclib_error_e saeclib_lru_cache_init(saeclib_lru_cache_t* cache,
+                                       const saeclib_hash_table_t* index,
+                                       void* keyspace,
+                                       void* valuespace,
+                                       saeclib_lru_cache_slot_t* slotspace,
+                                       size_t capacity,
+                                       size_t value_size,
+                                       saeclib_lru_cache_mode_e mode);
+
+/**
+ * Statically allocates a cache with room for capacity entries, indexed by a power-of-two hash
+ * table at most half full. The same cautions as for saeclib_hash_table_salloc apply.
+ */
+#define saeclib_lru_cache_salloc(capacity, keysize, valuesize, hash_fn, cmp, mode)                \
+    ({                                                                                            \
+    saeclib_lru_cache_t cache;                                                                    \
+    saeclib_hash_table_t index = saeclib_hash_table_pow2_salloc(2 * (capacity), keysize,          \
+                                                                sizeof(uint32_t), hash_fn, cmp);  \
+    static uint8_t keyspace[(capacity) * (keysize)] = { 0 };                                      \
+    static uint8_t valuespace[(capacity) * (valuesize)] = { 0 };                                  \
+    static saeclib_lru_cache_slot_t slotspace[(capacity)];                                        \
+    saeclib_lru_cache_init(&cache, &index, keyspace, valuespace, slotspace, capacity, valuesize,  \
+                           mode);                                                                 \
+    cache;                                                                                        \
+    })
+
+/**
+ * Copies the value for a key into out, and marks the key as used.
+ *
+ * @return SAECLIB_ERROR_UNDERFLOW if the key isn't in the cache.
+ */
+saeclib_error_e saeclib_lru_cache_get(saeclib_lru_cache_t* cache, const void* key, void* out);
+
+/**
+ * Same as saeclib_lru_cache_get, but returns a pointer to the value, meaning that it can be
+ * modified. The pointer is good until the key is evicted or deleted.
+ */
+saeclib_error_e saeclib_lru_cache_get_ref(saeclib_lru_cache_t* cache, const void* key, void** out);
+
+/**
+ * Sets the value for a key, adding the key if it isn't there, and marks the key as used. If the
+ * cache is full, the key that saeclib_lru_cache_evict would pick is evicted first to make room;
+ * call saeclib_lru_cache_evict before putting into a full cache to find out which one it is.
+ */
+saeclib_error_e saeclib_lru_cache_put(saeclib_lru_cache_t* cache,
+                                      const void* key,
+                                      const void* value);
+
+/**
+ * Evicts the entry that's next in line: the least recently used one in LRU mode, the one the
+ * hand stops on in CLOCK mode.
+ *
+ * @param[out]    key_out   Gets the evicted key, if not NULL.
+ * @param[out]    value_out Gets the evicted value, if not NULL.
+ *
+ * @return SAECLIB_ERROR_UNDERFLOW if the cache is empty.
+ */
+saeclib_error_e saeclib_lru_cache_evict(saeclib_lru_cache_t* cache, void* key_out, void* value_out);
+
+/**
+ * Removes a key from the cache.
+ *
+ * @return SAECLIB_ERROR_UNDERFLOW if the key isn't in the cache.
+ */
+saeclib_error_e saeclib_lru_cache_delete(saeclib_lru_cache_t* cache, const void* key);
+
+/**
+ * Number of entries in the cache.
+ */
+size_t saeclib_lru_cache_size(const saeclib_lru_cache_t* cache);
+
+#endif
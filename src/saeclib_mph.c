@@ -0,0 +1,360 @@
+#include "saeclib_mph.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "saeclib_hash_functions.h"
+
+// Buckets average 4 keys; one much bigger than this means the seed is bad, so try another.
+#define MAX_BUCKET_SIZE 64
+
+// How many seeds to try before giving up.
+#define MAX_SEEDS 8
+
+
+/**
+ * The key's hash, mixed with the seed. The top 32 bits pick its bucket; all 64 are mixed with its
+ * bucket's pilot to pick its index.
+ */
+static inline uint64_t key_mix(uint32_t seed, unsigned int hash)
+{
+    return saeclib_hash_mix64(((uint64_t)seed << 32) | hash);
+}
+
+/**
+ * Maps x onto [0, n) with a multiply instead of a division.
+ */
+static inline uint32_t reduce(uint32_t x, uint32_t n)
+{
+    return ((uint64_t)x * n) >> 32;
+}
+
+static inline uint32_t bucket_of(uint64_t k, uint32_t nbuckets)
+{
+    return reduce(k >> 32, nbuckets);
+}
+
+static inline uint32_t slot_of(uint64_t k, uint32_t pilot, uint32_t nmain)
+{
+    return reduce((uint32_t)saeclib_hash_mix64(k ^ pilot), nmain);
+}
+
+static inline const uint8_t* get_keyptr_at_idx(const saeclib_mph_t* mph, uint32_t idx)
+{
+    return mph->key_data + (idx * mph->key_elt_size);
+}
+
+
+/**
+ * Sorts the key indices in idx by their hashes, with an LSD radix sort that uses tmp as scratch.
+ */
+static void sort_by_hash(uint32_t* idx, uint32_t* tmp, const uint32_t* hashes, uint32_t n)
+{
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t count[257] = { 0 };
+        for (uint32_t i = 0; i < n; i++) {
+            count[((hashes[idx[i]] >> shift) & 0xff) + 1]++;
+        }
+        for (int d = 0; d < 256; d++) {
+            count[d + 1] += count[d];
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            tmp[count[(hashes[idx[i]] >> shift) & 0xff]++] = idx[i];
+        }
+
+        uint32_t* swap = idx;
+        idx = tmp;
+        tmp = swap;
+    }
+}
+
+
+typedef struct build_state
+{
+    const uint32_t* hashes;
+
+    // indices of the keys that aren't in the stash.
+    const uint32_t* main_keys;
+    uint32_t nmain;
+
+    uint32_t* pilots;
+    uint32_t nbuckets;
+
+    // index -> position of the key in the caller's keys array.
+    uint32_t* pos_to_key;
+
+    // scratch
+    uint32_t* bucket_keys;
+    uint32_t* bucket_start;
+    uint32_t* bucket_order;
+    uint32_t* taken;
+} build_state_t;
+
+
+/**
+ * Tries to find pilots for every bucket with the given seed. Returns false if a bucket is too big
+ * or no pilot works for one.
+ */
+static bool place_buckets(build_state_t* st, uint32_t seed)
+{
+    const uint32_t nbuckets = st->nbuckets;
+
+    // group the keys by bucket.
+    memset(st->bucket_start, 0, (nbuckets + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < st->nmain; i++) {
+        st->bucket_start[bucket_of(key_mix(seed, st->hashes[st->main_keys[i]]), nbuckets) + 1]++;
+    }
+
+    uint32_t size_count[MAX_BUCKET_SIZE + 2] = { 0 };
+    for (uint32_t b = 0; b < nbuckets; b++) {
+        uint32_t size = st->bucket_start[b + 1];
+        if (size > MAX_BUCKET_SIZE)
+            return false;
+        size_count[MAX_BUCKET_SIZE - size + 1]++;
+        st->bucket_start[b + 1] += st->bucket_start[b];
+    }
+
+    // bucket_order doubles as each bucket's fill cursor until the buckets are sorted.
+    uint32_t* cursor = st->bucket_order;
+    memcpy(cursor, st->bucket_start, nbuckets * sizeof(uint32_t));
+    for (uint32_t i = 0; i < st->nmain; i++) {
+        uint32_t key = st->main_keys[i];
+        st->bucket_keys[cursor[bucket_of(key_mix(seed, st->hashes[key]), nbuckets)]++] = key;
+    }
+
+    // biggest buckets first, while there's the most room for them.
+    for (int s = 0; s <= MAX_BUCKET_SIZE; s++) {
+        size_count[s + 1] += size_count[s];
+    }
+    for (uint32_t b = 0; b < nbuckets; b++) {
+        uint32_t size = st->bucket_start[b + 1] - st->bucket_start[b];
+        st->bucket_order[size_count[MAX_BUCKET_SIZE - size]++] = b;
+    }
+
+    memset(st->taken, 0, ((st->nmain + 31) / 32) * sizeof(uint32_t));
+    memset(st->pilots, 0, nbuckets * sizeof(uint32_t));
+
+    // the last few keys placed only have a handful of free indices to land on, so they can take
+    // around nmain tries.
+    uint64_t max_pilot = ((uint64_t)st->nmain * 64) + 1024;
+    if (max_pilot > UINT32_MAX)
+        max_pilot = UINT32_MAX;
+
+    for (uint32_t o = 0; o < nbuckets; o++) {
+        const uint32_t b = st->bucket_order[o];
+        const uint32_t* bkeys = st->bucket_keys + st->bucket_start[b];
+        const uint32_t size = st->bucket_start[b + 1] - st->bucket_start[b];
+        if (size == 0)
+            break;
+
+        uint64_t k[MAX_BUCKET_SIZE];
+        for (uint32_t i = 0; i < size; i++) {
+            k[i] = key_mix(seed, st->hashes[bkeys[i]]);
+        }
+
+        uint32_t slots[MAX_BUCKET_SIZE];
+        uint64_t pilot;
+        for (pilot = 0; pilot < max_pilot; pilot++) {
+            uint32_t i;
+            for (i = 0; i < size; i++) {
+                slots[i] = slot_of(k[i], pilot, st->nmain);
+                if (st->taken[slots[i] / 32] & (1u << (slots[i] % 32)))
+                    break;
+
+                uint32_t j;
+                for (j = 0; (j < i) && (slots[j] != slots[i]); j++);
+                if (j < i)
+                    break;
+            }
+            if (i == size)
+                break;
+        }
+        if (pilot == max_pilot)
+            return false;
+
+        st->pilots[b] = pilot;
+        for (uint32_t i = 0; i < size; i++) {
+            st->taken[slots[i] / 32] |= 1u << (slots[i] % 32);
+            st->pos_to_key[slots[i]] = bkeys[i];
+        }
+    }
+
+    return true;
+}
+
+
+saeclib_error_e saeclib_mph_build(saeclib_mph_t* mph,
+                                  const void* keys,
+                                  size_t nkeys,
+                                  size_t key_size,
+                                  unsigned int (*hash_fn)(const void*),
+                                  int (*cmp)(const void*, const void*),
+                                  uint32_t* pilotspace,
+                                  void* keyspace,
+                                  uint32_t* order,
+                                  void* workspace,
+                                  size_t workspace_size)
+{
+    if ((nkeys > UINT32_MAX) || (workspace_size < SAECLIB_MPH_WORKSPACE_SIZE(nkeys)))
+        return SAECLIB_ERROR_OVERFLOW;
+
+    const uint32_t n = nkeys;
+    const uint32_t nbuckets = SAECLIB_MPH_NBUCKETS(n);
+    const uint8_t* key_bytes = keys;
+
+    uint32_t* hashes = workspace;
+    uint32_t* sorted = hashes + n;
+    uint32_t* pos_to_key = sorted + n;
+    build_state_t st = {
+        .hashes = hashes,
+        .main_keys = sorted,
+        .pilots = pilotspace,
+        .nbuckets = nbuckets,
+        .pos_to_key = pos_to_key,
+        .bucket_keys = pos_to_key + n,
+        .bucket_start = pos_to_key + (2 * n),
+        .bucket_order = pos_to_key + (2 * n) + nbuckets + 1,
+        .taken = pos_to_key + (2 * n) + (2 * nbuckets) + 1,
+    };
+
+    for (uint32_t i = 0; i < n; i++) {
+        hashes[i] = hash_fn(key_bytes + (i * key_size));
+        sorted[i] = i;
+    }
+    sort_by_hash(sorted, pos_to_key, hashes, n);
+
+    // Every key with the same hash as the one before it goes to the stash, at the end of
+    // pos_to_key, still sorted by hash. The rest are packed down at the front of sorted.
+    uint32_t nmain = 0, nstash = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const uint32_t key = sorted[i];
+        if ((i == 0) || (hashes[key] != hashes[sorted[nmain - 1]])) {
+            sorted[nmain++] = key;
+            continue;
+        }
+
+        // the first key with this hash has been moved down to sorted[nmain - 1], and the others
+        // so far are the last ones put in the stash.
+        if (!cmp(key_bytes + (key * key_size), key_bytes + (sorted[nmain - 1] * key_size)))
+            return SAECLIB_ERROR_DUPLICATE_KEY;
+        for (uint32_t j = n - nstash; (j < n) && (hashes[pos_to_key[j]] == hashes[key]); j++) {
+            if (!cmp(key_bytes + (key * key_size), key_bytes + (pos_to_key[j] * key_size)))
+                return SAECLIB_ERROR_DUPLICATE_KEY;
+        }
+        pos_to_key[n - 1 - nstash] = key;
+        nstash++;
+    }
+    st.nmain = nmain;
+
+    // The stash was filled in from the end backwards; put it in hash order.
+    for (uint32_t lo = nmain, hi = n; (lo + 1) < hi; lo++, hi--) {
+        uint32_t swap = pos_to_key[lo];
+        pos_to_key[lo] = pos_to_key[hi - 1];
+        pos_to_key[hi - 1] = swap;
+    }
+
+    uint32_t seed;
+    for (seed = 0; seed < MAX_SEEDS; seed++) {
+        if (place_buckets(&st, seed))
+            break;
+    }
+    if (seed == MAX_SEEDS)
+        return SAECLIB_ERROR_OVERFLOW;
+
+    uint8_t* keyspace_bytes = keyspace;
+    for (uint32_t i = 0; i < n; i++) {
+        memcpy(keyspace_bytes + (i * key_size), key_bytes + (pos_to_key[i] * key_size), key_size);
+        if (order != NULL)
+            order[i] = pos_to_key[i];
+    }
+
+    mph->pilots = pilotspace;
+    mph->nbuckets = nbuckets;
+    mph->key_data = keyspace;
+    mph->key_elt_size = key_size;
+    mph->n = n;
+    mph->nmain = nmain;
+    mph->seed = seed;
+    mph->hash_fn = hash_fn;
+    mph->cmp = cmp;
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+saeclib_error_e saeclib_mph_lookup(const saeclib_mph_t* mph, const void* key, uint32_t* idx)
+{
+    if (mph->n == 0)
+        return SAECLIB_ERROR_UNDERFLOW;
+
+    const unsigned int hash = mph->hash_fn(key);
+    const uint64_t k = key_mix(mph->seed, hash);
+    const uint32_t i = slot_of(k, mph->pilots[bucket_of(k, mph->nbuckets)], mph->nmain);
+    if (!mph->cmp(key, get_keyptr_at_idx(mph, i))) {
+        *idx = i;
+        return SAECLIB_ERROR_NOERROR;
+    }
+
+    if (mph->nmain == mph->n)
+        return SAECLIB_ERROR_UNDERFLOW;
+
+    // binary search the stash for the first key with this hash.
+    uint32_t lo = mph->nmain, hi = mph->n;
+    while (lo < hi) {
+        uint32_t mid = lo + ((hi - lo) / 2);
+        if (mph->hash_fn(get_keyptr_at_idx(mph, mid)) < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for (; (lo < mph->n) && (mph->hash_fn(get_keyptr_at_idx(mph, lo)) == hash); lo++) {
+        if (!mph->cmp(key, get_keyptr_at_idx(mph, lo))) {
+            *idx = lo;
+            return SAECLIB_ERROR_NOERROR;
+        }
+    }
+
+    return SAECLIB_ERROR_UNDERFLOW;
+}
+
+
+saeclib_error_e saeclib_mph_emit_c(const saeclib_mph_t* mph,
+                                   FILE* f,
+                                   const char* name,
+                                   const char* hash_fn_name,
+                                   const char* cmp_name)
+{
+    fprintf(f, "/* Generated by saeclib_mph_emit_c. */\n\n");
+    fprintf(f, "#include \"saeclib_mph.h\"\n\n");
+    fprintf(f, "unsigned int %s(const void*);\n", hash_fn_name);
+    fprintf(f, "int %s(const void*, const void*);\n\n", cmp_name);
+
+    fprintf(f, "static const uint32_t %s_pilots[%u] = {", name, mph->nbuckets);
+    for (uint32_t b = 0; b < mph->nbuckets; b++) {
+        fprintf(f, "%s0x%08x,", ((b % 8) == 0) ? "\n    " : " ", mph->pilots[b]);
+    }
+    fprintf(f, "\n};\n\n");
+
+    // keys are read through the caller's key type by cmp, so keep them aligned for any type.
+    const size_t key_len = mph->n * mph->key_elt_size;
+    fprintf(f, "static const uint8_t %s_keys[%zu] __attribute__((aligned(16))) = {", name,
+            (key_len > 0) ? key_len : 1);
+    for (size_t i = 0; i < key_len; i++) {
+        fprintf(f, "%s0x%02x,", ((i % 12) == 0) ? "\n    " : " ", mph->key_data[i]);
+    }
+    fprintf(f, "\n};\n\n");
+
+    fprintf(f, "const saeclib_mph_t %s = {\n", name);
+    fprintf(f, "    .pilots = %s_pilots,\n", name);
+    fprintf(f, "    .nbuckets = %u,\n", mph->nbuckets);
+    fprintf(f, "    .key_data = %s_keys,\n", name);
+    fprintf(f, "    .key_elt_size = %zu,\n", mph->key_elt_size);
+    fprintf(f, "    .n = %u,\n", mph->n);
+    fprintf(f, "    .nmain = %u,\n", mph->nmain);
+    fprintf(f, "    .seed = %u,\n", mph->seed);
+    fprintf(f, "    .hash_fn = %s,\n", hash_fn_name);
+    fprintf(f, "    .cmp = %s,\n", cmp_name);
+    fprintf(f, "};\n");
+
+    return ferror(f) ? SAECLIB_ERROR_IO : SAECLIB_ERROR_NOERROR;
+}
@@ -0,0 +1,128 @@
+#ifndef _SAECLIB_MPH_H
+#define _SAECLIB_MPH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "saeclib_error.h"
+
+/**
+ * A minimal perfect hash maps each of a fixed set of n keys to its own index in [0, n), so a
+ * table built on it needs exactly n values and a lookup never probes: hash the key, read one pilot
+ * word, and compare against the one key that could be at the resulting index.
+ *
+ * It's built with the hash-and-displace method (as in CHD and PTHash). Keys are split into about
+ * n / 4 buckets by their hash. Starting with the biggest bucket, each bucket gets the first "pilot"
+ * value that, mixed into its keys' hashes, sends every one of them to an index no other key has
+ * taken yet.
+ *
+ * Keys are hashed with the same kind of hash_fn as saeclib_hash_table_t, and the hash is mixed
+ * with a seed before it's used, so weak hashes are fine. Two keys with the same 32-bit hash can't
+ * be told apart by any pilot, though. The builder puts every such key but the first into a small
+ * stash at the end of the index range, sorted by hash, which lookups binary search when the key
+ * at their main index doesn't match. With a good 32-bit hash, that's about n^2 / 2^33 keys.
+ *
+ * Building needs temporary memory, which the caller provides; see SAECLIB_MPH_WORKSPACE_SIZE.
+ * Once built, the pilots and keys can be written out as C source with saeclib_mph_emit_c, so
+ * that a program can include a perfect hash of a key set known at compile time as constant data.
+ */
+
+typedef struct saeclib_mph
+{
+    // One pilot per bucket.
+    const uint32_t* pilots;
+    uint32_t nbuckets;
+
+    // n keys, with the key whose index is i at i * key_elt_size.
+    const uint8_t* key_data;
+    size_t key_elt_size;
+    uint32_t n;
+
+    // Keys at indices [nmain, n) are in the stash.
+    uint32_t nmain;
+
+    // Mixed into every key's hash. The builder tries other seeds if it can't place every bucket.
+    uint32_t seed;
+
+    unsigned int (*hash_fn)(const void*);
+    int (*cmp)(const void*, const void*);
+} saeclib_mph_t;
+
+/**
+ * Number of pilots for n keys.
+ */
+#define SAECLIB_MPH_NBUCKETS(n) (((n) / 4) + 1)
+
+/**
+ * Bytes of workspace needed to build a minimal perfect hash of n keys.
+ */
+#define SAECLIB_MPH_WORKSPACE_SIZE(n) \
+    (sizeof(uint32_t) * ((4 * (size_t)(n)) + (2 * SAECLIB_MPH_NBUCKETS(n)) + 1 + (((n) + 31) / 32)))
+
+/**
+ * Builds a minimal perfect hash over a set of keys.
+ *
+ * @param[out]    mph       Minimal perfect hash to build.
+ * @param[in]     keys      nkeys keys, packed one after the other. They're copied into keyspace.
+ * @param[in]     nkeys     Number of keys. Must be less than 2^32.
+ * @param[in]     key_size  Size in bytes of each key.
+ * @param[in]     hash_fn   Hash function for keys.
+ * @param[in]     cmp       Compare function for keys, returning 0 if they're equal.
+ * @param[out]    pilotspace  Room for SAECLIB_MPH_NBUCKETS(nkeys) uint32_t.
+ * @param[out]    keyspace  Room for nkeys keys. Filled with the keys, each at its own index.
+ * @param[out]    order     If not NULL, room for nkeys uint32_t. order[i] is set to the position
+ *                          in keys of the key with index i, so that a values array in the same
+ *                          order as keys can be rearranged to match.
+ * @param[in]     workspace Temporary memory of SAECLIB_MPH_WORKSPACE_SIZE(nkeys) bytes, aligned
+ *                          for uint32_t. It isn't needed once the build is done.
+ * @param[in]     workspace_size  Size of workspace.
+ *
+ * @return SAECLIB_ERROR_DUPLICATE_KEY if the same key appears twice.
+ *         SAECLIB_ERROR_OVERFLOW if workspace is too small, or no seed worked (which shouldn't
+ *         happen with a reasonable hash_fn).
+ */
+saeclib_error_e saeclib_mph_build(saeclib_mph_t* mph,
+                                  const void* keys,
+                                  size_t nkeys,
+                                  size_t key_size,
+                                  unsigned int (*hash_fn)(const void*),
+                                  int (*cmp)(const void*, const void*),
+                                  uint32_t* pilotspace,
+                                  void* keyspace,
+                                  uint32_t* order,
+                                  void* workspace,
+                                  size_t workspace_size);
+
+/**
+ * Finds a key's index.
+ *
+ * @param[in]     mph       Minimal perfect hash.
+ * @param[in]     key       Key to look up.
+ * @param[out]    idx       The key's index in [0, n), if it's one of the keys.
+ *
+ * @return SAECLIB_ERROR_UNDERFLOW if the key isn't one of the keys the hash was built over.
+ */
+saeclib_error_e saeclib_mph_lookup(const saeclib_mph_t* mph, const void* key, uint32_t* idx);
+
+/**
+ * Writes C source that defines a saeclib_mph_t with the same pilots and keys as mph, as constant
+ * data. Keys are written byte for byte, so they must be plain data.
+ *
+ * @param[in]     mph       Minimal perfect hash.
+ * @param[in,out] f         Where to write the source.
+ * @param[in]     name      Name of the saeclib_mph_t to define. Its pilots and keys are defined as
+ *                          static arrays named name_pilots and name_keys.
+ * @param[in]     hash_fn_name  Name of mph's hash function in the generated source, which is
+ *                              declared there and has to be linked in.
+ * @param[in]     cmp_name  Same, for the compare function.
+ *
+ * @return SAECLIB_ERROR_IO if writing fails.
+ */
+saeclib_error_e saeclib_mph_emit_c(const saeclib_mph_t* mph,
+                                   FILE* f,
+                                   const char* name,
+                                   const char* hash_fn_name,
+                                   const char* cmp_name);
+
+#endif
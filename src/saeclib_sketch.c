@@ -0,0 +1,234 @@
+#include "saeclib_sketch.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "saeclib_hash_functions.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+static inline uint32_t add_saturating(uint32_t a, uint32_t b)
+{
+    const uint32_t sum = a + b;
+    return (sum < a) ? UINT32_MAX : sum;
+}
+
+/**
+ * Counter for a key in row r. The two halves of the mixed hash give every row its own index
+ * without hashing again: h1 + r * h2, with h2 odd so that it reaches every column.
+ */
+static inline size_t cms_index(const saeclib_count_min_t* cms, uint64_t h, size_t r)
+{
+    const uint32_t h1 = (uint32_t)h;
+    const uint32_t h2 = (uint32_t)(h >> 32) | 1;
+    return (r * cms->width) + ((h1 + (r * h2)) & cms->mask);
+}
+
+
+saeclib_error_e saeclib_count_min_init(saeclib_count_min_t* cms,
+                                       uint32_t* counterspace,
+                                       size_t counterspace_size,
+                                       size_t depth,
+                                       unsigned int (*hash_fn)(const void*))
+{
+    if (depth == 0)
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    const size_t width = counterspace_size / (depth * sizeof(uint32_t));
+    if ((width == 0) || ((width & (width - 1)) != 0))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    cms->counters = counterspace;
+    cms->width = width;
+    cms->mask = width - 1;
+    cms->depth = depth;
+    cms->hash_fn = hash_fn;
+    saeclib_count_min_clear(cms);
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+void saeclib_count_min_add(saeclib_count_min_t* cms, const void* key, uint32_t count)
+{
+    const uint64_t h = saeclib_hash_mix64(cms->hash_fn(key));
+
+    uint32_t min = UINT32_MAX;
+    for (size_t r = 0; r < cms->depth; r++) {
+        const uint32_t c = cms->counters[cms_index(cms, h, r)];
+        min = (c < min) ? c : min;
+    }
+
+    // The key's true count is at most min + count now, so no counter needs to go higher than
+    // that, and those that are already there stay put.
+    const uint32_t target = add_saturating(min, count);
+    for (size_t r = 0; r < cms->depth; r++) {
+        uint32_t* c = &cms->counters[cms_index(cms, h, r)];
+        if (*c < target)
+            *c = target;
+    }
+    cms->total += count;
+}
+
+
+uint32_t saeclib_count_min_estimate(const saeclib_count_min_t* cms, const void* key)
+{
+    const uint64_t h = saeclib_hash_mix64(cms->hash_fn(key));
+
+    uint32_t min = UINT32_MAX;
+    for (size_t r = 0; r < cms->depth; r++) {
+        const uint32_t c = cms->counters[cms_index(cms, h, r)];
+        min = (c < min) ? c : min;
+    }
+    return min;
+}
+
+
+saeclib_error_e saeclib_count_min_merge(saeclib_count_min_t* dst, const saeclib_count_min_t* src)
+{
+    if ((dst->width != src->width) || (dst->depth != src->depth) ||
+        (dst->hash_fn != src->hash_fn))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    uint32_t* d = dst->counters;
+    const uint32_t* s = src->counters;
+    const size_t n = dst->width * dst->depth;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    // SSE2 has no unsigned compare, so flip the sign bits and compare signed: a sum that's
+    // smaller than what it was added to has wrapped, and is saturated.
+    const __m128i sign = _mm_set1_epi32((int)0x80000000u);
+    for (; (i + 4) <= n; i += 4) {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(d + i));
+        const __m128i sum = _mm_add_epi32(a, _mm_loadu_si128((const __m128i*)(s + i)));
+        const __m128i wrapped = _mm_cmplt_epi32(_mm_xor_si128(sum, sign), _mm_xor_si128(a, sign));
+        _mm_storeu_si128((__m128i*)(d + i), _mm_or_si128(sum, wrapped));
+    }
+#elif defined(__ARM_NEON)
+    for (; (i + 4) <= n; i += 4) {
+        vst1q_u32(d + i, vqaddq_u32(vld1q_u32(d + i), vld1q_u32(s + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        d[i] = add_saturating(d[i], s[i]);
+    }
+
+    dst->total += src->total;
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+void saeclib_count_min_clear(saeclib_count_min_t* cms)
+{
+    memset(cms->counters, 0, cms->width * cms->depth * sizeof(uint32_t));
+    cms->total = 0;
+}
+
+
+saeclib_error_e saeclib_hyperloglog_init(saeclib_hyperloglog_t* hll,
+                                         uint8_t* registerspace,
+                                         size_t registerspace_size,
+                                         size_t precision,
+                                         unsigned int (*hash_fn)(const void*))
+{
+    if ((precision < SAECLIB_HYPERLOGLOG_MIN_PRECISION) ||
+        (precision > SAECLIB_HYPERLOGLOG_MAX_PRECISION) ||
+        (registerspace_size < ((size_t)1 << precision)))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    hll->registers = registerspace;
+    hll->precision = precision;
+    hll->hash_fn = hash_fn;
+    saeclib_hyperloglog_clear(hll);
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+void saeclib_hyperloglog_add(saeclib_hyperloglog_t* hll, const void* key)
+{
+    const uint64_t h = saeclib_hash_mix64(hll->hash_fn(key));
+
+    // The top bits pick the register; the rest, with a 1 below them so that there's always a set
+    // bit to stop at, give the run of zeros.
+    const size_t idx = h >> (64 - hll->precision);
+    const uint64_t rest = (h << hll->precision) | ((uint64_t)1 << (hll->precision - 1));
+    const uint8_t rank = __builtin_clzll(rest) + 1;
+
+    if (hll->registers[idx] < rank)
+        hll->registers[idx] = rank;
+}
+
+
+double saeclib_hyperloglog_estimate(const saeclib_hyperloglog_t* hll)
+{
+    const size_t m = (size_t)1 << hll->precision;
+
+    // Registers only go up to 65 - precision, so a histogram of their values is all that's needed
+    // to add up 2^-register over all of them.
+    uint32_t histogram[66] = { 0 };
+    for (size_t i = 0; i < m; i++) {
+        histogram[hll->registers[i]]++;
+    }
+
+    double sum = 0.0;
+    for (int r = 65; r >= 0; r--) {
+        sum = (sum * 0.5) + histogram[r];
+    }
+
+    double alpha;
+    switch (m) {
+        case 16: alpha = 0.673; break;
+        case 32: alpha = 0.697; break;
+        case 64: alpha = 0.709; break;
+        default: alpha = 0.7213 / (1.0 + (1.079 / m)); break;
+    }
+    const double estimate = alpha * m * m / sum;
+
+    // Below about 2.5 m, the raw estimate is biased upwards; counting the empty registers (linear
+    // counting) does better there, as long as there are some.
+    if ((estimate <= (2.5 * m)) && (histogram[0] != 0))
+        return m * log((double)m / histogram[0]);
+    return estimate;
+}
+
+
+saeclib_error_e saeclib_hyperloglog_merge(saeclib_hyperloglog_t* dst,
+                                          const saeclib_hyperloglog_t* src)
+{
+    if ((dst->precision != src->precision) || (dst->hash_fn != src->hash_fn))
+        return SAECLIB_ERROR_BAD_STRUCTURE;
+
+    uint8_t* d = dst->registers;
+    const uint8_t* s = src->registers;
+    const size_t n = (size_t)1 << dst->precision;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    for (; (i + 16) <= n; i += 16) {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(d + i));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(s + i));
+        _mm_storeu_si128((__m128i*)(d + i), _mm_max_epu8(a, b));
+    }
+#elif defined(__ARM_NEON)
+    for (; (i + 16) <= n; i += 16) {
+        vst1q_u8(d + i, vmaxq_u8(vld1q_u8(d + i), vld1q_u8(s + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        d[i] = (s[i] > d[i]) ? s[i] : d[i];
+    }
+
+    return SAECLIB_ERROR_NOERROR;
+}
+
+
+void saeclib_hyperloglog_clear(saeclib_hyperloglog_t* hll)
+{
+    memset(hll->registers, 0, (size_t)1 << hll->precision);
+}
@@ -0,0 +1,184 @@
+#ifndef _SAECLIB_SKETCH_H
+#define _SAECLIB_SKETCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "saeclib_error.h"
+#include "saeclib_hash.h"
+
+/**
+ * Fixed-size summaries of a stream of keys, for when there are too many different keys to keep a
+ * hash table entry for each: a count-min sketch estimates how many times each key was seen, and
+ * a HyperLogLog estimates how many different keys there were. Their memory doesn't grow with the
+ * number of keys, and every add takes the same short time.
+ *
+ * Two sketches of the same shape and hash function can be merged, so each thread can keep its
+ * own and they can be combined afterwards. Merges work through the counters or registers 16 bytes
+ * at a time with SSE2 or NEON.
+ *
+ * Both sketches run the user's 32-bit hash through saeclib_hash_mix64 before use, so weak hashes
+ * like saeclib_hash_table_u32_hash are fine, but keys whose 32-bit hashes are equal are counted
+ * as the same key.
+ */
+
+
+/**
+ * Count-min sketch: depth rows of width counters. Each key adds to one counter in every row, and
+ * its estimate is the smallest of its counters, which is never less than its true count. Adds use
+ * conservative update: only the counters that are at that minimum are raised, which keeps
+ * estimates much closer to the truth than raising all of them would.
+ *
+ * With N counted in total, an estimate is more than (2.72 / width) * N over the true count with
+ * probability at most e^-depth.
+ *
+ * Counters saturate at UINT32_MAX instead of wrapping.
+ */
+
+typedef struct saeclib_count_min
+{
+    // depth rows of width counters, one row after the other.
+    uint32_t* counters;
+    size_t width;
+    size_t mask;
+    size_t depth;
+
+    unsigned int (*hash_fn)(const void*);
+
+    // sum of all counts added, including through merges.
+    uint64_t total;
+} saeclib_count_min_t;
+
+/**
+ * Initializes an empty count-min sketch.
+ *
+ * @param[in,out] cms       Sketch to initialize.
+ * @param[in]     counterspace  Memory for 'width * depth' uint32_t counters, where width is a
+ *                              power of two. It's cleared here.
+ * @param[in]     counterspace_size  Size of counterspace in bytes.
+ * @param[in]     depth     Number of rows, at least 1.
+ * @param[in]     hash_fn   Hash function for keys.
+ *
+ * @return SAECLIB_ERROR_BAD_STRUCTURE if depth is 0 or the width isn't a power of two.
+ */
+saeclib_error_e saeclib_count_min_init(saeclib_count_min_t* cms,
+                                       uint32_t* counterspace,
+                                       size_t counterspace_size,
+                                       size_t depth,
+                                       unsigned int (*hash_fn)(const void*));
+
+/**
+ * Statically allocates a count-min sketch. width must be a power of two. The same cautions as for
+ * saeclib_hash_table_salloc apply.
+ */
+#define saeclib_count_min_salloc(width, depth, hash_fn)                                           \
+    ({                                                                                            \
+    saeclib_count_min_t cms;                                                                      \
+    static uint32_t counterspace[(width) * (depth)] __attribute__((aligned(64)));                 \
+    saeclib_count_min_init(&cms, counterspace, sizeof(counterspace), depth, hash_fn);             \
+    cms;                                                                                          \
+    })
+
+/**
+ * Counts count more occurrences of a key.
+ */
+void saeclib_count_min_add(saeclib_count_min_t* cms, const void* key, uint32_t count);
+
+/**
+ * Estimated number of occurrences of a key. Never less than the true number, unless the counters
+ * saturated.
+ */
+uint32_t saeclib_count_min_estimate(const saeclib_count_min_t* cms, const void* key);
+
+/**
+ * Adds src's counters into dst's. Estimates from dst afterwards are never less than the true
+ * counts of the two streams together.
+ *
+ * @return SAECLIB_ERROR_BAD_STRUCTURE if the sketches don't have the same width, depth and hash
+ *         function.
+ */
+saeclib_error_e saeclib_count_min_merge(saeclib_count_min_t* dst, const saeclib_count_min_t* src);
+
+/**
+ * Empties the sketch.
+ */
+void saeclib_count_min_clear(saeclib_count_min_t* cms);
+
+
+/**
+ * HyperLogLog: 2^precision one-byte registers. Each key's hash picks a register and is
+ * remembered there only by its number of leading zero bits, so the registers hold the longest
+ * runs of zeros seen, from which the number of different keys can be estimated. Adding a key
+ * that's already been seen changes nothing.
+ *
+ * The estimate's relative standard error is about 1.04 / sqrt(2^precision): 1.6% for precision
+ * 12 (4 KiB), 0.8% for precision 14 (16 KiB). Small counts are estimated by counting empty
+ * registers instead, which is more accurate there.
+ */
+
+#define SAECLIB_HYPERLOGLOG_MIN_PRECISION 4
+#define SAECLIB_HYPERLOGLOG_MAX_PRECISION 18
+
+typedef struct saeclib_hyperloglog
+{
+    uint8_t* registers;
+    size_t precision;
+
+    unsigned int (*hash_fn)(const void*);
+} saeclib_hyperloglog_t;
+
+/**
+ * Initializes an empty HyperLogLog.
+ *
+ * @param[in,out] hll       Sketch to initialize.
+ * @param[in]     registerspace  Memory for 2^precision registers. It's cleared here.
+ * @param[in]     registerspace_size  Size of registerspace in bytes.
+ * @param[in]     precision Log2 of the number of registers, from SAECLIB_HYPERLOGLOG_MIN_PRECISION
+ *                          to SAECLIB_HYPERLOGLOG_MAX_PRECISION.
+ * @param[in]     hash_fn   Hash function for keys.
+ *
+ * @return SAECLIB_ERROR_BAD_STRUCTURE if precision is out of range or registerspace is too small.
+ */
+saeclib_error_e saeclib_hyperloglog_init(saeclib_hyperloglog_t* hll,
+                                         uint8_t* registerspace,
+                                         size_t registerspace_size,
+                                         size_t precision,
+                                         unsigned int (*hash_fn)(const void*));
+
+/**
+ * Statically allocates a HyperLogLog. The same cautions as for saeclib_hash_table_salloc apply.
+ */
+#define saeclib_hyperloglog_salloc(precision, hash_fn)                                            \
+    ({                                                                                            \
+    saeclib_hyperloglog_t hll;                                                                    \
+    static uint8_t registerspace[(size_t)1 << (precision)] __attribute__((aligned(64)));          \
+    saeclib_hyperloglog_init(&hll, registerspace, sizeof(registerspace), precision, hash_fn);     \
+    hll;                                                                                          \
+    })
+
+/**
+ * Adds a key.
+ */
+void saeclib_hyperloglog_add(saeclib_hyperloglog_t* hll, const void* key);
+
+/**
+ * Estimated number of different keys added.
+ */
+double saeclib_hyperloglog_estimate(const saeclib_hyperloglog_t* hll);
+
+/**
+ * Makes dst count every key that was added to either sketch. The result is exactly what dst
+ * would hold if src's keys had been added to it too.
+ *
+ * @return SAECLIB_ERROR_BAD_STRUCTURE if the sketches don't have the same precision and hash
+ *         function.
+ */
+saeclib_error_e saeclib_hyperloglog_merge(saeclib_hyperloglog_t* dst,
+                                          const saeclib_hyperloglog_t* src);
+
+/**
+ * Empties the sketch.
+ */
+void saeclib_hyperloglog_clear(saeclib_hyperloglog_t* hll);
+
+#endif
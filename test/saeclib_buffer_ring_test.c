@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "unity.h"
+
+#include "saeclib_buffer_ring.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/**
+ * Test to see if the buffer ring is being initialized correctly.
+ */
+void saeclib_buffer_ring_init_test()
+{
+#define NUMBUFS 8
+#define BUFSIZE 256
+
+    static uint8_t poolspace[NUMBUFS * BUFSIZE];
+    saeclib_circular_buffer_t free_bufs = saeclib_circular_buffer_salloc(NUMBUFS + 1, sizeof(uint32_t));
+    saeclib_circular_buffer_t sq = saeclib_circular_buffer_salloc(5, sizeof(saeclib_buffer_desc_t));
+    saeclib_circular_buffer_t cq = saeclib_circular_buffer_salloc(5, sizeof(saeclib_buffer_desc_t));
+
+    saeclib_buffer_ring_t ring;
+    saeclib_error_e err = saeclib_buffer_ring_init(&ring, poolspace, sizeof(poolspace), BUFSIZE,
+                                                   &free_bufs, &sq, &cq);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    TEST_ASSERT_EQUAL_PTR(poolspace, ring.data);
+    TEST_ASSERT_EQUAL_INT(NUMBUFS, ring.buf_count);
+    TEST_ASSERT_EQUAL_INT(NUMBUFS, saeclib_buffer_ring_free_count(&ring));
+    TEST_ASSERT_EQUAL_PTR(poolspace + (3 * BUFSIZE), saeclib_buffer_ring_buffer(&ring, 3));
+
+    // a free list that can't hold every buffer is rejected.
+    saeclib_circular_buffer_t small_free = saeclib_circular_buffer_salloc(NUMBUFS, sizeof(uint32_t));
+    err = saeclib_buffer_ring_init(&ring, poolspace, sizeof(poolspace), BUFSIZE,
+                                   &small_free, &sq, &cq);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, err);
+
+    // zero-sized buffers, a pool too small for one buffer, and more buffers than a uint32_t index
+    // can name. None of these touch the pool or the free list.
+    err = saeclib_buffer_ring_init(&ring, poolspace, sizeof(poolspace), 0, &free_bufs, &sq, &cq);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, err);
+    err = saeclib_buffer_ring_init(&ring, poolspace, BUFSIZE - 1, BUFSIZE, &free_bufs, &sq, &cq);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, err);
+#if SIZE_MAX > UINT32_MAX
+    err = saeclib_buffer_ring_init(&ring, poolspace, ((size_t)UINT32_MAX + 1) * 2, 2, &free_bufs,
+                                   &sq, &cq);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, err);
+#endif
+
+    err = saeclib_buffer_ring_init(&ring, poolspace, sizeof(poolspace), BUFSIZE, &free_bufs, NULL, &cq);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NULL_POINTER, err);
+
+#undef NUMBUFS
+#undef BUFSIZE
+}
+
+/**
+ * Run every buffer in the pool through submission and completion, making sure that the payload
+ * isn't copied and that every buffer makes it back to the pool.
+ */
+void saeclib_buffer_ring_round_trip_test()
+{
+#define NUMBUFS 4
+
+    saeclib_buffer_ring_t ring = saeclib_buffer_ring_salloc(NUMBUFS, 512, NUMBUFS);
+    TEST_ASSERT_EQUAL_INT(NUMBUFS, saeclib_buffer_ring_free_count(&ring));
+
+    uint8_t* bufptrs[NUMBUFS];
+    for (int i = 0; i < NUMBUFS; i++) {
+        uint32_t idx;
+        saeclib_error_e err = saeclib_buffer_ring_acquire(&ring, &idx);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+        bufptrs[i] = saeclib_buffer_ring_buffer(&ring, idx);
+        memset(bufptrs[i], i, 512);
+
+        saeclib_buffer_desc_t desc = { .buf_idx = idx, .len = 100 + i, .flags = i };
+        err = saeclib_buffer_ring_submit(&ring, &desc);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    }
+
+    // pool is empty now
+    uint32_t idx;
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, saeclib_buffer_ring_acquire(&ring, &idx));
+
+    // worker stage: modify payloads in place
+    for (int i = 0; i < NUMBUFS; i++) {
+        saeclib_buffer_desc_t desc;
+        saeclib_error_e err = saeclib_buffer_ring_take(&ring, &desc);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+        TEST_ASSERT_EQUAL_INT(100 + i, desc.len);
+        TEST_ASSERT_EQUAL_INT(i, desc.flags);
+
+        uint8_t* p = saeclib_buffer_ring_buffer(&ring, desc.buf_idx);
+        TEST_ASSERT_EQUAL_PTR(bufptrs[i], p);
+        TEST_ASSERT_EQUAL_UINT8(i, p[0]);
+        p[0] = 0xa0 + i;
+
+        err = saeclib_buffer_ring_complete(&ring, &desc);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    }
+
+    saeclib_buffer_desc_t desc;
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, saeclib_buffer_ring_take(&ring, &desc));
+
+    for (int i = 0; i < NUMBUFS; i++) {
+        saeclib_error_e err = saeclib_buffer_ring_reap(&ring, &desc);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+        TEST_ASSERT_EQUAL_UINT8(0xa0 + i, saeclib_buffer_ring_buffer(&ring, desc.buf_idx)[0]);
+
+        err = saeclib_buffer_ring_release(&ring, desc.buf_idx);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    }
+
+    TEST_ASSERT_EQUAL_INT(NUMBUFS, saeclib_buffer_ring_free_count(&ring));
+
+#undef NUMBUFS
+}
+
+/**
+ * Descriptors that don't refer to a pool buffer never make it into a queue.
+ */
+void saeclib_buffer_ring_bad_desc_test()
+{
+    saeclib_buffer_ring_t ring = saeclib_buffer_ring_salloc(4, 64, 4);
+
+    saeclib_buffer_desc_t desc = { .buf_idx = 4, .len = 10, .flags = 0 };
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, saeclib_buffer_ring_submit(&ring, &desc));
+
+    desc.buf_idx = 0;
+    desc.len = 65;
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, saeclib_buffer_ring_complete(&ring, &desc));
+
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, saeclib_buffer_ring_release(&ring, 7));
+
+    // releasing a buffer when every buffer is already in the pool overflows the free list.
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, saeclib_buffer_ring_release(&ring, 0));
+}
+
+
+#define PIPELINE_NUM_PACKETS 100000
+
+static void* pipeline_worker(void* arg)
+{
+    saeclib_buffer_ring_t* ring = arg;
+    for (int i = 0; i < PIPELINE_NUM_PACKETS; ) {
+        saeclib_buffer_desc_t desc;
+        if (saeclib_buffer_ring_take(ring, &desc) != SAECLIB_ERROR_NOERROR)
+            continue;
+
+        // checksum the payload into its last word
+        uint8_t* p = saeclib_buffer_ring_buffer(ring, desc.buf_idx);
+        uint32_t sum = 0;
+        for (int j = 0; j < desc.len; j++) sum += p[j];
+        memcpy(p + desc.len, &sum, sizeof(sum));
+
+        while (saeclib_buffer_ring_complete(ring, &desc) != SAECLIB_ERROR_NOERROR);
+        i++;
+    }
+    return NULL;
+}
+
+/**
+ * Push packets through a worker thread and check that each one comes back in order with the right
+ * checksum. The queues are as deep as the pool, so submitting an acquired buffer can't fail.
+ */
+void saeclib_buffer_ring_threaded_test()
+{
+    static saeclib_buffer_ring_t ring;
+    ring = saeclib_buffer_ring_salloc(16, 256, 16);
+
+    pthread_t worker;
+    pthread_create(&worker, NULL, pipeline_worker, &ring);
+
+    int submitted = 0, reaped = 0;
+    while (reaped < PIPELINE_NUM_PACKETS) {
+        uint32_t idx;
+        if ((submitted < PIPELINE_NUM_PACKETS) &&
+            (saeclib_buffer_ring_acquire(&ring, &idx) == SAECLIB_ERROR_NOERROR)) {
+            uint8_t* p = saeclib_buffer_ring_buffer(&ring, idx);
+            uint32_t len = 1 + (submitted % 200);
+            for (int j = 0; j < len; j++) p[j] = submitted + j;
+            saeclib_buffer_desc_t desc = { .buf_idx = idx, .len = len, .flags = submitted };
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_buffer_ring_submit(&ring, &desc));
+            submitted++;
+        }
+
+        saeclib_buffer_desc_t desc;
+        if (saeclib_buffer_ring_reap(&ring, &desc) == SAECLIB_ERROR_NOERROR) {
+            TEST_ASSERT_EQUAL_INT(reaped, desc.flags);
+            uint32_t expected = 0, sum;
+            for (int j = 0; j < desc.len; j++) expected += (uint8_t)(reaped + j);
+            memcpy(&sum, saeclib_buffer_ring_buffer(&ring, desc.buf_idx) + desc.len, sizeof(sum));
+            TEST_ASSERT_EQUAL_UINT32(expected, sum);
+            saeclib_buffer_ring_release(&ring, desc.buf_idx);
+            reaped++;
+        }
+    }
+
+    pthread_join(worker, NULL);
+    TEST_ASSERT_EQUAL_INT(16, saeclib_buffer_ring_free_count(&ring));
+}
+
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(saeclib_buffer_ring_init_test);
+    RUN_TEST(saeclib_buffer_ring_round_trip_test);
+    RUN_TEST(saeclib_buffer_ring_bad_desc_test);
+    RUN_TEST(saeclib_buffer_ring_threaded_test);
+    return UNITY_END();
+}
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <pthread.h>
 
 #include "unity.h"
 
@@ -256,6 +257,128 @@ void saeclib_circular_buffer_pushone_popmany_test()
 #undef NUMEL
 }
 
+/**
+ * Snapshots should hold the most recently pushed elements, oldest first, even after they've been
+ * popped and even when they straddle the end of the buffer.
+ */
+void saeclib_circular_buffer_snapshot_test()
+{
+#define NUMEL 8
+
+    saeclib_circular_buffer_t scb = saeclib_circular_buffer_salloc(NUMEL, sizeof(uint32_t));
+    uint32_t snap[NUMEL];
+    uint32_t copied = 1234;
+
+    // nothing pushed yet
+    saeclib_error_e err = saeclib_circular_buffer_snapshot(&scb, snap, 4, &copied);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    TEST_ASSERT_EQUAL_INT(0, copied);
+
+    for (uint32_t i = 0; i < 3; i++) {
+        saeclib_circular_buffer_pushone(&scb, &i);
+    }
+    err = saeclib_circular_buffer_snapshot(&scb, snap, 4, &copied);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    TEST_ASSERT_EQUAL_INT(3, copied);
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(((uint32_t[]){ 0, 1, 2 }), snap, 3);
+
+    // wrap around a few times, popping as we go.
+    for (uint32_t i = 3; i < 21; i++) {
+        uint32_t x;
+        saeclib_circular_buffer_popone(&scb, &x);
+        saeclib_circular_buffer_pushone(&scb, &i);
+    }
+    err = saeclib_circular_buffer_snapshot(&scb, snap, NUMEL, &copied);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    TEST_ASSERT_EQUAL_INT(NUMEL - 1, copied);
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(((uint32_t[]){ 14, 15, 16, 17, 18, 19, 20 }), snap, NUMEL - 1);
+
+    // snapshots don't disturb the buffer.
+    TEST_ASSERT_EQUAL_INT(3, saeclib_circular_buffer_size(&scb));
+
+#undef NUMEL
+}
+
+/**
+ * Push and pop elements of every size that has its own copy routine, plus a few that don't, and
+ * make sure nothing spills over into neighboring elements.
+ */
+void saeclib_circular_buffer_elt_size_test()
+{
+#define NUMEL 5
+    static const size_t sizes[] = { 1, 2, 3, 4, 8, 12, 16, 32, 48, 256, 300 };
+    static uint8_t bufspace[NUMEL * 300];
+
+    for (int s = 0; s < (sizeof(sizes) / sizeof(sizes[0])); s++) {
+        const size_t elt_size = sizes[s];
+        saeclib_circular_buffer_t scb;
+        saeclib_circular_buffer_init(&scb, bufspace, NUMEL * elt_size, elt_size);
+
+        for (int i = 0; i < 3 * NUMEL; i++) {
+            uint8_t in[300], out[301];
+            for (int j = 0; j < elt_size; j++) in[j] = (i * 31) + j;
+            out[elt_size] = 0xee;
+
+            saeclib_error_e err = saeclib_circular_buffer_pushone(&scb, in);
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+            err = saeclib_circular_buffer_popone(&scb, out);
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+            TEST_ASSERT_EQUAL_MEMORY(in, out, elt_size);
+            TEST_ASSERT_EQUAL_UINT8(0xee, out[elt_size]);
+        }
+    }
+
+#undef NUMEL
+}
+
+
+static volatile int snapshot_producer_done;
+
+static void* snapshot_producer(void* arg)
+{
+    saeclib_circular_buffer_t* scb = arg;
+    for (uint32_t i = 0; i < 2000000; i++) {
+        uint32_t x;
+        if (saeclib_circular_buffer_pushone(scb, &i) == SAECLIB_ERROR_OVERFLOW) {
+            saeclib_circular_buffer_popone(scb, &x);
+            saeclib_circular_buffer_pushone(scb, &i);
+        }
+    }
+    snapshot_producer_done = 1;
+    return NULL;
+}
+
+/**
+ * Take snapshots while another thread is pushing and popping as fast as it can. Every snapshot
+ * must be a run of consecutive counter values; a torn copy would show up as a gap.
+ */
+void saeclib_circular_buffer_snapshot_threaded_test()
+{
+#define NUMEL 64
+
+    static saeclib_circular_buffer_t scb;
+    scb = saeclib_circular_buffer_salloc(NUMEL, sizeof(uint32_t));
+
+    snapshot_producer_done = 0;
+    pthread_t producer;
+    pthread_create(&producer, NULL, snapshot_producer, &scb);
+
+    int snapshots = 0;
+    while (!snapshot_producer_done || (snapshots < 10)) {
+        uint32_t snap[48];
+        uint32_t copied;
+        saeclib_circular_buffer_snapshot(&scb, snap, 48, &copied);
+        for (uint32_t i = 1; i < copied; i++) {
+            TEST_ASSERT_EQUAL_UINT32(snap[i - 1] + 1, snap[i]);
+        }
+        snapshots++;
+    }
+
+    pthread_join(producer, NULL);
+
+#undef NUMEL
+}
+
 
 int main(int argc, char** argv)
 {
@@ -270,5 +393,8 @@ int main(int argc, char** argv)
     RUN_TEST(saeclib_circular_buffer_overflow_test);
     RUN_TEST(saeclib_circular_buffer_pushmany_popone_test);
     RUN_TEST(saeclib_circular_buffer_pushone_popmany_test);
+    RUN_TEST(saeclib_circular_buffer_elt_size_test);
+    RUN_TEST(saeclib_circular_buffer_snapshot_test);
+    RUN_TEST(saeclib_circular_buffer_snapshot_threaded_test);
     return UNITY_END();
 }
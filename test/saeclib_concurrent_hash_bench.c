@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "saeclib_concurrent_hash.h"
+#include "saeclib_hash.h"
+
+/**
+ * Compares throughput of saeclib_concurrent_hash_table_t against a saeclib_hash_table_t behind one
+ * mutex, for 1 to MAX_THREADS threads doing a connection-tracking-like mix of operations: mostly
+ * lookups, with the rest split between inserts and deletes of each thread's own keys.
+ */
+
+#define CAPACITY       (1 << 20)
+#define KEYS_PER_THREAD (CAPACITY / 2 / MAX_THREADS)
+#define OPS_PER_THREAD 2000000
+#define MAX_THREADS    8
+
+static uint32_t keys[CAPACITY];
+static uint64_t values[CAPACITY];
+static uint32_t ctrl[CAPACITY];
+static uint8_t status[CAPACITY];
+
+static saeclib_concurrent_hash_table_t cht;
+static saeclib_hash_table_t sht;
+static pthread_mutex_t sht_lock = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct worker_ctx
+{
+    int thread;
+    int concurrent;
+} worker_ctx_t;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec * 1e-9);
+}
+
+static void* worker(void* arg)
+{
+    worker_ctx_t* ctx = arg;
+    unsigned int seed = ctx->thread + 1;
+    uint64_t v = 0;
+    for (int i = 0; i < OPS_PER_THREAD; i++) {
+        uint32_t key = ((rand_r(&seed) % KEYS_PER_THREAD) * MAX_THREADS) + ctx->thread;
+        int op = rand_r(&seed) % 10;
+        if (ctx->concurrent) {
+            if (op == 0)
+                saeclib_concurrent_hash_insert(&cht, &key, &v);
+            else if (op == 1)
+                saeclib_concurrent_hash_delete(&cht, &key);
+            else
+                saeclib_concurrent_hash_search(&cht, &key, &v);
+        } else {
+            pthread_mutex_lock(&sht_lock);
+            if (op == 0)
+                saeclib_hash_insert(&sht, &key, &v);
+            else if (op == 1)
+                saeclib_hash_delete(&sht, &key);
+            else
+                saeclib_hash_search(&sht, &key, &v);
+            pthread_mutex_unlock(&sht_lock);
+        }
+    }
+    return NULL;
+}
+
+static void run(int nthreads, int concurrent)
+{
+    saeclib_concurrent_hash_table_init(&cht, keys, values, ctrl, sizeof(keys), sizeof(uint32_t),
+                                       sizeof(uint64_t), saeclib_hash_table_u32_hash,
+                                       saeclib_hash_table_u32_cmp);
+    saeclib_hash_table_init_pow2(&sht, keys, values, status, sizeof(keys), sizeof(uint32_t),
+                                 sizeof(uint64_t), saeclib_hash_table_u32_hash,
+                                 saeclib_hash_table_u32_cmp);
+
+    pthread_t threads[MAX_THREADS];
+    worker_ctx_t ctx[MAX_THREADS];
+    double start = now();
+    for (int i = 0; i < nthreads; i++) {
+        ctx[i] = (worker_ctx_t){ i, concurrent };
+        pthread_create(&threads[i], NULL, worker, &ctx[i]);
+    }
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = now() - start;
+
+    printf("%-12s %d threads   %8.2f Mops/s\n", concurrent ? "concurrent" : "mutex", nthreads,
+           ((double)nthreads * OPS_PER_THREAD) / elapsed / 1e6);
+}
+
+int main(int argc, char** argv)
+{
+    printf("saeclib_concurrent_hash_bench: %d buckets, 80%% search / 10%% insert / 10%% delete\n",
+           CAPACITY);
+    for (int nthreads = 1; nthreads <= MAX_THREADS; nthreads *= 2) {
+        run(nthreads, 0);
+        run(nthreads, 1);
+    }
+    return 0;
+}
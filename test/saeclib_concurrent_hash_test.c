@@ -0,0 +1,452 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "unity.h"
+
+#include "saeclib_concurrent_hash.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void saeclib_concurrent_hash_table_init_test()
+{
+#define NUMEL 128
+
+    saeclib_concurrent_hash_table_t cht;
+    static uint32_t keyspace[NUMEL];
+    static uint32_t valuespace[NUMEL];
+    static uint32_t ctrlspace[NUMEL];
+
+    saeclib_error_e err = saeclib_concurrent_hash_table_init(&cht, keyspace, valuespace, ctrlspace,
+                                                             sizeof(keyspace), sizeof(uint32_t),
+                                                             sizeof(uint32_t),
+                                                             saeclib_hash_table_u32_hash,
+                                                             saeclib_hash_table_u32_cmp);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    TEST_ASSERT_EQUAL_INT(NUMEL, cht.capacity);
+
+    // not a power of two
+    err = saeclib_concurrent_hash_table_init(&cht, keyspace, valuespace, ctrlspace,
+                                             sizeof(keyspace) - sizeof(uint32_t), sizeof(uint32_t),
+                                             sizeof(uint32_t), saeclib_hash_table_u32_hash,
+                                             saeclib_hash_table_u32_cmp);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, err);
+
+    cht = saeclib_concurrent_hash_table_salloc(100, sizeof(uint32_t), sizeof(uint32_t),
+                                               saeclib_hash_table_u32_hash,
+                                               saeclib_hash_table_u32_cmp);
+    TEST_ASSERT_EQUAL_INT(128, cht.capacity);
+
+#undef NUMEL
+}
+
+/**
+ * From a single thread, the table behaves like any other hash table: random inserts, searches and
+ * deletes agree with a plain array, including once the table is full of tombstones.
+ */
+void saeclib_concurrent_hash_fuzz_test()
+{
+#define NUMEL 64
+    saeclib_concurrent_hash_table_t cht =
+        saeclib_concurrent_hash_table_salloc(NUMEL, sizeof(uint32_t), sizeof(uint32_t),
+                                             saeclib_hash_table_u32_hash,
+                                             saeclib_hash_table_u32_cmp);
+
+    static bool present[4 * NUMEL];
+    size_t size = 0;
+    srand(0);
+    for (int i = 0; i < 100000; i++) {
+        uint32_t key = rand() % (4 * NUMEL);
+        uint32_t value;
+        saeclib_error_e err;
+        switch (rand() % 3) {
+            case 0:
+                err = saeclib_concurrent_hash_insert(&cht, &key, (uint32_t[]){ key * 5 });
+                if (present[key]) {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_DUPLICATE_KEY, err);
+                } else if (size == NUMEL) {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_OVERFLOW, err);
+                } else {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                    present[key] = true;
+                    size++;
+                }
+                break;
+
+            case 1:
+                err = saeclib_concurrent_hash_search(&cht, &key, &value);
+                if (present[key]) {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                    TEST_ASSERT_EQUAL_INT(key * 5, value);
+                } else {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+                }
+                break;
+
+            case 2:
+                err = saeclib_concurrent_hash_delete(&cht, &key);
+                if (present[key]) {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                    present[key] = false;
+                    size--;
+                } else {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+                }
+                break;
+        }
+    }
+
+#undef NUMEL
+}
+
+
+/**
+ * After lots of churn the table has no EMPTY buckets left. Purging turns every tombstone back into
+ * an EMPTY bucket and keeps every key that was there, and the table carries on working afterwards.
+ */
+void saeclib_concurrent_hash_purge_test()
+{
+#define NUMEL 64
+    saeclib_concurrent_hash_table_t cht =
+        saeclib_concurrent_hash_table_salloc(NUMEL, sizeof(uint32_t), sizeof(uint32_t),
+                                             saeclib_hash_table_u32_hash,
+                                             saeclib_hash_table_u32_cmp);
+
+    static bool present[4 * NUMEL];
+    srand(1);
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < 2000; i++) {
+            uint32_t key = rand() % (4 * NUMEL);
+            if (rand() % 2) {
+                if (saeclib_concurrent_hash_insert(&cht, &key, (uint32_t[]){ key * 5 }) ==
+                    SAECLIB_ERROR_NOERROR)
+                    present[key] = true;
+            } else if (saeclib_concurrent_hash_delete(&cht, &key) == SAECLIB_ERROR_NOERROR) {
+                present[key] = false;
+            }
+        }
+
+        // the state is the low 3 bits of each control word: 0 for EMPTY, 3 for FULL.
+        int empty = 0, full = 0;
+        for (int i = 0; i < NUMEL; i++) {
+            empty += ((cht.ctrl[i] & 7) == 0);
+        }
+        TEST_ASSERT_EQUAL_INT(0, empty);
+
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_concurrent_hash_purge(&cht));
+        int npresent = 0;
+        for (uint32_t key = 0; key < (4 * NUMEL); key++) {
+            uint32_t value;
+            npresent += present[key];
+            if (present[key]) {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                                      saeclib_concurrent_hash_search(&cht, &key, &value));
+                TEST_ASSERT_EQUAL_INT(key * 5, value);
+            } else {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW,
+                                      saeclib_concurrent_hash_search(&cht, &key, &value));
+            }
+        }
+        for (int i = 0; i < NUMEL; i++) {
+            empty += ((cht.ctrl[i] & 7) == 0);
+            full += ((cht.ctrl[i] & 7) == 3);
+        }
+        TEST_ASSERT_EQUAL_INT(npresent, full);
+        TEST_ASSERT_EQUAL_INT(NUMEL - npresent, empty);
+    }
+
+#undef NUMEL
+}
+
+
+#define THREADS 4
+
+typedef struct concurrent_test_ctx
+{
+    saeclib_concurrent_hash_table_t* cht;
+    int thread;
+    int errors;
+    int inserted;
+} concurrent_test_ctx_t;
+
+// Every thread inserts all of these keys; each must be inserted exactly once.
+#define SHARED_KEYS 1000
+
+static void* same_keys_worker(void* arg)
+{
+    concurrent_test_ctx_t* ctx = arg;
+    for (uint32_t i = 0; i < SHARED_KEYS; i++) {
+        // walk the keys in a different order in each thread so that they collide mid-insert.
+        uint32_t key = (ctx->thread & 1) ? i : (SHARED_KEYS - 1 - i);
+        saeclib_error_e err = saeclib_concurrent_hash_insert(ctx->cht, &key,
+                                                             (uint32_t[]){ key + 1 });
+        if (err == SAECLIB_ERROR_NOERROR)
+            ctx->inserted++;
+        else if (err != SAECLIB_ERROR_DUPLICATE_KEY)
+            ctx->errors++;
+    }
+    return NULL;
+}
+
+/**
+ * Threads inserting the same keys at the same time: exactly one insert of each key succeeds.
+ */
+void saeclib_concurrent_hash_same_keys_test()
+{
+#define NUMEL 2048
+    saeclib_concurrent_hash_table_t cht =
+        saeclib_concurrent_hash_table_salloc(NUMEL, sizeof(uint32_t), sizeof(uint32_t),
+                                             saeclib_hash_table_u32_hash,
+                                             saeclib_hash_table_u32_cmp);
+
+    pthread_t threads[THREADS];
+    concurrent_test_ctx_t ctx[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        ctx[i] = (concurrent_test_ctx_t){ &cht, i, 0, 0 };
+        pthread_create(&threads[i], NULL, same_keys_worker, &ctx[i]);
+    }
+
+    int inserted = 0;
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        TEST_ASSERT_EQUAL_INT(0, ctx[i].errors);
+        inserted += ctx[i].inserted;
+    }
+    TEST_ASSERT_EQUAL_INT(SHARED_KEYS, inserted);
+
+    // and every key is in the table exactly once: deleting it once works, twice doesn't.
+    for (uint32_t key = 0; key < SHARED_KEYS; key++) {
+        uint32_t value;
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_concurrent_hash_search(&cht, &key,
+                                                                                    &value));
+        TEST_ASSERT_EQUAL_INT(key + 1, value);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_concurrent_hash_delete(&cht, &key));
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, saeclib_concurrent_hash_delete(&cht, &key));
+    }
+
+#undef NUMEL
+}
+#undef SHARED_KEYS
+
+
+// Each thread owns keys thread, thread + THREADS, ... below OWNED_KEYS * THREADS.
+#define OWNED_KEYS 200
+
+typedef struct churn_test_value
+{
+    uint32_t a, b, c, d;
+} churn_test_value_t;
+
+static void* churn_worker(void* arg)
+{
+    concurrent_test_ctx_t* ctx = arg;
+    bool present[OWNED_KEYS] = { false };
+    unsigned int seed = ctx->thread;
+
+    for (int i = 0; i < 100000; i++) {
+        uint32_t n = rand_r(&seed) % OWNED_KEYS;
+        uint32_t key = (n * THREADS) + ctx->thread;
+        uint32_t x = (key * 3) + 1;
+        churn_test_value_t v;
+        saeclib_error_e err;
+
+        switch (rand_r(&seed) % 3) {
+            case 0:
+                err = saeclib_concurrent_hash_insert(ctx->cht, &key,
+                                                     &(churn_test_value_t){ x, x, x, x });
+                if (err != (present[n] ? SAECLIB_ERROR_DUPLICATE_KEY : SAECLIB_ERROR_NOERROR))
+                    ctx->errors++;
+                present[n] = true;
+                break;
+
+            case 1:
+                err = saeclib_concurrent_hash_delete(ctx->cht, &key);
+                if (err != (present[n] ? SAECLIB_ERROR_NOERROR : SAECLIB_ERROR_UNDERFLOW))
+                    ctx->errors++;
+                present[n] = false;
+                break;
+
+            case 2:
+                // search any thread's key; only our own can be checked for presence, but every
+                // value found must be whole.
+                key = rand_r(&seed) % (OWNED_KEYS * THREADS);
+                x = (key * 3) + 1;
+                err = saeclib_concurrent_hash_search(ctx->cht, &key, &v);
+                if (err == SAECLIB_ERROR_NOERROR) {
+                    if ((v.a != x) || (v.b != x) || (v.c != x) || (v.d != x))
+                        ctx->errors++;
+                }
+                if (((key % THREADS) == ctx->thread) &&
+                    ((err == SAECLIB_ERROR_NOERROR) != present[key / THREADS]))
+                    ctx->errors++;
+                break;
+        }
+    }
+
+    for (uint32_t n = 0; n < OWNED_KEYS; n++) {
+        ctx->inserted += present[n];
+    }
+    return NULL;
+}
+
+/**
+ * Threads inserting, deleting and searching at the same time, each inserting and deleting its own
+ * keys: every thread always sees its own keys as it left them and never sees a half-written value
+ * of anyone else's.
+ */
+void saeclib_concurrent_hash_churn_test()
+{
+#define NUMEL 1024
+    saeclib_concurrent_hash_table_t cht =
+        saeclib_concurrent_hash_table_salloc(NUMEL, sizeof(uint32_t), sizeof(churn_test_value_t),
+                                             saeclib_hash_table_u32_hash,
+                                             saeclib_hash_table_u32_cmp);
+
+    pthread_t threads[THREADS];
+    concurrent_test_ctx_t ctx[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        ctx[i] = (concurrent_test_ctx_t){ &cht, i, 0, 0 };
+        pthread_create(&threads[i], NULL, churn_worker, &ctx[i]);
+    }
+
+    int inserted = 0;
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        TEST_ASSERT_EQUAL_INT(0, ctx[i].errors);
+        inserted += ctx[i].inserted;
+    }
+
+    int found = 0;
+    for (uint32_t key = 0; key < (OWNED_KEYS * THREADS); key++) {
+        churn_test_value_t v;
+        found += (saeclib_concurrent_hash_search(&cht, &key, &v) == SAECLIB_ERROR_NOERROR);
+    }
+    TEST_ASSERT_EQUAL_INT(inserted, found);
+
+#undef NUMEL
+}
+#undef OWNED_KEYS
+
+
+// Every key hashes to the same bucket, so all of them share one chain.
+static unsigned int one_chain_hash(const void* a)
+{
+    return 0;
+}
+
+// Gives the other threads a go, a random number of times, at every key compare, so that inserts
+// racing along the chain overlap in lots of different ways even on a single core.
+static int yielding_u32_cmp(const void* a, const void* b)
+{
+    static __thread unsigned int seed;
+    if (seed == 0)
+        seed = (unsigned int)(uintptr_t)&seed;
+    for (unsigned int n = rand_r(&seed) % 8; n > 0; n--) {
+        sched_yield();
+    }
+    return saeclib_hash_table_u32_cmp(a, b);
+}
+
+#define ROUNDS 2000
+
+static pthread_barrier_t chain_barrier;
+
+typedef struct chain_test_ctx
+{
+    saeclib_concurrent_hash_table_t* cht;
+    int thread;
+    int duplicates;
+} chain_test_ctx_t;
+
+static void* one_chain_worker(void* arg)
+{
+    chain_test_ctx_t* ctx = arg;
+    const uint32_t zero = 0;
+
+    for (int round = 0; round < ROUNDS; round++) {
+        // the chain starts out as keys 1 and 2. Threads 1 and 3 each delete one of them, leaving
+        // tombstones among the buckets that the others are claiming, and every thread races to
+        // insert key 0.
+        if (ctx->thread == 0) {
+            for (uint32_t key = 1; key <= 2; key++) {
+                saeclib_concurrent_hash_insert(ctx->cht, &key, &key);
+            }
+        }
+        pthread_barrier_wait(&chain_barrier);
+
+        if (ctx->thread & 1) {
+            const uint32_t key = 1 + ((ctx->thread >> 1) & 1);
+            saeclib_concurrent_hash_delete(ctx->cht, &key);
+        }
+        saeclib_concurrent_hash_insert(ctx->cht, &zero, &zero);
+        pthread_barrier_wait(&chain_barrier);
+
+        // with everyone stopped, key 0 is there exactly once: deleting it works once and only once.
+        // Every other round, purge the tombstones so that the next round starts from EMPTY buckets.
+        if (ctx->thread == 0) {
+            if ((saeclib_concurrent_hash_delete(ctx->cht, &zero) != SAECLIB_ERROR_NOERROR) ||
+                (saeclib_concurrent_hash_delete(ctx->cht, &zero) == SAECLIB_ERROR_NOERROR))
+                ctx->duplicates++;
+            for (uint32_t key = 1; key <= 2; key++) {
+                saeclib_concurrent_hash_delete(ctx->cht, &key);
+            }
+            if (round % 2)
+                saeclib_concurrent_hash_purge(ctx->cht);
+        }
+        pthread_barrier_wait(&chain_barrier);
+    }
+    return NULL;
+}
+
+/**
+ * Threads inserting the same key into one chain while other keys are deleted from in front of it,
+ * over and over: however the inserts race with each other and with the tombstones, the key never
+ * ends up in the table twice.
+ */
+void saeclib_concurrent_hash_one_chain_test()
+{
+#define NUMEL 16
+    saeclib_concurrent_hash_table_t cht =
+        saeclib_concurrent_hash_table_salloc(NUMEL, sizeof(uint32_t), sizeof(uint32_t),
+                                             one_chain_hash, yielding_u32_cmp);
+
+    pthread_barrier_init(&chain_barrier, NULL, THREADS);
+    pthread_t threads[THREADS];
+    chain_test_ctx_t ctx[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        ctx[i] = (chain_test_ctx_t){ &cht, i, 0 };
+        pthread_create(&threads[i], NULL, one_chain_worker, &ctx[i]);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_barrier_destroy(&chain_barrier);
+
+    TEST_ASSERT_EQUAL_INT(0, ctx[0].duplicates);
+
+#undef NUMEL
+}
+#undef ROUNDS
+#undef THREADS
+
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(saeclib_concurrent_hash_table_init_test);
+    RUN_TEST(saeclib_concurrent_hash_fuzz_test);
+    RUN_TEST(saeclib_concurrent_hash_purge_test);
+    RUN_TEST(saeclib_concurrent_hash_same_keys_test);
+    RUN_TEST(saeclib_concurrent_hash_churn_test);
+    RUN_TEST(saeclib_concurrent_hash_one_chain_test);
+    return UNITY_END();
+}
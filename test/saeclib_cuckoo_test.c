@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "unity.h"
+
+#include "saeclib_cuckoo.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void saeclib_cuckoo_table_init_test()
+{
+    // 4 tags, 4 keys from offset 4, 4 values from offset 20: 36 bytes, padded to 40.
+    TEST_ASSERT_EQUAL_INT(40, SAECLIB_CUCKOO_BUCKET_SIZE(sizeof(uint32_t), sizeof(uint32_t)));
+    // 8-byte keys start at offset 8.
+    TEST_ASSERT_EQUAL_INT(8, SAECLIB_CUCKOO_KEY_OFFSET(sizeof(uint64_t)));
+    TEST_ASSERT_EQUAL_INT(72, SAECLIB_CUCKOO_BUCKET_SIZE(sizeof(uint64_t), sizeof(uint64_t)));
+
+    saeclib_cuckoo_table_t cht;
+    static uint8_t space[17 * 40];
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                          saeclib_cuckoo_table_init(&cht, space, sizeof(space), sizeof(uint32_t),
+                                                    sizeof(uint32_t), saeclib_hash_table_u32_hash,
+                                                    saeclib_hash_table_u32_cmp));
+    TEST_ASSERT_EQUAL_INT(16, cht.nbuckets);
+
+    // no room for the stash
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_cuckoo_table_init(&cht, space, 16 * 40, sizeof(uint32_t),
+                                                    sizeof(uint32_t), saeclib_hash_table_u32_hash,
+                                                    saeclib_hash_table_u32_cmp));
+
+    cht = saeclib_cuckoo_table_salloc(100, sizeof(uint32_t), sizeof(uint32_t),
+                                      saeclib_hash_table_u32_hash, saeclib_hash_table_u32_cmp);
+    TEST_ASSERT_EQUAL_INT(32, cht.nbuckets);
+    TEST_ASSERT_EQUAL_INT(0, saeclib_cuckoo_size(&cht));
+}
+
+/**
+ * Random inserts, searches and deletes in a small table agree with a plain array, including when
+ * the table is full enough that keys get moved around and stashed, and inserts fail.
+ */
+void saeclib_cuckoo_fuzz_test()
+{
+#define NUMEL 64
+    saeclib_cuckoo_table_t cht = saeclib_cuckoo_table_salloc(NUMEL, sizeof(uint32_t),
+                                                             sizeof(uint32_t),
+                                                             saeclib_hash_table_u32_hash,
+                                                             saeclib_hash_table_u32_cmp);
+
+    static bool present[4 * NUMEL];
+    size_t size = 0;
+    int overflows = 0;
+    srand(0);
+    for (int i = 0; i < 200000; i++) {
+        uint32_t key = rand() % (4 * NUMEL);
+        uint32_t value;
+        saeclib_error_e err;
+        switch (rand() % 3) {
+            case 0:
+                err = saeclib_cuckoo_insert(&cht, &key, (uint32_t[]){ key * 5 });
+                if (present[key]) {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_DUPLICATE_KEY, err);
+                } else if (err == SAECLIB_ERROR_OVERFLOW) {
+                    // only once the table's nearly full
+                    TEST_ASSERT_TRUE(size >= (NUMEL * 3 / 4));
+                    overflows++;
+                } else {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                    present[key] = true;
+                    size++;
+                }
+                break;
+
+            case 1:
+                err = saeclib_cuckoo_search(&cht, &key, &value);
+                if (present[key]) {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                    TEST_ASSERT_EQUAL_INT(key * 5, value);
+                } else {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+                }
+                break;
+
+            case 2:
+                err = saeclib_cuckoo_delete(&cht, &key);
+                if (present[key]) {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                    present[key] = false;
+                    size--;
+                } else {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+                }
+                break;
+        }
+        TEST_ASSERT_EQUAL_INT(size, saeclib_cuckoo_size(&cht));
+    }
+    TEST_ASSERT_TRUE(overflows > 0);
+
+#undef NUMEL
+}
+
+/**
+ * Random keys fill the table to over 90% before the first insert fails, and a failed insert
+ * leaves every key where it can be found.
+ */
+void saeclib_cuckoo_load_factor_test()
+{
+#define NUMEL 4096
+    saeclib_cuckoo_table_t cht = saeclib_cuckoo_table_salloc(NUMEL, sizeof(uint32_t), 0,
+                                                             saeclib_hash_table_u32_hash,
+                                                             saeclib_hash_table_u32_cmp);
+
+    static uint32_t keys[NUMEL];
+    uint32_t n = 0;
+    uint32_t state = 12345;
+    while (n < NUMEL) {
+        state = (state * 1103515245u) + 12345u;
+        saeclib_error_e err = saeclib_cuckoo_insert(&cht, &state, NULL);
+        if (err == SAECLIB_ERROR_OVERFLOW)
+            break;
+        if (err == SAECLIB_ERROR_NOERROR)
+            keys[n++] = state;
+    }
+    TEST_ASSERT_TRUE(n > (NUMEL * 9 / 10));
+    TEST_ASSERT_EQUAL_INT(n, saeclib_cuckoo_size(&cht));
+
+    for (uint32_t i = 0; i < n; i++) {
+        void* ref;
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_cuckoo_search_ref(&cht, &keys[i], &ref));
+    }
+
+    // deleting makes room, and the stash empties out as it does.
+    for (uint32_t i = 0; i < n; i += 2) {
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_cuckoo_delete(&cht, &keys[i]));
+    }
+    TEST_ASSERT_EQUAL_INT(0, cht.stash_count);
+    for (uint32_t i = 1; i < n; i += 2) {
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_cuckoo_search(&cht, &keys[i], NULL));
+    }
+
+#undef NUMEL
+}
+
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(saeclib_cuckoo_table_init_test);
+    RUN_TEST(saeclib_cuckoo_fuzz_test);
+    RUN_TEST(saeclib_cuckoo_load_factor_test);
+    return UNITY_END();
+}
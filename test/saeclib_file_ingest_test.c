@@ -0,0 +1,144 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "unity.h"
+
+#include "saeclib_file_ingest.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/**
+ * Makes a temporary file with a known pattern in it and returns its descriptor.
+ */
+static int make_pattern_file(size_t len)
+{
+    char path[] = "/tmp/saeclib_file_ingest_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    unlink(path);
+
+    static uint8_t chunk[4096];
+    for (size_t written = 0; written < len; ) {
+        size_t n = ((len - written) > sizeof(chunk)) ? sizeof(chunk) : (len - written);
+        for (size_t i = 0; i < n; i++) chunk[i] = ((written + i) * 7) ^ ((written + i) >> 9);
+        TEST_ASSERT_EQUAL_INT(n, write(fd, chunk, n));
+        written += n;
+    }
+
+    return fd;
+}
+
+/**
+ * Streams a file through a small circular buffer, popping odd-sized pieces from the other end, and
+ * checks that every byte comes out in order. Returns true if the reads went through io_uring.
+ */
+static bool ingest_whole_file(uint32_t flags, size_t file_len)
+{
+#define NUMEL 65537
+
+    int fd = make_pattern_file(file_len);
+    saeclib_u8_circular_buffer_t scb = saeclib_u8_circular_buffer_salloc(NUMEL);
+
+    saeclib_file_ingest_t ing;
+    saeclib_error_e err = saeclib_file_ingest_init(&ing, &scb, fd, 4096, 8, flags);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    const bool used_io_uring = saeclib_file_ingest_using_io_uring(&ing);
+
+    size_t consumed = 0;
+    srand(0);
+    while (!saeclib_file_ingest_done(&ing) || !saeclib_u8_circular_buffer_empty(&scb)) {
+        err = saeclib_file_ingest_poll(&ing, true, NULL);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+
+        static uint8_t out[NUMEL];
+        size_t n = saeclib_u8_circular_buffer_size(&scb);
+        if (n > 10000) n = 1 + (rand() % n);
+        saeclib_u8_circular_buffer_popmany(&scb, out, n);
+        for (size_t i = 0; i < n; i++) {
+            size_t pos = consumed + i;
+            TEST_ASSERT_EQUAL_UINT8((uint8_t)((pos * 7) ^ (pos >> 9)), out[i]);
+        }
+        consumed += n;
+    }
+
+    TEST_ASSERT_EQUAL_INT(file_len, consumed);
+    saeclib_file_ingest_close(&ing);
+    close(fd);
+    return used_io_uring;
+
+#undef NUMEL
+}
+
+void saeclib_file_ingest_io_uring_test()
+{
+    if (!ingest_whole_file(0, 3 * 1024 * 1024 + 123)) {
+        TEST_IGNORE_MESSAGE("io_uring isn't available here; the file was read with pread()");
+    }
+}
+
+void saeclib_file_ingest_pread_test()
+{
+    TEST_ASSERT_FALSE(ingest_whole_file(SAECLIB_FILE_INGEST_NO_IO_URING, 3 * 1024 * 1024 + 123));
+}
+
+/**
+ * An empty file is done right away.
+ */
+void saeclib_file_ingest_empty_file_test()
+{
+    int fd = make_pattern_file(0);
+    saeclib_u8_circular_buffer_t scb = saeclib_u8_circular_buffer_salloc(128);
+
+    saeclib_file_ingest_t ing;
+    saeclib_file_ingest_init(&ing, &scb, fd, 32, 4, 0);
+    while (!saeclib_file_ingest_done(&ing)) {
+        size_t committed;
+        saeclib_error_e err = saeclib_file_ingest_poll(&ing, true, &committed);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+        TEST_ASSERT_EQUAL_INT(0, committed);
+    }
+    TEST_ASSERT_TRUE(saeclib_u8_circular_buffer_empty(&scb));
+
+    saeclib_file_ingest_close(&ing);
+    close(fd);
+}
+
+/**
+ * Reads that fail are reported, for instance reading from a pipe, which can't be pread().
+ */
+void saeclib_file_ingest_error_test()
+{
+    int fds[2];
+    TEST_ASSERT_EQUAL_INT(0, pipe(fds));
+    saeclib_u8_circular_buffer_t scb = saeclib_u8_circular_buffer_salloc(128);
+
+    saeclib_file_ingest_t ing;
+    saeclib_file_ingest_init(&ing, &scb, fds[0], 32, 4, SAECLIB_FILE_INGEST_NO_IO_URING);
+    saeclib_error_e err = saeclib_file_ingest_poll(&ing, true, NULL);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_IO, err);
+    TEST_ASSERT_TRUE(saeclib_file_ingest_done(&ing));
+
+    saeclib_file_ingest_close(&ing);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(saeclib_file_ingest_io_uring_test);
+    RUN_TEST(saeclib_file_ingest_pread_test);
+    RUN_TEST(saeclib_file_ingest_empty_file_test);
+    RUN_TEST(saeclib_file_ingest_error_test);
+    return UNITY_END();
+}
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "saeclib_filter.h"
+#include "saeclib_hash.h"
+#include "saeclib_hash_functions.h"
+
+/**
+ * Fills a Bloom filter at a few sizes per key, a cuckoo filter, and a power-of-two
+ * saeclib_hash_table_t with the same million keys, then times lookups of a million keys that
+ * aren't in any of them: one at a time, and in batches for the filters. Also reports each
+ * filter's false positive rate.
+ */
+
+#define NKEYS (1 << 20)
+
+static uint32_t keys[NKEYS];
+static uint32_t missing[NKEYS];
+static uint64_t found_mask[NKEYS / 64];
+
+static uint32_t table_keys[2 * NKEYS];
+static uint32_t table_values[2 * NKEYS];
+static uint8_t table_status[2 * NKEYS];
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec * 1e-9);
+}
+
+static void bench_bloom(saeclib_bloom_filter_t* bf, int bits_per_key)
+{
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        saeclib_bloom_filter_add(bf, &keys[i]);
+    }
+
+    size_t found = 0;
+    double t0 = now();
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        found += saeclib_bloom_filter_contains(bf, &missing[i]);
+    }
+    double t1 = now();
+    saeclib_bloom_filter_contains_batch(bf, missing, NKEYS, found_mask);
+    double t2 = now();
+
+    printf("bloom, %2d bits/key  %6.1f ns/query  %6.1f ns/query batched  %7.4f%% false positives\n",
+           bits_per_key, (t1 - t0) * 1e9 / NKEYS, (t2 - t1) * 1e9 / NKEYS, 100.0 * found / NKEYS);
+}
+
+int main(int argc, char** argv)
+{
+    // keys are even and the ones looked up are odd, so none of them are found.
+    srand(0);
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        keys[i] = i * 2654435762u;
+        missing[i] = (rand() * 2u) | 1;
+    }
+
+    printf("saeclib_filter_bench: %d keys\n", NKEYS);
+
+    saeclib_bloom_filter_t bf8 = saeclib_bloom_filter_salloc(NKEYS, 8, sizeof(uint32_t),
+                                                             saeclib_hash_u32);
+    bench_bloom(&bf8, 8);
+    saeclib_bloom_filter_t bf16 = saeclib_bloom_filter_salloc(NKEYS, 16, sizeof(uint32_t),
+                                                              saeclib_hash_u32);
+    bench_bloom(&bf16, 16);
+    saeclib_bloom_filter_t bf32 = saeclib_bloom_filter_salloc(NKEYS, 32, sizeof(uint32_t),
+                                                              saeclib_hash_u32);
+    bench_bloom(&bf32, 32);
+
+    saeclib_cuckoo_filter_t cf = saeclib_cuckoo_filter_salloc(NKEYS, sizeof(uint32_t),
+                                                              saeclib_hash_u32);
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        saeclib_cuckoo_filter_insert(&cf, &keys[i]);
+    }
+    size_t found = 0;
+    double t0 = now();
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        found += saeclib_cuckoo_filter_contains(&cf, &missing[i]);
+    }
+    double t1 = now();
+    saeclib_cuckoo_filter_contains_batch(&cf, missing, NKEYS, found_mask);
+    double t2 = now();
+    printf("cuckoo filter       %6.1f ns/query  %6.1f ns/query batched  %7.4f%% false positives"
+           " (%.0f%% full)\n",
+           (t1 - t0) * 1e9 / NKEYS, (t2 - t1) * 1e9 / NKEYS, 100.0 * found / NKEYS,
+           100.0 * NKEYS / (cf.nbuckets * SAECLIB_CUCKOO_FILTER_SLOTS));
+
+    saeclib_hash_table_t sht;
+    saeclib_hash_table_init_pow2(&sht, table_keys, table_values, table_status,
+                                 sizeof(table_keys), sizeof(uint32_t), sizeof(uint32_t),
+                                 saeclib_hash_u32, saeclib_hash_table_u32_cmp);
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        saeclib_hash_insert(&sht, &keys[i], &i);
+    }
+    t0 = now();
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        uint32_t value;
+        found += (saeclib_hash_search(&sht, &missing[i], &value) == SAECLIB_ERROR_NOERROR);
+    }
+    t1 = now();
+    printf("hash table          %6.1f ns/query (checksum %zu)\n", (t1 - t0) * 1e9 / NKEYS, found);
+
+    return 0;
+}
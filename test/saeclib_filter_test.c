@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "unity.h"
+
+#include "saeclib_filter.h"
+#include "saeclib_hash_functions.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void saeclib_bloom_filter_init_test()
+{
+    saeclib_bloom_filter_t bf;
+    static uint32_t blockspace[3 * SAECLIB_BLOOM_FILTER_BLOCK_WORDS];
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_bloom_filter_init(&bf, blockspace, sizeof(blockspace),
+                                                    sizeof(uint32_t), saeclib_hash_table_u32_hash));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_bloom_filter_init(&bf, blockspace, 31, sizeof(uint32_t),
+                                                    saeclib_hash_table_u32_hash));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                          saeclib_bloom_filter_init(&bf, blockspace, 64, sizeof(uint32_t),
+                                                    saeclib_hash_table_u32_hash));
+    TEST_ASSERT_EQUAL_INT(2, bf.nblocks);
+
+    // 10000 keys at 12 bits each is 469 blocks, rounded up to 512.
+    bf = saeclib_bloom_filter_salloc(10000, 12, sizeof(uint32_t), saeclib_hash_table_u32_hash);
+    TEST_ASSERT_EQUAL_INT(512, bf.nblocks);
+    uint32_t key = 5;
+    TEST_ASSERT_FALSE(saeclib_bloom_filter_contains(&bf, &key));
+}
+
+/**
+ * Every key that was added is found, few that weren't are, and the batch test and the scalar
+ * and AVX2 block tests all agree.
+ */
+void saeclib_bloom_filter_test()
+{
+#define NUMEL 10000
+    saeclib_bloom_filter_t bf = saeclib_bloom_filter_salloc(NUMEL, 12, sizeof(uint32_t),
+                                                            saeclib_hash_table_u32_hash);
+    for (uint32_t i = 0; i < NUMEL; i++) {
+        uint32_t key = i * 2;
+        saeclib_bloom_filter_add(&bf, &key);
+    }
+
+    // keys 0 to 4 * NUMEL: the even half were added.
+    static uint32_t keys[4 * NUMEL];
+    static uint64_t found_mask[(4 * NUMEL + 63) / 64];
+    for (uint32_t i = 0; i < (4 * NUMEL); i++) {
+        keys[i] = i;
+    }
+    size_t found = saeclib_bloom_filter_contains_batch(&bf, keys, 4 * NUMEL, found_mask);
+
+    size_t false_positives = 0;
+    for (uint32_t i = 0; i < (4 * NUMEL); i++) {
+        bool contains = saeclib_bloom_filter_contains(&bf, &keys[i]);
+        TEST_ASSERT_EQUAL_INT(contains, (found_mask[i / 64] >> (i % 64)) & 1);
+        if ((i % 2 == 0) && (i < (2 * NUMEL))) {
+            TEST_ASSERT_TRUE(contains);
+        } else if (contains) {
+            false_positives++;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(NUMEL + false_positives, found);
+
+    // 13 bits per key: about 0.4%.
+    TEST_ASSERT_TRUE(false_positives < (3 * NUMEL / 100));
+
+    // whichever block test init picked, the other gives the same answers.
+    bf.avx2 = !bf.avx2;
+    if (!bf.avx2 || __builtin_cpu_supports("avx2")) {
+        static uint64_t other_mask[(4 * NUMEL + 63) / 64];
+        TEST_ASSERT_EQUAL_INT(found, saeclib_bloom_filter_contains_batch(&bf, keys, 4 * NUMEL,
+                                                                         other_mask));
+        TEST_ASSERT_EQUAL_MEMORY(found_mask, other_mask, sizeof(found_mask));
+    }
+    bf.avx2 = !bf.avx2;
+
+    saeclib_bloom_filter_clear(&bf);
+    TEST_ASSERT_EQUAL_INT(0, saeclib_bloom_filter_contains_batch(&bf, keys, 4 * NUMEL, found_mask));
+
+#undef NUMEL
+}
+
+void saeclib_cuckoo_filter_init_test()
+{
+    saeclib_cuckoo_filter_t cf;
+    static uint16_t bucketspace[6 * SAECLIB_CUCKOO_FILTER_SLOTS];
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_cuckoo_filter_init(&cf, bucketspace, sizeof(bucketspace),
+                                                     sizeof(uint32_t), saeclib_hash_table_u32_hash));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_cuckoo_filter_init(&cf, bucketspace, 8, sizeof(uint32_t),
+                                                     saeclib_hash_table_u32_hash));
+
+    // 1000 keys need 1052 slots, or 263 buckets, rounded up to 512.
+    cf = saeclib_cuckoo_filter_salloc(1000, sizeof(uint32_t), saeclib_hash_table_u32_hash);
+    TEST_ASSERT_EQUAL_INT(512, cf.nbuckets);
+    TEST_ASSERT_EQUAL_INT(0, saeclib_cuckoo_filter_size(&cf));
+}
+
+/**
+ * Random inserts and deletes of distinct keys never lose a key that's in the filter, and keys that
+ * aren't are hardly ever found.
+ */
+void saeclib_cuckoo_filter_fuzz_test()
+{
+#define NUMEL 4096
+#define KEY_RANGE (4 * NUMEL)
+    saeclib_cuckoo_filter_t cf = saeclib_cuckoo_filter_salloc(NUMEL, sizeof(uint32_t),
+                                                              saeclib_hash_table_u32_hash);
+    static bool present[KEY_RANGE];
+    size_t size = 0;
+    size_t false_positives = 0, negatives = 0;
+
+    srand(0);
+    for (int i = 0; i < 200000; i++) {
+        uint32_t key = rand() % KEY_RANGE;
+        switch (rand() % 3) {
+            case 0:
+                if (!present[key] && (size < NUMEL)) {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                                          saeclib_cuckoo_filter_insert(&cf, &key));
+                    present[key] = true;
+                    size++;
+                }
+                break;
+
+            case 1:
+                if (present[key]) {
+                    TEST_ASSERT_TRUE(saeclib_cuckoo_filter_contains(&cf, &key));
+                } else {
+                    negatives++;
+                    false_positives += saeclib_cuckoo_filter_contains(&cf, &key);
+                }
+                break;
+
+            case 2:
+                if (present[key]) {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                                          saeclib_cuckoo_filter_delete(&cf, &key));
+                    present[key] = false;
+                    size--;
+                }
+                break;
+        }
+        TEST_ASSERT_EQUAL_INT(size, saeclib_cuckoo_filter_size(&cf));
+    }
+
+    // about 0.01%
+    TEST_ASSERT_TRUE(false_positives < (negatives / 1000));
+
+    // and the batch test agrees.
+    static uint32_t keys[KEY_RANGE];
+    static uint64_t found_mask[KEY_RANGE / 64];
+    for (uint32_t i = 0; i < KEY_RANGE; i++) {
+        keys[i] = i;
+    }
+    size_t found = saeclib_cuckoo_filter_contains_batch(&cf, keys, KEY_RANGE, found_mask);
+    TEST_ASSERT_TRUE(found >= size);
+    for (uint32_t i = 0; i < KEY_RANGE; i++) {
+        TEST_ASSERT_EQUAL_INT(saeclib_cuckoo_filter_contains(&cf, &keys[i]),
+                              (found_mask[i / 64] >> (i % 64)) & 1);
+    }
+
+#undef KEY_RANGE
+#undef NUMEL
+}
+
+/**
+ * The filter fills to over 90% before an insert is turned away, and deleting a key makes room
+ * again, without losing any keys along the way.
+ */
+void saeclib_cuckoo_filter_load_factor_test()
+{
+#define NBUCKETS 1024
+    saeclib_cuckoo_filter_t cf;
+    static uint16_t bucketspace[NBUCKETS * SAECLIB_CUCKOO_FILTER_SLOTS];
+    saeclib_cuckoo_filter_init(&cf, bucketspace, sizeof(bucketspace), sizeof(uint32_t),
+                               saeclib_hash_u32);
+
+    static uint32_t keys[NBUCKETS * SAECLIB_CUCKOO_FILTER_SLOTS];
+    uint32_t n = 0;
+    for (uint32_t key = 1; ; key++) {
+        if (saeclib_cuckoo_filter_insert(&cf, &key) == SAECLIB_ERROR_OVERFLOW)
+            break;
+        keys[n++] = key;
+    }
+    TEST_ASSERT_TRUE(n > (NBUCKETS * SAECLIB_CUCKOO_FILTER_SLOTS * 9 / 10));
+    TEST_ASSERT_TRUE(cf.has_victim);
+    TEST_ASSERT_EQUAL_INT(n, saeclib_cuckoo_filter_size(&cf));
+    for (uint32_t i = 0; i < n; i++) {
+        TEST_ASSERT_TRUE(saeclib_cuckoo_filter_contains(&cf, &keys[i]));
+    }
+
+    // delete keys until there's room for the one that was kept aside.
+    uint32_t deleted = 0;
+    while (cf.has_victim) {
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_cuckoo_filter_delete(&cf, &keys[deleted]));
+        deleted++;
+    }
+    for (uint32_t i = deleted; i < n; i++) {
+        TEST_ASSERT_TRUE(saeclib_cuckoo_filter_contains(&cf, &keys[i]));
+    }
+    uint32_t key = 0;
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_cuckoo_filter_insert(&cf, &key));
+
+#undef NBUCKETS
+}
+
+/**
+ * The same key inserted twice needs deleting twice.
+ */
+void saeclib_cuckoo_filter_duplicate_test()
+{
+    saeclib_cuckoo_filter_t cf = saeclib_cuckoo_filter_salloc(100, sizeof(uint32_t),
+                                                              saeclib_hash_table_u32_hash);
+    uint32_t key = 1234;
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, saeclib_cuckoo_filter_delete(&cf, &key));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_cuckoo_filter_insert(&cf, &key));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_cuckoo_filter_insert(&cf, &key));
+    TEST_ASSERT_EQUAL_INT(2, saeclib_cuckoo_filter_size(&cf));
+
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_cuckoo_filter_delete(&cf, &key));
+    TEST_ASSERT_TRUE(saeclib_cuckoo_filter_contains(&cf, &key));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_cuckoo_filter_delete(&cf, &key));
+    TEST_ASSERT_FALSE(saeclib_cuckoo_filter_contains(&cf, &key));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, saeclib_cuckoo_filter_delete(&cf, &key));
+}
+
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(saeclib_bloom_filter_init_test);
+    RUN_TEST(saeclib_bloom_filter_test);
+    RUN_TEST(saeclib_cuckoo_filter_init_test);
+    RUN_TEST(saeclib_cuckoo_filter_fuzz_test);
+    RUN_TEST(saeclib_cuckoo_filter_load_factor_test);
+    RUN_TEST(saeclib_cuckoo_filter_duplicate_test);
+    return UNITY_END();
+}
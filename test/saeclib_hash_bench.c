@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "saeclib_hash.h"
+
+/**
+ * Compares the plain modulo hash table against a power-of-two table with hash mixing, using the
+ * identity hash for u32 keys, and the power-of-two table against one that calls its compare
+ * function instead of comparing keys inline. Each run fills a table to about 85%, then looks up
+ * every key that's in it and the same number of keys that aren't. Then compares single and batched
+ * lookups in a table that doesn't fit in the cache.
+ */
+
+#define LOG2_CAPACITY 16
+#define CAPACITY      (1 << LOG2_CAPACITY)
+#define NKEYS         (CAPACITY * 85 / 100)
+
+static uint32_t keys[NKEYS];
+static uint32_t missing[NKEYS];
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec * 1e-9);
+}
+
+static uint32_t xorshift(uint32_t* state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/**
+ * Fills keys[] and missing[] with one of the key distributions; missing[] never overlaps keys[].
+ */
+static void make_keys(const char* dist)
+{
+    uint32_t state = 12345;
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        switch (dist[0]) {
+            case 's':
+                if (dist[1] == 'e') {
+                    // sequential IDs
+                    keys[i] = i;
+                    missing[i] = i + NKEYS;
+                } else {
+                    // strided, like the addresses of 64 byte records
+                    keys[i] = i * 64;
+                    missing[i] = (i * 64) + 32;
+                }
+                break;
+            default:
+                // random; the top bit tells present and missing keys apart. The odd repeated key
+                // just fails to insert.
+                keys[i] = xorshift(&state) & 0x7fffffff;
+                missing[i] = xorshift(&state) | 0x80000000;
+                break;
+        }
+    }
+}
+
+/**
+ * saeclib_hash_table_u32_cmp, but not as far as the table can tell, so it has to call it.
+ */
+static int callback_u32_cmp(const void* a, const void* b)
+{
+    return saeclib_hash_table_u32_cmp(a, b);
+}
+
+static void run(const char* name, const char* dist, saeclib_hash_table_t* sht)
+{
+    make_keys(dist);
+
+    double t0 = now();
+    uint32_t failed = 0;
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        failed += (saeclib_hash_insert(sht, &keys[i], &i) == SAECLIB_ERROR_OVERFLOW);
+    }
+    double t1 = now();
+
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        uint32_t v;
+        found += (saeclib_hash_search(sht, &keys[i], &v) == SAECLIB_ERROR_NOERROR);
+    }
+    double t2 = now();
+
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        uint32_t v;
+        found += (saeclib_hash_search(sht, &missing[i], &v) == SAECLIB_ERROR_NOERROR);
+    }
+    double t3 = now();
+
+    printf("%-8s %-10s insert %7.1f ns    hit %7.1f ns    miss %7.1f ns    (%u found, %u failed)\n",
+           name, dist, (t1 - t0) * 1e9 / NKEYS, (t2 - t1) * 1e9 / NKEYS, (t3 - t2) * 1e9 / NKEYS,
+           found, failed);
+}
+
+/**
+ * Looks up random keys in a table much bigger than the cache, one at a time and in batches of 32,
+ * like a packet classifier handling a burst.
+ */
+#define BIG_CAPACITY (1 << 25)
+#define BIG_NKEYS    (BIG_CAPACITY / 100 * 85)
+#define BURST        32
+#define NBURSTS      (1 << 17)
+
+static void run_batch(void)
+{
+    static uint32_t keyspace[BIG_CAPACITY];
+    static uint32_t valuespace[BIG_CAPACITY];
+    static uint8_t status[BIG_CAPACITY];
+    saeclib_hash_table_t sht;
+    saeclib_hash_table_init_pow2(&sht, keyspace, valuespace, status, sizeof(keyspace),
+                                 sizeof(uint32_t), sizeof(uint32_t), saeclib_hash_table_u32_hash,
+                                 saeclib_hash_table_u32_cmp);
+
+    // sequential keys; the table's mixing scatters them.
+    static uint32_t burst_keys[BURST];
+    for (uint32_t base = 0; base < BIG_NKEYS; base += BURST) {
+        uint32_t n = ((BIG_NKEYS - base) < BURST) ? (BIG_NKEYS - base) : BURST;
+        for (uint32_t i = 0; i < n; i++) burst_keys[i] = base + i;
+        saeclib_hash_insert_batch(&sht, burst_keys, burst_keys, n, NULL);
+    }
+
+    uint32_t state = 99;
+    static uint32_t lookups[NBURSTS][BURST];
+    for (int b = 0; b < NBURSTS; b++) {
+        for (int i = 0; i < BURST; i++) lookups[b][i] = xorshift(&state) % BIG_NKEYS;
+    }
+
+    uint32_t out[BURST];
+    uint64_t found_mask;
+    uint64_t sum = 0;
+
+    double t0 = now();
+    for (int b = 0; b < NBURSTS; b++) {
+        for (int i = 0; i < BURST; i++) {
+            saeclib_hash_search(&sht, &lookups[b][i], &out[i]);
+            sum += out[i];
+        }
+    }
+    double t1 = now();
+    for (int b = 0; b < NBURSTS; b++) {
+        saeclib_hash_search_batch(&sht, lookups[b], BURST, out, &found_mask);
+        for (int i = 0; i < BURST; i++) sum += out[i];
+    }
+    double t2 = now();
+
+    printf("\n%d buckets, %d keys, bursts of %d random lookups (checksum %llu)\n", BIG_CAPACITY,
+           BIG_NKEYS, BURST, (unsigned long long)sum);
+    printf("one at a time      %7.1f ns/lookup\n", (t1 - t0) * 1e9 / (NBURSTS * BURST));
+    printf("batched            %7.1f ns/lookup\n", (t2 - t1) * 1e9 / (NBURSTS * BURST));
+}
+
+/**
+ * Sweeps over every entry of a sparsely filled table: a byte-at-a-time scan of the control bytes,
+ * the iterator, and saeclib_hash_for_each.
+ */
+#define SWEEP_CAPACITY (1 << 20)
+#define SWEEP_NKEYS    (SWEEP_CAPACITY / 20)
+#define NSWEEPS        200
+
+static void sweep_sum(void* key, void* value, void* ctx)
+{
+    *(uint64_t*)ctx += *(uint32_t*)value;
+}
+
+static void run_sweep(void)
+{
+    static uint32_t keyspace[SWEEP_CAPACITY];
+    static uint32_t valuespace[SWEEP_CAPACITY];
+    static uint8_t status[SWEEP_CAPACITY];
+    saeclib_hash_table_t sht;
+    saeclib_hash_table_init_pow2(&sht, keyspace, valuespace, status, sizeof(keyspace),
+                                 sizeof(uint32_t), sizeof(uint32_t), saeclib_hash_table_u32_hash,
+                                 saeclib_hash_table_u32_cmp);
+    for (uint32_t key = 0; key < SWEEP_NKEYS; key++) {
+        saeclib_hash_insert(&sht, &key, &key);
+    }
+
+    uint64_t sum = 0;
+    double t0 = now();
+    for (int s = 0; s < NSWEEPS; s++) {
+        for (size_t i = 0; i < SWEEP_CAPACITY; i++) {
+            if (status[i] & 0x80)
+                sum += valuespace[i];
+        }
+    }
+    double t1 = now();
+    for (int s = 0; s < NSWEEPS; s++) {
+        saeclib_hash_iterator_t it;
+        for (saeclib_error_e err = saeclib_hash_iterator_init(&sht, &it);
+             err == SAECLIB_ERROR_NOERROR; err = saeclib_hash_iterator_next(&sht, &it)) {
+            sum += *(uint32_t*)saeclib_hash_iterator_value(&it);
+        }
+    }
+    double t2 = now();
+    for (int s = 0; s < NSWEEPS; s++) {
+        saeclib_hash_for_each(&sht, sweep_sum, &sum);
+    }
+    double t3 = now();
+
+    printf("\n%d buckets, %d keys, full sweeps (checksum %llu)\n", SWEEP_CAPACITY, SWEEP_NKEYS,
+           (unsigned long long)sum);
+    printf("byte at a time     %7.1f us/sweep\n", (t1 - t0) * 1e6 / NSWEEPS);
+    printf("iterator           %7.1f us/sweep\n", (t2 - t1) * 1e6 / NSWEEPS);
+    printf("for_each           %7.1f us/sweep\n", (t3 - t2) * 1e6 / NSWEEPS);
+}
+
+int main(int argc, char** argv)
+{
+    printf("saeclib_hash_bench: %d buckets, %d keys\n", CAPACITY, NKEYS);
+
+    const char* dists[] = { "sequential", "strided", "random" };
+    for (int d = 0; d < 3; d++) {
+        static uint32_t keyspace[CAPACITY];
+        static uint32_t valuespace[CAPACITY];
+        static uint8_t status[CAPACITY];
+        saeclib_hash_table_t sht;
+
+        // the modulo table gets the same power-of-two capacity, which is the worst case for it.
+        for (int i = 0; i < CAPACITY; i++) status[i] = 0;
+        saeclib_hash_table_init(&sht, keyspace, valuespace, status, sizeof(keyspace),
+                                sizeof(uint32_t), sizeof(uint32_t), saeclib_hash_table_u32_hash,
+                                saeclib_hash_table_u32_cmp);
+        run("modulo", dists[d], &sht);
+
+        for (int i = 0; i < CAPACITY; i++) status[i] = 0;
+        saeclib_hash_table_init_pow2(&sht, keyspace, valuespace, status, sizeof(keyspace),
+                                     sizeof(uint32_t), sizeof(uint32_t),
+                                     saeclib_hash_table_u32_hash, saeclib_hash_table_u32_cmp);
+        run("pow2", dists[d], &sht);
+
+        for (int i = 0; i < CAPACITY; i++) status[i] = 0;
+        saeclib_hash_table_init_pow2(&sht, keyspace, valuespace, status, sizeof(keyspace),
+                                     sizeof(uint32_t), sizeof(uint32_t),
+                                     saeclib_hash_table_u32_hash, callback_u32_cmp);
+        run("callback", dists[d], &sht);
+    }
+
+    run_batch();
+    run_sweep();
+
+    return 0;
+}
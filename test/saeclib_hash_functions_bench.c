@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "saeclib_hash.h"
+#include "saeclib_hash_functions.h"
+
+/**
+ * Measures the throughput of the hash functions in saeclib_hash_functions.h against the courtesy
+ * ones in saeclib_hash.h, over a range of input sizes.
+ */
+
+#define BUF_SIZE (64 * 1024)
+
+static uint8_t buf[BUF_SIZE];
+static char str_buf[BUF_SIZE + 1];
+
+// keeps the compiler from throwing the hashes away.
+static volatile uint64_t sink;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec * 1e-9);
+}
+
+/**
+ * How many times to hash an input of the given size so that each measurement moves about 1GB.
+ */
+static size_t reps_for(size_t size)
+{
+    return (1024ull * 1024 * 1024) / size;
+}
+
+static void report(const char* name, size_t size, size_t reps, double elapsed)
+{
+    printf("%-16s %6zu bytes  %7.2f GB/s  %7.1f ns/hash\n", name, size,
+           (double)size * reps / elapsed / 1e9, elapsed * 1e9 / reps);
+}
+
+int main(int argc, char** argv)
+{
+    for (size_t i = 0; i < BUF_SIZE; i++) {
+        buf[i] = i * 31;
+        str_buf[i] = 'a' + (i % 26);
+    }
+
+    printf("saeclib_hash_functions_bench\n");
+
+    const size_t sizes[] = { 4, 8, 16, 32, 64, 256, 1024, BUF_SIZE };
+    for (int s = 0; s < (sizeof(sizes) / sizeof(sizes[0])); s++) {
+        const size_t size = sizes[s];
+        const size_t reps = reps_for(size);
+        const size_t span = BUF_SIZE - size + 1;
+        double t0;
+
+        // step through the buffer so that consecutive hashes aren't of the same bytes.
+        t0 = now();
+        uint64_t h = 0;
+        for (size_t r = 0; r < reps; r++) {
+            h ^= saeclib_hash_bytes(buf + ((r * 64) % span), size, r);
+        }
+        sink = h;
+        report("bytes", size, reps, now() - t0);
+
+        t0 = now();
+        uint32_t crc = 0;
+        for (size_t r = 0; r < reps; r++) {
+            crc ^= saeclib_crc32c(0, buf + ((r * 64) % span), size);
+        }
+        sink = crc;
+        report("crc32c", size, reps, now() - t0);
+
+        // strings are terminated in place; the courtesy sdbm hash is too slow to run a full GB.
+        char saved = str_buf[size];
+        str_buf[size] = '\0';
+        char* str = str_buf;
+
+        t0 = now();
+        for (size_t r = 0; r < reps; r++) {
+            h ^= saeclib_hash_str(&str);
+            __asm__ volatile("" : : "r"(str) : "memory");
+        }
+        sink = h;
+        report("str", size, reps, now() - t0);
+
+        t0 = now();
+        for (size_t r = 0; r < (reps / 8); r++) {
+            h ^= saeclib_hash_table_str_hash(&str);
+            __asm__ volatile("" : : "r"(str) : "memory");
+        }
+        sink = h;
+        report("str (sdbm)", size, reps / 8, now() - t0);
+
+        str_buf[size] = saved;
+        printf("\n");
+    }
+
+    // integer hashes are measured in keys per second.
+    const size_t reps = 1 << 28;
+    double t0 = now();
+    uint64_t h = 0;
+    for (uint32_t k = 0; k < reps; k++) h += saeclib_hash_u32(&k);
+    sink = h;
+    double elapsed = now() - t0;
+    printf("%-16s %7.1f Mkeys/s\n", "u32", reps / elapsed / 1e6);
+
+    t0 = now();
+    for (uint32_t k = 0; k < reps; k++) h += saeclib_hash_crc32c_u32(&k);
+    sink = h;
+    elapsed = now() - t0;
+    printf("%-16s %7.1f Mkeys/s\n", "crc32c u32", reps / elapsed / 1e6);
+
+    return 0;
+}
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "saeclib_hash_functions.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/**
+ * Puts the low bits of count hashes into 1024 buckets and checks that no bucket gets much more
+ * than its share. With n keys per bucket on average, anything more than n + 8 * sqrt(n) would be
+ * vanishingly unlikely for a random function.
+ */
+static void check_spread(const uint32_t* hashes, size_t count)
+{
+#define NBUCKETS 1024
+    static uint32_t buckets[NBUCKETS];
+    memset(buckets, 0, sizeof(buckets));
+    for (size_t i = 0; i < count; i++) {
+        buckets[hashes[i] % NBUCKETS]++;
+    }
+
+    const uint32_t mean = count / NBUCKETS;
+    uint32_t max = 0;
+    for (int i = 0; i < NBUCKETS; i++) {
+        if (buckets[i] > max) max = buckets[i];
+    }
+    TEST_ASSERT_TRUE(max < (mean + 8 * 8));
+#undef NBUCKETS
+}
+
+/**
+ * Flipping any one input bit of mix64 should flip each output bit about half the time.
+ */
+void saeclib_hash_mix64_avalanche_test()
+{
+#define NUMEL 2000
+    static uint32_t flips[64][64];
+    memset(flips, 0, sizeof(flips));
+
+    srand(0);
+    for (int n = 0; n < NUMEL; n++) {
+        uint64_t x = ((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 20) ^ rand();
+        uint64_t h = saeclib_hash_mix64(x);
+        for (int i = 0; i < 64; i++) {
+            uint64_t d = h ^ saeclib_hash_mix64(x ^ (1ull << i));
+            for (int o = 0; o < 64; o++) {
+                flips[i][o] += (d >> o) & 1;
+            }
+        }
+    }
+
+    for (int i = 0; i < 64; i++) {
+        for (int o = 0; o < 64; o++) {
+            TEST_ASSERT_TRUE(flips[i][o] > (NUMEL * 4 / 10));
+            TEST_ASSERT_TRUE(flips[i][o] < (NUMEL * 6 / 10));
+        }
+    }
+#undef NUMEL
+}
+
+/**
+ * Sequential and strided integer keys spread out evenly.
+ */
+void saeclib_hash_u32_u64_spread_test()
+{
+#define NUMEL 65536
+    static uint32_t hashes[NUMEL];
+
+    for (uint32_t i = 0; i < NUMEL; i++) hashes[i] = saeclib_hash_u32(&i);
+    check_spread(hashes, NUMEL);
+
+    for (uint32_t i = 0; i < NUMEL; i++) {
+        uint32_t k = i * 1024;
+        hashes[i] = saeclib_hash_u32(&k);
+    }
+    check_spread(hashes, NUMEL);
+
+    for (uint32_t i = 0; i < NUMEL; i++) {
+        uint64_t k = (uint64_t)i << 32;
+        hashes[i] = saeclib_hash_u64(&k);
+    }
+    check_spread(hashes, NUMEL);
+#undef NUMEL
+}
+
+/**
+ * Keys of every length from 4 to 64 bytes that differ in 4 of their bytes spread out evenly.
+ */
+void saeclib_hash_bytes_spread_test()
+{
+#define NUMEL 65536
+    static uint32_t hashes[NUMEL];
+    uint8_t key[64];
+
+    for (size_t len = 4; len <= sizeof(key); len++) {
+        memset(key, 0x5a, sizeof(key));
+        for (uint32_t i = 0; i < NUMEL; i++) {
+            // move the part of the key that changes around as the length changes.
+            memcpy(key + ((len - 4) / 2), &i, 4);
+            hashes[i] = saeclib_hash_bytes(key, len, 0);
+        }
+        check_spread(hashes, NUMEL);
+    }
+
+    // the same bytes at different lengths hash differently.
+    memset(key, 0, sizeof(key));
+    for (size_t len = 0; len < sizeof(key); len++) {
+        TEST_ASSERT_NOT_EQUAL(saeclib_hash_bytes(key, len, 0), saeclib_hash_bytes(key, len + 1, 0));
+    }
+
+    // and so do the same bytes with different seeds.
+    TEST_ASSERT_NOT_EQUAL(saeclib_hash_bytes(key, 32, 0), saeclib_hash_bytes(key, 32, 1));
+#undef NUMEL
+}
+
+SAECLIB_DEFINE_BYTES_HASH(hash24, 24)
+
+/**
+ * Generated fixed-size hashes match saeclib_hash_bytes.
+ */
+void saeclib_hash_define_bytes_hash_test()
+{
+    uint8_t key[24];
+    for (int i = 0; i < 24; i++) key[i] = i * 11;
+    TEST_ASSERT_EQUAL_UINT32((unsigned int)saeclib_hash_bytes(key, 24, 0), hash24(key));
+}
+
+/**
+ * Strings that look alike ("key0", "key1", ...) spread out evenly.
+ */
+void saeclib_hash_str_spread_test()
+{
+#define NUMEL 65536
+    static uint32_t hashes[NUMEL];
+    char buf[32];
+    char* str = buf;
+
+    for (uint32_t i = 0; i < NUMEL; i++) {
+        snprintf(buf, sizeof(buf), "key%u", i);
+        hashes[i] = saeclib_hash_str(&str);
+    }
+    check_spread(hashes, NUMEL);
+
+    TEST_ASSERT_EQUAL_UINT64(saeclib_hash_bytes("hello", 5, 7), saeclib_hash_cstr("hello", 7));
+#undef NUMEL
+}
+
+/**
+ * Bit at a time CRC32C, to check the real one against.
+ */
+static uint32_t crc32c_reference(const uint8_t* p, size_t len)
+{
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0x82f63b78u : 0);
+        }
+    }
+    return ~crc;
+}
+
+void saeclib_crc32c_test()
+{
+    // standard check value
+    TEST_ASSERT_EQUAL_HEX32(0xe3069283, saeclib_crc32c(0, "123456789", 9));
+
+    // every length and alignment, and CRCs carried on across calls.
+    static uint8_t data[300];
+    for (int i = 0; i < sizeof(data); i++) data[i] = (i * 37) ^ (i >> 3);
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t len = 0; len < (sizeof(data) - offset); len += 7) {
+            uint32_t expected = crc32c_reference(data + offset, len);
+            TEST_ASSERT_EQUAL_HEX32(expected, saeclib_crc32c(0, data + offset, len));
+
+            uint32_t split = saeclib_crc32c(0, data + offset, len / 3);
+            split = saeclib_crc32c(split, data + offset + (len / 3), len - (len / 3));
+            TEST_ASSERT_EQUAL_HEX32(expected, split);
+        }
+    }
+
+    // sequential keys spread out evenly.
+#define NUMEL 65536
+    static uint32_t hashes[NUMEL];
+    for (uint32_t i = 0; i < NUMEL; i++) hashes[i] = saeclib_hash_crc32c_u32(&i);
+    check_spread(hashes, NUMEL);
+#undef NUMEL
+}
+
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(saeclib_hash_mix64_avalanche_test);
+    RUN_TEST(saeclib_hash_u32_u64_spread_test);
+    RUN_TEST(saeclib_hash_bytes_spread_test);
+    RUN_TEST(saeclib_hash_define_bytes_hash_test);
+    RUN_TEST(saeclib_hash_str_spread_test);
+    RUN_TEST(saeclib_crc32c_test);
+    return UNITY_END();
+}
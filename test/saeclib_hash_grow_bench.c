@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "saeclib_hash.h"
+
+/**
+ * Inserts keys into a hash table that starts small and doubles whenever it reaches 75% load,
+ * timing every insert. With incremental migration, the rehashing is spread over the inserts that
+ * follow each grow; with a stop-the-world rebuild, the insert that triggers the grow pays for all of
+ * it.
+ *
+ * saeclib itself never allocates, but the benchmark gets each bigger region from calloc, which
+ * stands in for regions that would be set aside statically. Allocating them isn't timed.
+ */
+
+#define START_CAPACITY (1 << 10)
+#define NKEYS          (3 * 1024 * 1024)
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec * 1e-9);
+}
+
+/**
+ * Sets up an empty power-of-two table of the given capacity on freshly allocated memory.
+ */
+static void make_table(saeclib_hash_table_t* sht, size_t capacity)
+{
+    void* keys = calloc(capacity, sizeof(uint32_t));
+    void* values = calloc(capacity, sizeof(uint32_t));
+    void* status = calloc(capacity, 1);
+
+    // touch every page up front, like a static region that's already resident.
+    memset(keys, 0, capacity * sizeof(uint32_t));
+    memset(values, 0, capacity * sizeof(uint32_t));
+    memset(status, 0, capacity);
+
+    saeclib_hash_table_init_pow2(sht, keys, values, status, capacity * sizeof(uint32_t),
+                                 sizeof(uint32_t), sizeof(uint32_t), saeclib_hash_table_u32_hash,
+                                 saeclib_hash_table_u32_cmp);
+}
+
+static void free_table(saeclib_hash_table_t* sht)
+{
+    free(sht->key_data);
+    free(sht->value_data);
+    free(sht->bucket_filled);
+}
+
+static void run(const char* name, bool incremental)
+{
+    // the table that's being grown out of has to stay put until migration is done, so alternate
+    // between two spares.
+    static saeclib_hash_table_t spares[2];
+    int spare = 0;
+
+    saeclib_hash_table_t sht;
+    make_table(&sht, START_CAPACITY);
+
+    // inserts that start a grow or happen during a migration are tracked separately, so that they
+    // can be told apart from noise like the process being descheduled.
+    double worst = 0, worst_growing = 0, total = 0;
+    uint32_t over_100us = 0, over_1ms = 0;
+    size_t numel = 0;
+
+    for (uint32_t key = 0; key < NKEYS; key++) {
+        // allocating the next region isn't part of the insert. By now, the last migration is long
+        // finished, so the region it left behind can be freed.
+        const bool grow = (numel >= (sht.capacity / 4 * 3));
+        if (grow) {
+            if (spares[spare].key_data != NULL) free_table(&spares[spare]);
+            make_table(&spares[spare], sht.capacity * 2);
+        }
+
+        double t0 = now();
+        const bool growing = grow || saeclib_hash_table_migrating(&sht);
+
+        if (grow) {
+            saeclib_hash_table_grow(&sht, &spares[spare]);
+            spare ^= 1;
+
+            if (!incremental) {
+                saeclib_hash_table_migrate(&sht, SIZE_MAX);
+            }
+        }
+
+        saeclib_hash_insert(&sht, &key, &key);
+        numel++;
+
+        double elapsed = now() - t0;
+        total += elapsed;
+        if (elapsed > worst) worst = elapsed;
+        if (growing && (elapsed > worst_growing)) worst_growing = elapsed;
+        if (elapsed > 100e-6) over_100us++;
+        if (elapsed > 1e-3) over_1ms++;
+    }
+
+    // check that nothing was lost.
+    uint32_t missing = 0;
+    for (uint32_t key = 0; key < NKEYS; key++) {
+        uint32_t v;
+        missing += (saeclib_hash_search(&sht, &key, &v) != SAECLIB_ERROR_NOERROR) || (v != key);
+    }
+
+    printf("%-16s mean %6.1f ns   worst %9.1f us   worst while growing %9.1f us   "
+           ">100us %4u   >1ms %4u   (%u missing)\n", name, total * 1e9 / NKEYS, worst * 1e6,
+           worst_growing * 1e6, over_100us, over_1ms, missing);
+
+    free_table(&sht);
+    for (int i = 0; i < 2; i++) {
+        if (spares[i].key_data != NULL) free_table(&spares[i]);
+        spares[i].key_data = NULL;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    printf("saeclib_hash_grow_bench: %d keys into a table that starts with %d buckets\n", NKEYS,
+           START_CAPACITY);
+    run("stop-the-world", false);
+    run("incremental", true);
+    return 0;
+}
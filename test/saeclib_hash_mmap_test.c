@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "unity.h"
+
+#include "saeclib_hash_mmap.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/**
+ * Makes an empty temporary file and returns its descriptor.
+ */
+static int make_temp_file(void)
+{
+    char path[] = "/tmp/saeclib_hash_mmap_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    unlink(path);
+    return fd;
+}
+
+static unsigned int other_hash(const void* a)
+{
+    return *(const uint32_t*)a * 31;
+}
+
+/**
+ * Writes sht to a file, maps it back, and checks that every key in [0, nkeys) is found with value
+ * key * 7 if it's odd, and not found if it's even.
+ */
+static void round_trip(saeclib_hash_table_t* sht, uint32_t nkeys)
+{
+    int fd = make_temp_file();
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_hash_mmap_write(sht, fd));
+
+    saeclib_hash_mmap_t map;
+    saeclib_hash_table_t loaded;
+    saeclib_error_e err = saeclib_hash_mmap_open(&map, &loaded, fd, saeclib_hash_table_u32_hash,
+                                                 saeclib_hash_table_u32_cmp);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    close(fd);
+
+    TEST_ASSERT_EQUAL_INT(sht->capacity, loaded.capacity);
+    TEST_ASSERT_EQUAL_INT(sht->mask, loaded.mask);
+    TEST_ASSERT_EQUAL_INT(sht->probe_dist != NULL, loaded.probe_dist != NULL);
+    TEST_ASSERT_EQUAL_INT(sht->hashes != NULL, loaded.hashes != NULL);
+
+    for (uint32_t key = 0; key < nkeys; key++) {
+        uint64_t value = 0;
+        err = saeclib_hash_search(&loaded, &key, &value);
+        if (key & 1) {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+            TEST_ASSERT_EQUAL_INT(key * 7, value);
+        } else {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+        }
+    }
+
+    size_t count = 0;
+    saeclib_hash_iterator_t it;
+    for (err = saeclib_hash_iterator_init(&loaded, &it); err == SAECLIB_ERROR_NOERROR;
+         err = saeclib_hash_iterator_next(&loaded, &it)) {
+        count++;
+    }
+    TEST_ASSERT_EQUAL_INT(nkeys / 2, count);
+
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_hash_mmap_close(&map));
+}
+
+/**
+ * Tables come back from a file with all of their keys and options.
+ */
+void saeclib_hash_mmap_round_trip_test()
+{
+#define NUMEL 1000
+    static uint32_t keys[NUMEL];
+    static uint64_t values[NUMEL];
+    static uint8_t status[NUMEL];
+
+    saeclib_hash_table_t sht;
+    saeclib_hash_table_init(&sht, keys, values, status, sizeof(keys), sizeof(uint32_t),
+                            sizeof(uint64_t), saeclib_hash_table_u32_hash,
+                            saeclib_hash_table_u32_cmp);
+    for (uint32_t key = 1; key < NUMEL; key += 2) {
+        saeclib_hash_insert(&sht, &key, (uint64_t[]){ key * 7 });
+    }
+    round_trip(&sht, NUMEL);
+
+    saeclib_hash_table_t sht2 = saeclib_hash_table_pow2_salloc(NUMEL, sizeof(uint32_t),
+                                                               sizeof(uint64_t),
+                                                               saeclib_hash_table_u32_hash,
+                                                               saeclib_hash_table_u32_cmp);
+    static uint8_t dists[SAECLIB_NEXT_POW2(NUMEL)];
+    static unsigned int hashes[SAECLIB_NEXT_POW2(NUMEL)];
+    saeclib_hash_table_enable_robin_hood(&sht2, dists);
+    saeclib_hash_table_enable_hash_cache(&sht2, hashes);
+    for (uint32_t key = 1; key < (2 * NUMEL); key += 2) {
+        saeclib_hash_insert(&sht2, &key, (uint64_t[]){ key * 7 });
+    }
+    round_trip(&sht2, 2 * NUMEL);
+
+#undef NUMEL
+}
+
+/**
+ * Files that aren't hash tables, are cut short, or are opened with the wrong hash function are
+ * rejected, and so are growing tables.
+ */
+void saeclib_hash_mmap_bad_file_test()
+{
+#define NUMEL 64
+    saeclib_hash_table_t sht = saeclib_hash_table_salloc(NUMEL, sizeof(uint32_t), sizeof(uint64_t),
+                                                         saeclib_hash_table_u32_hash,
+                                                         saeclib_hash_table_u32_cmp);
+    for (uint32_t key = 1; key < NUMEL; key += 2) {
+        saeclib_hash_insert(&sht, &key, (uint64_t[]){ key * 7 });
+    }
+
+    saeclib_hash_mmap_t map;
+    saeclib_hash_table_t loaded;
+
+    // not a hash table
+    int fd = make_temp_file();
+    static const char junk[8192] = "definitely not a hash table";
+    TEST_ASSERT_EQUAL_INT(sizeof(junk), write(fd, junk, sizeof(junk)));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_hash_mmap_open(&map, &loaded, fd, saeclib_hash_table_u32_hash,
+                                                 saeclib_hash_table_u32_cmp));
+    close(fd);
+
+    // empty file
+    fd = make_temp_file();
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_hash_mmap_open(&map, &loaded, fd, saeclib_hash_table_u32_hash,
+                                                 saeclib_hash_table_u32_cmp));
+
+    // cut short
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_hash_mmap_write(&sht, fd));
+    off_t len = lseek(fd, 0, SEEK_CUR);
+    TEST_ASSERT_EQUAL_INT(0, ftruncate(fd, len - 1));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_hash_mmap_open(&map, &loaded, fd, saeclib_hash_table_u32_hash,
+                                                 saeclib_hash_table_u32_cmp));
+
+    // wrong hash function
+    TEST_ASSERT_EQUAL_INT(0, ftruncate(fd, len));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_hash_mmap_open(&map, &loaded, fd, other_hash,
+                                                 saeclib_hash_table_u32_cmp));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                          saeclib_hash_mmap_open(&map, &loaded, fd, saeclib_hash_table_u32_hash,
+                                                 saeclib_hash_table_u32_cmp));
+    saeclib_hash_mmap_close(&map);
+    close(fd);
+
+    // growing
+    saeclib_hash_table_t bigger = saeclib_hash_table_salloc(4 * NUMEL, sizeof(uint32_t),
+                                                            sizeof(uint64_t),
+                                                            saeclib_hash_table_u32_hash,
+                                                            saeclib_hash_table_u32_cmp);
+    saeclib_hash_table_grow(&sht, &bigger);
+    fd = make_temp_file();
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, saeclib_hash_mmap_write(&sht, fd));
+    close(fd);
+
+#undef NUMEL
+}
+
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(saeclib_hash_mmap_round_trip_test);
+    RUN_TEST(saeclib_hash_mmap_bad_file_test);
+    return UNITY_END();
+}
@@ -1,6 +1,9 @@
 #include <stdio.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 
 #include "unity.h"
 
@@ -114,8 +117,59 @@ void saeclib_hash_table_search_missing_entry0()
 /**
  * force a hash collision
  */
+static unsigned int colliding_hash(const void* a)
+{
+    // only 8 distinct hashes, all of them near the end of a 100 bucket table, so that probe
+    // sequences have to wrap around and keys with the same control byte are common.
+    return 92 + (*((uint32_t*)a) % 8);
+}
+
+/**
+ * Fill a table whose capacity isn't a multiple of the probe group size with colliding keys, and
+ * make sure that every key can be found, that a full table overflows, and that deletes keep the
+ * probe chains intact.
+ */
+void saeclib_hash_table_collision_test()
+{
+#define NUMEL 100
+    saeclib_hash_table_t sht = saeclib_hash_table_salloc(NUMEL, sizeof(uint32_t), sizeof(int),
+                                                         colliding_hash,
+                                                         saeclib_hash_table_u32_cmp);
+
+    saeclib_error_e err;
+    for (uint32_t key = 0; key < NUMEL; key++) {
+        err = saeclib_hash_insert(&sht, &key, (int[]){key * 3});
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    }
+
+    uint32_t key = NUMEL;
+    err = saeclib_hash_insert(&sht, &key, (int[]){0});
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_OVERFLOW, err);
+    err = saeclib_hash_search(&sht, &key, (int[]){0});
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
 
+    key = 7;
+    err = saeclib_hash_insert(&sht, &key, (int[]){0});
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_DUPLICATE_KEY, err);
 
+    for (uint32_t key = 0; key < NUMEL; key += 2) {
+        err = saeclib_hash_delete(&sht, &key);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    }
+
+    for (uint32_t key = 0; key < NUMEL; key++) {
+        int x;
+        err = saeclib_hash_search(&sht, &key, &x);
+        if (key % 2) {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+            TEST_ASSERT_EQUAL_INT(key * 3, x);
+        } else {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+        }
+    }
+
+#undef NUMEL
+}
 
 
 /**
@@ -222,6 +276,864 @@ void saeclib_hash_table_fuzz_test0()
 }
 
 
+static int hash_calls, cmp_calls;
+
+static unsigned int counting_str_hash(const void* a)
+{
+    hash_calls++;
+    return saeclib_hash_table_str_hash(a);
+}
+
+static int counting_str_cmp(const void* a, const void* b)
+{
+    cmp_calls++;
+    return saeclib_hash_table_str_cmp(a, b);
+}
+
+/**
+ * With the hash cache enabled, deletes only hash the key being deleted, and cmp is only called on
+ * keys whose whole hash matches.
+ */
+void saeclib_hash_table_hash_cache_test()
+{
+#define NUMEL 64
+    saeclib_hash_table_t sht = saeclib_hash_table_salloc(NUMEL, sizeof(char*), sizeof(int),
+                                                         counting_str_hash,
+                                                         counting_str_cmp);
+    static char names[NUMEL][16];
+    static char* keys[NUMEL];
+    for (int i = 0; i < NUMEL; i++) {
+        snprintf(names[i], sizeof(names[i]), "k%d", i);
+        keys[i] = names[i];
+    }
+
+    // enabling the cache on a table that isn't empty hashes the keys already there.
+    saeclib_error_e err;
+    for (int i = 0; i < (NUMEL / 2); i++) {
+        err = saeclib_hash_insert(&sht, &keys[i], &i);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    }
+    static unsigned int hashspace[NUMEL];
+    saeclib_hash_table_enable_hash_cache(&sht, hashspace);
+    for (int i = (NUMEL / 2); i < (NUMEL - 4); i++) {
+        err = saeclib_hash_insert(&sht, &keys[i], &i);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    }
+
+    // every key is found with exactly one call to cmp.
+    for (int i = 0; i < (NUMEL - 4); i++) {
+        int x;
+        cmp_calls = 0;
+        err = saeclib_hash_search(&sht, &keys[i], &x);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+        TEST_ASSERT_EQUAL_INT(i, x);
+        TEST_ASSERT_EQUAL_INT(1, cmp_calls);
+    }
+
+    // deleting keys from a nearly full table moves plenty of keys around without rehashing them.
+    for (int i = 0; i < (NUMEL - 4); i += 3) {
+        hash_calls = 0;
+        err = saeclib_hash_delete(&sht, &keys[i]);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+        TEST_ASSERT_EQUAL_INT(1, hash_calls);
+    }
+
+    for (int i = 0; i < NUMEL; i++) {
+        int x;
+        err = saeclib_hash_search(&sht, &keys[i], &x);
+        if (((i % 3) != 0) && (i < (NUMEL - 4))) {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+            TEST_ASSERT_EQUAL_INT(i, x);
+        } else {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+        }
+    }
+
+#undef NUMEL
+}
+
+/**
+ * Checks that every key in a Robin Hood hash table is ordered by home bucket and has its distance
+ * from home recorded correctly.
+ */
+static void check_robin_hood_invariant(saeclib_hash_table_t* sht)
+{
+    for (size_t i = 0; i < sht->capacity; i++) {
+        if (!sht->bucket_filled[i])
+            continue;
+
+        size_t home = sht->hash_fn(sht->key_data + (i * sht->key_elt_size)) % sht->capacity;
+        TEST_ASSERT_EQUAL_INT((i + sht->capacity - home) % sht->capacity, sht->probe_dist[i]);
+
+        size_t next = (i + 1) % sht->capacity;
+        if (sht->bucket_filled[next]) {
+            TEST_ASSERT_TRUE(sht->probe_dist[next] <= (sht->probe_dist[i] + 1));
+        }
+    }
+}
+
+/**
+ * Same as the fuzz test above, but with Robin Hood insertion and a much higher load factor.
+ */
+void saeclib_hash_table_robin_hood_fuzz_test()
+{
+#define NUMEL 1000
+#define KEY_RANGE 2000
+    srand(1);
+
+    saeclib_hash_table_t sht = saeclib_hash_table_salloc(NUMEL, sizeof(uint32_t), sizeof(int),
+                                                         saeclib_hash_table_u32_hash,
+                                                         saeclib_hash_table_u32_cmp);
+    static uint8_t distspace[NUMEL];
+    saeclib_error_e err = saeclib_hash_table_enable_robin_hood(&sht, distspace);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+
+    static int golden_array[KEY_RANGE] = { 0 };
+    static int golden_occupancy[KEY_RANGE] = { 0 };
+    int numel = 0;
+
+    for (int i = 0; i < 200000; i++) {
+        int action = rand() % 100;
+        uint32_t key = rand() % KEY_RANGE;
+        int value = rand();
+
+        // keep the table around 95% full.
+        if ((action < 50) && (numel < (NUMEL * 95 / 100))) {
+            err = saeclib_hash_insert(&sht, &key, &value);
+            if (golden_occupancy[key]) {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_DUPLICATE_KEY, err);
+            } else {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                golden_array[key] = value;
+                golden_occupancy[key] = 1;
+                numel++;
+            }
+        } else if (action < 75) {
+            err = saeclib_hash_delete(&sht, &key);
+            if (golden_occupancy[key]) {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                golden_occupancy[key] = 0;
+                numel--;
+            } else {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+            }
+        } else {
+            int x;
+            err = saeclib_hash_search(&sht, &key, &x);
+            if (golden_occupancy[key]) {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                TEST_ASSERT_EQUAL_INT(golden_array[key], x);
+            } else {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+            }
+        }
+
+        if ((i % 10000) == 0) {
+            check_robin_hood_invariant(&sht);
+        }
+    }
+
+    check_robin_hood_invariant(&sht);
+    for (uint32_t key = 0; key < KEY_RANGE; key++) {
+        int x;
+        err = saeclib_hash_search(&sht, &key, &x);
+        if (golden_occupancy[key]) {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+            TEST_ASSERT_EQUAL_INT(golden_array[key], x);
+        } else {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+        }
+    }
+
+    // Robin Hood insertion can only be turned on for an empty table.
+    static uint8_t distspace2[NUMEL];
+    err = saeclib_hash_table_enable_robin_hood(&sht, distspace2);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, err);
+
+#undef NUMEL
+#undef KEY_RANGE
+}
+
+/**
+ * A full Robin Hood table overflows, and keys that would end up too far from home are refused.
+ */
+void saeclib_hash_table_robin_hood_full_test()
+{
+#define NUMEL 300
+    saeclib_hash_table_t sht = saeclib_hash_table_salloc(NUMEL, sizeof(uint32_t), sizeof(int),
+                                                         colliding_hash,
+                                                         saeclib_hash_table_u32_cmp);
+    static uint8_t distspace[NUMEL];
+    saeclib_hash_table_enable_robin_hood(&sht, distspace);
+
+    // all of these keys have one of 8 home buckets, so the run gets long quickly.
+    saeclib_error_e err = SAECLIB_ERROR_NOERROR;
+    uint32_t key;
+    for (key = 0; key < NUMEL; key++) {
+        err = saeclib_hash_insert(&sht, &key, (int[]){key});
+        if (err != SAECLIB_ERROR_NOERROR)
+            break;
+    }
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_OVERFLOW, err);
+    TEST_ASSERT_TRUE(key > 250);
+    check_robin_hood_invariant(&sht);
+
+    for (uint32_t k = 0; k < key; k++) {
+        int x;
+        err = saeclib_hash_search(&sht, &k, &x);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+        TEST_ASSERT_EQUAL_INT(k, x);
+    }
+
+#undef NUMEL
+}
+
+
+/**
+ * Power-of-two tables round their capacity up, refuse other capacities, and work with every other
+ * option turned on, even with sequential keys and an identity hash at a high load factor.
+ */
+void saeclib_hash_table_pow2_test()
+{
+#define NUMEL 1000
+    saeclib_hash_table_t sht = saeclib_hash_table_pow2_salloc(NUMEL, sizeof(uint32_t), sizeof(int),
+                                                              saeclib_hash_table_u32_hash,
+                                                              saeclib_hash_table_u32_cmp);
+    TEST_ASSERT_EQUAL_INT(1024, sht.capacity);
+    TEST_ASSERT_EQUAL_INT(1023, sht.mask);
+
+    static uint8_t distspace[1024];
+    static unsigned int hashspace[1024];
+    saeclib_hash_table_enable_robin_hood(&sht, distspace);
+    saeclib_hash_table_enable_hash_cache(&sht, hashspace);
+
+    saeclib_error_e err;
+    for (uint32_t key = 0; key < NUMEL; key++) {
+        err = saeclib_hash_insert(&sht, &key, (int[]){key + 1});
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    }
+    for (uint32_t key = 0; key < NUMEL; key += 2) {
+        err = saeclib_hash_delete(&sht, &key);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    }
+    for (uint32_t key = 0; key < (2 * NUMEL); key++) {
+        int x;
+        err = saeclib_hash_search(&sht, &key, &x);
+        if ((key < NUMEL) && (key % 2)) {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+            TEST_ASSERT_EQUAL_INT(key + 1, x);
+        } else {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+        }
+    }
+
+    saeclib_hash_table_t bad;
+    static uint32_t keyspace[NUMEL];
+    static uint8_t status[NUMEL];
+    err = saeclib_hash_table_init_pow2(&bad, keyspace, NULL, status, sizeof(keyspace),
+                                       sizeof(uint32_t), 0, saeclib_hash_table_u32_hash,
+                                       saeclib_hash_table_u32_cmp);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, err);
+
+#undef NUMEL
+}
+
+
+/**
+ * Batched inserts and searches give the same results as doing them one at a time, across several
+ * batch chunks.
+ */
+void saeclib_hash_table_batch_test()
+{
+#define NUMEL 512
+#define BATCH 150
+    saeclib_hash_table_t sht = saeclib_hash_table_pow2_salloc(NUMEL, sizeof(uint32_t), sizeof(int),
+                                                              saeclib_hash_table_u32_hash,
+                                                              saeclib_hash_table_u32_cmp);
+
+    // the last key repeats the first one.
+    static uint32_t keys[BATCH];
+    static int values[BATCH];
+    for (int i = 0; i < BATCH; i++) {
+        keys[i] = (i * 7) + 1;
+        values[i] = -i;
+    }
+    keys[BATCH - 1] = keys[0];
+
+    static saeclib_error_e errs[BATCH];
+    saeclib_error_e err = saeclib_hash_insert_batch(&sht, keys, values, BATCH, errs);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_DUPLICATE_KEY, err);
+    for (int i = 0; i < (BATCH - 1); i++) {
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, errs[i]);
+    }
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_DUPLICATE_KEY, errs[BATCH - 1]);
+
+    // look up every other key that was inserted, with misses in between.
+    static uint32_t lookups[BATCH];
+    static int out[BATCH];
+    uint64_t found_mask[(BATCH + 63) / 64];
+    for (int i = 0; i < BATCH; i++) {
+        lookups[i] = (i % 2) ? keys[i] : (keys[i] + 3);
+        out[i] = 12345;
+    }
+    err = saeclib_hash_search_batch(&sht, lookups, BATCH, out, found_mask);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+
+    for (int i = 0; i < BATCH; i++) {
+        int x = 12345;
+        saeclib_error_e single = saeclib_hash_search(&sht, &lookups[i], &x);
+        bool found = (found_mask[i / 64] >> (i % 64)) & 1;
+        TEST_ASSERT_EQUAL_INT((i % 2) == 1, found);
+        TEST_ASSERT_EQUAL_INT(found ? SAECLIB_ERROR_NOERROR : SAECLIB_ERROR_UNDERFLOW, single);
+        TEST_ASSERT_EQUAL_INT(x, out[i]);
+    }
+
+    // a batch where everything is found.
+    err = saeclib_hash_search_batch(&sht, keys, BATCH - 1, out, found_mask);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    TEST_ASSERT_EQUAL_HEX64(~0ull, found_mask[0]);
+    TEST_ASSERT_EQUAL_HEX64((1ull << (BATCH - 1 - 128)) - 1, found_mask[2]);
+    TEST_ASSERT_EQUAL_INT(-(BATCH - 2), out[BATCH - 2]);
+
+#undef NUMEL
+#undef BATCH
+}
+
+
+/**
+ * Grows a small table into bigger and bigger ones while randomly inserting, deleting, and
+ * searching, checking against a golden example the whole time.
+ */
+void saeclib_hash_table_grow_test()
+{
+#define KEY_RANGE 6000
+    srand(2);
+
+    // three regions: 64, 256 and 2048 buckets. The 64 bucket region is reused as a spare once
+    // the first migration is done, and goes unused after that.
+    static uint32_t keys0[64], keys1[256], keys2[2048];
+    static int vals0[64], vals1[256], vals2[2048];
+    static uint8_t status0[64], status1[256], status2[2048];
+    static unsigned int hashes2[2048];
+    static uint8_t dist2[2048];
+
+    saeclib_hash_table_t sht, bigger, biggest;
+    saeclib_hash_table_init(&sht, keys0, vals0, status0, sizeof(keys0), sizeof(uint32_t),
+                            sizeof(int), saeclib_hash_table_u32_hash, saeclib_hash_table_u32_cmp);
+    saeclib_hash_table_init_pow2(&bigger, keys1, vals1, status1, sizeof(keys1), sizeof(uint32_t),
+                                 sizeof(int), saeclib_hash_table_u32_hash,
+                                 saeclib_hash_table_u32_cmp);
+    saeclib_hash_table_init_pow2(&biggest, keys2, vals2, status2, sizeof(keys2),
+                                 sizeof(uint32_t), sizeof(int), saeclib_hash_table_u32_hash,
+                                 saeclib_hash_table_u32_cmp);
+    saeclib_hash_table_enable_hash_cache(&biggest, hashes2);
+    saeclib_hash_table_enable_robin_hood(&biggest, dist2);
+
+    static int golden_array[KEY_RANGE];
+    static int golden_occupancy[KEY_RANGE];
+    int numel = 0;
+    int grows = 0;
+
+    for (int i = 0; i < 100000; i++) {
+        int action = rand() % 100;
+        uint32_t key = rand() % KEY_RANGE;
+        int value = rand();
+        saeclib_error_e err;
+
+        // grow at 75% load.
+        if ((grows < 2) && (numel >= (sht.capacity * 3 / 4))) {
+            TEST_ASSERT_FALSE(saeclib_hash_table_migrating(&sht));
+            err = saeclib_hash_table_grow(&sht, (grows == 0) ? &bigger : &biggest);
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+            TEST_ASSERT_TRUE(saeclib_hash_table_migrating(&sht));
+
+            // can't start another grow in the middle of one.
+            err = saeclib_hash_table_grow(&sht, &bigger);
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, err);
+            grows++;
+        }
+
+        if ((action < 45) && (numel < 1500)) {
+            err = saeclib_hash_insert(&sht, &key, &value);
+            if (golden_occupancy[key]) {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_DUPLICATE_KEY, err);
+            } else {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                golden_array[key] = value;
+                golden_occupancy[key] = 1;
+                numel++;
+            }
+        } else if (action < 60) {
+            err = saeclib_hash_delete(&sht, &key);
+            if (golden_occupancy[key]) {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                golden_occupancy[key] = 0;
+                numel--;
+            } else {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+            }
+        } else {
+            int* px;
+            err = saeclib_hash_search_ref(&sht, &key, (void**)&px);
+            if (golden_occupancy[key]) {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                TEST_ASSERT_EQUAL_INT(golden_array[key], *px);
+                (*px)++;
+                golden_array[key]++;
+            } else {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+            }
+        }
+    }
+
+    TEST_ASSERT_EQUAL_INT(2, grows);
+    TEST_ASSERT_FALSE(saeclib_hash_table_migrating(&sht));
+    TEST_ASSERT_EQUAL_INT(2048, sht.capacity);
+    TEST_ASSERT_EQUAL_PTR(hashes2, sht.hashes);
+
+    // the region that was grown out of is handed back empty.
+    TEST_ASSERT_EQUAL_INT(256, biggest.capacity);
+    for (int i = 0; i < 256; i++) {
+        TEST_ASSERT_EQUAL_INT(0, status1[i]);
+    }
+
+    for (uint32_t key = 0; key < KEY_RANGE; key++) {
+        int x;
+        saeclib_error_e err = saeclib_hash_search(&sht, &key, &x);
+        if (golden_occupancy[key]) {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+            TEST_ASSERT_EQUAL_INT(golden_array[key], x);
+        } else {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+        }
+    }
+
+#undef KEY_RANGE
+}
+
+/**
+ * A table that's only searched during a grow can be finished off with saeclib_hash_table_migrate.
+ */
+void saeclib_hash_table_migrate_test()
+{
+#define NUMEL 100
+    saeclib_hash_table_t sht = saeclib_hash_table_salloc(NUMEL, sizeof(uint32_t), sizeof(int),
+                                                         saeclib_hash_table_u32_hash,
+                                                         saeclib_hash_table_u32_cmp);
+    saeclib_hash_table_t bigger = saeclib_hash_table_salloc(2 * NUMEL, sizeof(uint32_t),
+                                                            sizeof(int),
+                                                            saeclib_hash_table_u32_hash,
+                                                            saeclib_hash_table_u32_cmp);
+    for (uint32_t key = 0; key < NUMEL; key++) {
+        saeclib_hash_insert(&sht, &key, (int[]){key * 2});
+    }
+    uint32_t key = NUMEL;
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_OVERFLOW, saeclib_hash_insert(&sht, &key, (int[]){0}));
+
+    // only an empty table can be grown into.
+    saeclib_hash_insert(&bigger, &key, (int[]){0});
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, saeclib_hash_table_grow(&sht, &bigger));
+    saeclib_hash_delete(&bigger, &key);
+
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_hash_table_grow(&sht, &bigger));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_hash_table_migrate(&sht, 10));
+    TEST_ASSERT_TRUE(saeclib_hash_table_migrating(&sht));
+
+    // nor one that's in the middle of growing itself.
+    saeclib_hash_table_t smaller = saeclib_hash_table_salloc(NUMEL / 2, sizeof(uint32_t),
+                                                             sizeof(int),
+                                                             saeclib_hash_table_u32_hash,
+                                                             saeclib_hash_table_u32_cmp);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, saeclib_hash_table_grow(&smaller, &sht));
+
+    uint32_t keys[NUMEL];
+    int out[NUMEL];
+    uint64_t found_mask[2];
+    for (uint32_t i = 0; i < NUMEL; i++) keys[i] = i;
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                          saeclib_hash_search_batch(&sht, keys, NUMEL, out, found_mask));
+    for (uint32_t i = 0; i < NUMEL; i++) TEST_ASSERT_EQUAL_INT(i * 2, out[i]);
+
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_hash_table_migrate(&sht, SIZE_MAX));
+    TEST_ASSERT_FALSE(saeclib_hash_table_migrating(&sht));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_hash_insert(&sht, &key, (int[]){0}));
+
+#undef NUMEL
+}
+
+
+typedef struct optimistic_test_ctx
+{
+    saeclib_hash_table_t* sht;
+    volatile int stop;
+    int errors;
+    long searches;
+} optimistic_test_ctx_t;
+
+// Keys below this are inserted before the readers start and never deleted; the writer churns the
+// keys above it. Every value is key * 3 + 1, repeated.
+#define STABLE_KEYS 200
+
+typedef struct optimistic_test_value
+{
+    uint32_t a, b, c, d;
+} optimistic_test_value_t;
+
+static void* optimistic_reader(void* arg)
+{
+    optimistic_test_ctx_t* ctx = arg;
+    uint32_t key = 0;
+    while (!ctx->stop) {
+        key = (key + 7) % (4 * STABLE_KEYS);
+
+        optimistic_test_value_t v;
+        saeclib_error_e err = saeclib_hash_search_optimistic(ctx->sht, &key, &v);
+        if (err == SAECLIB_ERROR_NOERROR) {
+            uint32_t expected = (key * 3) + 1;
+            if ((v.a != expected) || (v.b != expected) || (v.c != expected) || (v.d != expected))
+                ctx->errors++;
+        } else if (key < STABLE_KEYS) {
+            ctx->errors++;
+        }
+        ctx->searches++;
+    }
+    return NULL;
+}
+
+/**
+ * Readers searching while a writer inserts, deletes (shifting keys around), and grows the table
+ * never see a half-written value, and never miss a key that stays in the table.
+ */
+void saeclib_hash_table_optimistic_test()
+{
+#define NUMEL 512
+    static uint32_t keys0[NUMEL], keys1[4 * NUMEL];
+    static optimistic_test_value_t vals0[NUMEL], vals1[4 * NUMEL];
+    static uint8_t status0[NUMEL], status1[4 * NUMEL];
+
+    // the identity hash puts consecutive keys in consecutive buckets, so the table is one long run
+    // and deletes do lots of backward shifting.
+    saeclib_hash_table_t sht, bigger;
+    saeclib_hash_table_init(&sht, keys0, vals0, status0, sizeof(keys0), sizeof(uint32_t),
+                            sizeof(optimistic_test_value_t), saeclib_hash_table_u32_hash,
+                            saeclib_hash_table_u32_cmp);
+    saeclib_hash_table_init_pow2(&bigger, keys1, vals1, status1, sizeof(keys1), sizeof(uint32_t),
+                                 sizeof(optimistic_test_value_t), saeclib_hash_table_u32_hash,
+                                 saeclib_hash_table_u32_cmp);
+
+    for (uint32_t key = 0; key < STABLE_KEYS; key++) {
+        uint32_t x = (key * 3) + 1;
+        saeclib_hash_insert(&sht, &key, &(optimistic_test_value_t){ x, x, x, x });
+    }
+
+    optimistic_test_ctx_t ctx = { &sht, 0, 0, 0 };
+    pthread_t readers[3];
+    for (int i = 0; i < 3; i++) {
+        pthread_create(&readers[i], NULL, optimistic_reader, &ctx);
+    }
+
+    srand(3);
+    for (int i = 0; i < 300000; i++) {
+        uint32_t key = STABLE_KEYS + (rand() % (3 * STABLE_KEYS));
+        uint32_t x = (key * 3) + 1;
+        if (rand() % 2) {
+            saeclib_hash_insert(&sht, &key, &(optimistic_test_value_t){ x, x, x, x });
+        } else {
+            saeclib_hash_delete(&sht, &key);
+        }
+
+        if (i == 100000) {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_hash_table_grow(&sht, &bigger));
+        }
+    }
+
+    ctx.stop = 1;
+    for (int i = 0; i < 3; i++) {
+        pthread_join(readers[i], NULL);
+    }
+
+    TEST_ASSERT_EQUAL_INT(0, ctx.errors);
+    TEST_ASSERT_TRUE(ctx.searches > 0);
+    TEST_ASSERT_EQUAL_INT(4 * NUMEL, sht.capacity);
+
+#undef NUMEL
+}
+
+/**
+ * Once a grow is finished, the region that was grown out of can be used as a table of its own,
+ * and optimistic searches of it work like they do on any other table.
+ */
+void saeclib_hash_table_grow_reuse_test()
+{
+#define NUMEL 256
+    saeclib_hash_table_t sht = saeclib_hash_table_salloc(NUMEL, sizeof(uint32_t),
+                                                         sizeof(optimistic_test_value_t),
+                                                         saeclib_hash_table_u32_hash,
+                                                         saeclib_hash_table_u32_cmp);
+    saeclib_hash_table_t spare = saeclib_hash_table_salloc(4 * NUMEL, sizeof(uint32_t),
+                                                           sizeof(optimistic_test_value_t),
+                                                           saeclib_hash_table_u32_hash,
+                                                           saeclib_hash_table_u32_cmp);
+    for (uint32_t key = 0; key < STABLE_KEYS; key++) {
+        uint32_t x = (key * 3) + 1;
+        saeclib_hash_insert(&sht, &key, &(optimistic_test_value_t){ x, x, x, x });
+    }
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_hash_table_grow(&sht, &spare));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_hash_table_migrate(&sht, SIZE_MAX));
+    TEST_ASSERT_FALSE(saeclib_hash_table_migrating(&sht));
+
+    // spare now holds the old region, empty, and isn't in the middle of a write.
+    TEST_ASSERT_EQUAL_INT(NUMEL, spare.capacity);
+    TEST_ASSERT_EQUAL_INT(0, spare.seq & 1);
+    for (uint32_t key = 0; key < STABLE_KEYS; key++) {
+        uint32_t x = (key * 3) + 1;
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                              saeclib_hash_insert(&spare, &key,
+                                                  &(optimistic_test_value_t){ x, x, x, x }));
+    }
+
+    optimistic_test_ctx_t ctx = { &spare, 0, 0, 0 };
+    pthread_t readers[3];
+    for (int i = 0; i < 3; i++) {
+        pthread_create(&readers[i], NULL, optimistic_reader, &ctx);
+    }
+
+    srand(5);
+    for (int i = 0; i < 100000; i++) {
+        uint32_t key = STABLE_KEYS + (rand() % (STABLE_KEYS / 4));
+        uint32_t x = (key * 3) + 1;
+        if (rand() % 2) {
+            saeclib_hash_insert(&spare, &key, &(optimistic_test_value_t){ x, x, x, x });
+        } else {
+            saeclib_hash_delete(&spare, &key);
+        }
+    }
+
+    ctx.stop = 1;
+    for (int i = 0; i < 3; i++) {
+        pthread_join(readers[i], NULL);
+    }
+
+    TEST_ASSERT_EQUAL_INT(0, ctx.errors);
+    TEST_ASSERT_TRUE(ctx.searches > 0);
+
+#undef NUMEL
+}
+#undef STABLE_KEYS
+
+
+static void iterate_count(void* key, void* value, void* ctx)
+{
+    uint32_t* seen = ctx;
+    TEST_ASSERT_EQUAL_INT(*(uint32_t*)key + 1, *(uint32_t*)value);
+    seen[*(uint32_t*)key]++;
+}
+
+/**
+ * Checks that iterating over sht, both with an iterator and with saeclib_hash_for_each, visits
+ * exactly the keys marked in present, once each.
+ */
+static void check_iteration(saeclib_hash_table_t* sht, const bool* present, size_t nkeys)
+{
+    static uint32_t seen[1024];
+    memset(seen, 0, sizeof(seen));
+
+    saeclib_hash_iterator_t it;
+    saeclib_error_e err;
+    for (err = saeclib_hash_iterator_init(sht, &it); err == SAECLIB_ERROR_NOERROR;
+         err = saeclib_hash_iterator_next(sht, &it)) {
+        iterate_count(saeclib_hash_iterator_key(&it), saeclib_hash_iterator_value(&it), seen);
+    }
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+    for (size_t key = 0; key < nkeys; key++) {
+        TEST_ASSERT_EQUAL_INT(present[key] ? 1 : 0, seen[key]);
+    }
+
+    memset(seen, 0, sizeof(seen));
+    saeclib_hash_for_each(sht, iterate_count, seen);
+    for (size_t key = 0; key < nkeys; key++) {
+        TEST_ASSERT_EQUAL_INT(present[key] ? 1 : 0, seen[key]);
+    }
+}
+
+/**
+ * Iterators and saeclib_hash_for_each visit every key once, in tables that aren't a multiple of the
+ * scan width, and in both regions of a growing table. Values can be changed through the iterator.
+ */
+void saeclib_hash_table_iterator_test()
+{
+#define NUMEL 100
+    static uint32_t keys0[NUMEL], keys1[4 * NUMEL];
+    static uint32_t vals0[NUMEL], vals1[4 * NUMEL];
+    static uint8_t status0[NUMEL], status1[4 * NUMEL];
+    static bool present[4 * NUMEL];
+
+    saeclib_hash_table_t sht, bigger;
+    saeclib_hash_table_init(&sht, keys0, vals0, status0, sizeof(keys0), sizeof(uint32_t),
+                            sizeof(uint32_t), saeclib_hash_table_u32_hash,
+                            saeclib_hash_table_u32_cmp);
+    saeclib_hash_table_init(&bigger, keys1, vals1, status1, sizeof(keys1), sizeof(uint32_t),
+                            sizeof(uint32_t), saeclib_hash_table_u32_hash,
+                            saeclib_hash_table_u32_cmp);
+
+    saeclib_hash_iterator_t it;
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, saeclib_hash_iterator_init(&sht, &it));
+
+    srand(4);
+    for (int i = 0; i < 2000; i++) {
+        uint32_t key = rand() % (2 * NUMEL);
+        if (rand() % 3) {
+            if (saeclib_hash_insert(&sht, &key, (uint32_t[]){ key + 1 }) == SAECLIB_ERROR_NOERROR)
+                present[key] = true;
+        } else if (saeclib_hash_delete(&sht, &key) == SAECLIB_ERROR_NOERROR) {
+            present[key] = false;
+        }
+    }
+    check_iteration(&sht, present, 2 * NUMEL);
+
+    // the last bucket is one that the scalar tail has to find.
+    uint32_t last = NUMEL - 1;
+    saeclib_hash_delete(&sht, &last);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                          saeclib_hash_insert(&sht, &last, (uint32_t[]){ last + 1 }));
+    present[last] = true;
+    check_iteration(&sht, present, 2 * NUMEL);
+
+    // partway through growing, some keys are in each region.
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_hash_table_grow(&sht, &bigger));
+    for (uint32_t key = 2 * NUMEL; key < (2 * NUMEL) + 5; key++) {
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                              saeclib_hash_insert(&sht, &key, (uint32_t[]){ key + 1 }));
+        present[key] = true;
+    }
+    TEST_ASSERT_TRUE(saeclib_hash_table_migrating(&sht));
+    check_iteration(&sht, present, 4 * NUMEL);
+
+    // values are modified in place.
+    for (saeclib_error_e err = saeclib_hash_iterator_init(&sht, &it); err == SAECLIB_ERROR_NOERROR;
+         err = saeclib_hash_iterator_next(&sht, &it)) {
+        (*(uint32_t*)saeclib_hash_iterator_value(&it))++;
+    }
+    for (uint32_t key = 0; key < 4 * NUMEL; key++) {
+        uint32_t value;
+        if (present[key]) {
+            saeclib_hash_search(&sht, &key, &value);
+            TEST_ASSERT_EQUAL_INT(key + 2, value);
+        }
+    }
+
+#undef NUMEL
+}
+
+
+/**
+ * Hash functions that only look at the first 4 bytes of a key, so that keys which differ in their
+ * other bytes always share a probe chain and control byte, and have to be told apart by comparing
+ * the whole key.
+ */
+static unsigned int low_word_hash(const void* a)
+{
+    uint32_t h;
+    memcpy(&h, a, sizeof(h));
+    return h;
+}
+
+// the built-in compare functions, which the table can't tell are built in.
+static int wrapped_u32_cmp(const void* a, const void* b)
+{
+    return saeclib_hash_table_u32_cmp(a, b);
+}
+
+static int wrapped_u64_cmp(const void* a, const void* b)
+{
+    return saeclib_hash_table_u64_cmp(a, b);
+}
+
+static int wrapped_u128_cmp(const void* a, const void* b)
+{
+    return saeclib_hash_table_u128_cmp(a, b);
+}
+
+/**
+ * Tables with the built-in compare functions and matching key sizes compare keys inline, anything
+ * else calls cmp, and both find and miss the same keys.
+ */
+void saeclib_hash_table_key_kind_test()
+{
+#define NUMEL 64
+    static uint8_t keys[NUMEL * 16];
+    static uint32_t vals[NUMEL];
+    static uint8_t status[NUMEL];
+    saeclib_hash_table_t sht;
+
+    saeclib_hash_table_init(&sht, keys, vals, status, NUMEL * 4, 4, sizeof(uint32_t),
+                            low_word_hash, saeclib_hash_table_u32_cmp);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_HASH_KEY_U32, sht.key_kind);
+    saeclib_hash_table_init(&sht, keys, vals, status, NUMEL * 4, 4, sizeof(uint32_t),
+                            low_word_hash, wrapped_u32_cmp);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_HASH_KEY_GENERIC, sht.key_kind);
+    saeclib_hash_table_init(&sht, keys, vals, status, NUMEL * 8, 8, sizeof(uint32_t),
+                            low_word_hash, saeclib_hash_table_u32_cmp);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_HASH_KEY_GENERIC, sht.key_kind);
+
+    // for each size of key, the inline compare and the same compare through a generic table.
+    const size_t sizes[] = { 8, 8, 16, 16 };
+    int (*cmps[])(const void*, const void*) = { saeclib_hash_table_u64_cmp, wrapped_u64_cmp,
+                                                saeclib_hash_table_u128_cmp, wrapped_u128_cmp };
+    const saeclib_hash_key_kind_e kinds[] = { SAECLIB_HASH_KEY_U64, SAECLIB_HASH_KEY_GENERIC,
+                                              SAECLIB_HASH_KEY_U128, SAECLIB_HASH_KEY_GENERIC };
+    for (int t = 0; t < 4; t++) {
+        const size_t size = sizes[t];
+        memset(status, 0, sizeof(status));
+        saeclib_hash_table_init(&sht, keys, vals, status, NUMEL * size, size, sizeof(uint32_t),
+                                low_word_hash, cmps[t]);
+        TEST_ASSERT_EQUAL_INT(kinds[t], sht.key_kind);
+
+        // keys i and i + NUMEL / 2 differ only in the last byte, and they all hash to 0 or 1.
+        uint8_t key[16];
+        for (uint32_t i = 0; i < (NUMEL / 2); i++) {
+            memset(key, 0, sizeof(key));
+            key[0] = i & 1;
+            key[size - 1] = i;
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                                  saeclib_hash_insert(&sht, key, (uint32_t[]){ i }));
+        }
+        for (uint32_t i = 0; i < NUMEL; i++) {
+            memset(key, 0, sizeof(key));
+            key[0] = i & 1;
+            key[size - 1] = i;
+            uint32_t value;
+            if (i < (NUMEL / 2)) {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_hash_search(&sht, key, &value));
+                TEST_ASSERT_EQUAL_INT(i, value);
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_DUPLICATE_KEY,
+                                      saeclib_hash_insert(&sht, key, &value));
+            } else {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW,
+                                      saeclib_hash_search(&sht, key, &value));
+            }
+        }
+
+        // deleting half the keys leaves the other half findable.
+        for (uint32_t i = 0; i < (NUMEL / 2); i += 2) {
+            memset(key, 0, sizeof(key));
+            key[size - 1] = i;
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_hash_delete(&sht, key));
+        }
+        for (uint32_t i = 0; i < (NUMEL / 2); i++) {
+            memset(key, 0, sizeof(key));
+            key[0] = i & 1;
+            key[size - 1] = i;
+            uint32_t value;
+            TEST_ASSERT_EQUAL_INT((i & 1) ? SAECLIB_ERROR_NOERROR : SAECLIB_ERROR_UNDERFLOW,
+                                  saeclib_hash_search(&sht, key, &value));
+        }
+    }
+
+#undef NUMEL
+}
+
+
 int main(int argc, char** argv)
 {
     UNITY_BEGIN();
@@ -229,6 +1141,18 @@ int main(int argc, char** argv)
     RUN_TEST(saeclib_hash_table_salloc_test);
     RUN_TEST(saeclib_hash_table_insert_test0);
     RUN_TEST(saeclib_hash_table_search_missing_entry0);
+    RUN_TEST(saeclib_hash_table_collision_test);
     RUN_TEST(saeclib_hash_table_fuzz_test0);
+    RUN_TEST(saeclib_hash_table_robin_hood_fuzz_test);
+    RUN_TEST(saeclib_hash_table_robin_hood_full_test);
+    RUN_TEST(saeclib_hash_table_hash_cache_test);
+    RUN_TEST(saeclib_hash_table_pow2_test);
+    RUN_TEST(saeclib_hash_table_batch_test);
+    RUN_TEST(saeclib_hash_table_grow_test);
+    RUN_TEST(saeclib_hash_table_migrate_test);
+    RUN_TEST(saeclib_hash_table_optimistic_test);
+    RUN_TEST(saeclib_hash_table_grow_reuse_test);
+    RUN_TEST(saeclib_hash_table_iterator_test);
+    RUN_TEST(saeclib_hash_table_key_kind_test);
     return UNITY_END();
 }
@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "saeclib_hash.h"
+#include "saeclib_hashmap.h"
+
+/**
+ * Compares lookups in a uint32_t -> struct map generated by SAECLIB_DEFINE_HASHMAP against the
+ * same map built with the runtime saeclib_hash_table_t API, at about 85% load.
+ */
+
+#define CAPACITY (1 << 16)
+#define NKEYS    (CAPACITY * 85 / 100)
+#define ROUNDS   20
+
+typedef struct particle
+{
+    float x, y, z;
+    uint32_t flags;
+} particle_t;
+
+#define u32_hash(k) (k)
+#define u32_eq(a, b) ((a) == (b))
+SAECLIB_DEFINE_HASHMAP(particle_map, uint32_t, particle_t, u32_hash, u32_eq, CAPACITY)
+
+static uint32_t keys[NKEYS];
+static volatile float sink;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec * 1e-9);
+}
+
+int main(int argc, char** argv)
+{
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        // random-looking, distinct keys: multiplying by an odd number is a bijection on uint32_t.
+        keys[i] = (i + 1) * 0x9e3779b1u;
+    }
+
+    static particle_map_t map;
+    saeclib_hash_table_t sht = saeclib_hash_table_pow2_salloc(CAPACITY, sizeof(uint32_t),
+                                                              sizeof(particle_t),
+                                                              saeclib_hash_table_u32_hash,
+                                                              saeclib_hash_table_u32_cmp);
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        particle_t p = { i, i, i, i };
+        particle_map_insert(&map, keys[i], p);
+        saeclib_hash_insert(&sht, &keys[i], &p);
+    }
+
+    printf("saeclib_hashmap_bench: %d buckets, %d keys\n", CAPACITY, NKEYS);
+
+    float acc = 0;
+    double t0 = now();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (uint32_t i = 0; i < NKEYS; i++) {
+            particle_t p = { 0 };
+            saeclib_hash_search(&sht, &keys[i], &p);
+            acc += p.x;
+        }
+    }
+    double runtime = now() - t0;
+
+    t0 = now();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (uint32_t i = 0; i < NKEYS; i++) {
+            particle_t p = { 0 };
+            particle_map_search(&map, keys[i], &p);
+            acc += p.x;
+        }
+    }
+    double generated = now() - t0;
+    sink = acc;
+
+    printf("%-24s %6.1f ns/lookup\n", "saeclib_hash_table_t", runtime * 1e9 / (ROUNDS * NKEYS));
+    printf("%-24s %6.1f ns/lookup\n", "SAECLIB_DEFINE_HASHMAP", generated * 1e9 / (ROUNDS * NKEYS));
+
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "saeclib_hashmap.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+typedef struct particle
+{
+    float x, y, z;
+    uint32_t flags;
+} particle_t;
+
+#define u32_hash(k) (k)
+#define u32_eq(a, b) ((a) == (b))
+SAECLIB_DEFINE_HASHMAP(particle_map, uint32_t, particle_t, u32_hash, u32_eq, 1000)
+
+static unsigned int str_hash(const char* s)
+{
+    unsigned int h = 0;
+    while (*s) h = (h * 31) + *s++;
+    return h;
+}
+#define str_eq(a, b) (strcmp((a), (b)) == 0)
+SAECLIB_DEFINE_HASHMAP(name_map, const char*, int, str_hash, str_eq, 8)
+
+/**
+ * Capacity is rounded up, and a static map starts out empty.
+ */
+void saeclib_hashmap_init_test()
+{
+    static particle_map_t m;
+
+    TEST_ASSERT_EQUAL_INT(1024, particle_map_capacity);
+    TEST_ASSERT_EQUAL_INT(0, particle_map_size(&m));
+
+    particle_map_iterator_t it;
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, particle_map_iterator_init(&m, &it));
+
+    particle_t p;
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, particle_map_search(&m, 7, &p));
+}
+
+/**
+ * String keys, duplicates, a full map, and iterating over everything in it.
+ */
+void saeclib_hashmap_str_test()
+{
+    static name_map_t m;
+    const char* names[] = { "john", "jill", "jack", "jane", "joe", "jim", "jen", "jo" };
+
+    for (int i = 0; i < 8; i++) {
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, name_map_insert(&m, names[i], i));
+    }
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_OVERFLOW, name_map_insert(&m, "jeb", 8));
+
+    // keys are compared by content, not by pointer.
+    char john[] = "john";
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_DUPLICATE_KEY, name_map_insert(&m, john, 9));
+
+    int* ref;
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, name_map_search_ref(&m, john, &ref));
+    *ref = 100;
+
+    int seen = 0, sum = 0;
+    name_map_iterator_t it;
+    for (saeclib_error_e err = name_map_iterator_init(&m, &it); err == SAECLIB_ERROR_NOERROR;
+         err = name_map_iterator_next(&m, &it)) {
+        seen++;
+        sum += *name_map_iterator_value(&m, &it);
+        TEST_ASSERT_NOT_NULL(*name_map_iterator_key(&m, &it));
+    }
+    TEST_ASSERT_EQUAL_INT(8, seen);
+    TEST_ASSERT_EQUAL_INT(100 + 1 + 2 + 3 + 4 + 5 + 6 + 7, sum);
+
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, name_map_delete(&m, "jane"));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, name_map_delete(&m, "jane"));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, name_map_insert(&m, "jeb", 8));
+    TEST_ASSERT_EQUAL_INT(8, name_map_size(&m));
+}
+
+/**
+ * Randomly inserts, deletes, and reads back values, checking against a golden example.
+ */
+void saeclib_hashmap_fuzz_test()
+{
+#define KEY_RANGE 3000
+    static particle_map_t m;
+    static particle_t golden_array[KEY_RANGE];
+    static int golden_occupancy[KEY_RANGE];
+    size_t numel = 0;
+    srand(0);
+
+    for (int i = 0; i < 300000; i++) {
+        int action = rand() % 100;
+        uint32_t key = rand() % KEY_RANGE;
+        particle_t p = { rand(), rand(), rand(), rand() };
+
+        if (action < 40) {
+            if (numel >= 1000)
+                continue;
+            saeclib_error_e err = particle_map_insert(&m, key, p);
+            if (golden_occupancy[key]) {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_DUPLICATE_KEY, err);
+            } else {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                golden_array[key] = p;
+                golden_occupancy[key] = 1;
+                numel++;
+            }
+        } else if (action < 70) {
+            saeclib_error_e err = particle_map_delete(&m, key);
+            if (golden_occupancy[key]) {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                golden_occupancy[key] = 0;
+                numel--;
+            } else {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+            }
+        } else {
+            particle_t out;
+            saeclib_error_e err = particle_map_search(&m, key, &out);
+            if (golden_occupancy[key]) {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                TEST_ASSERT_EQUAL_MEMORY(&golden_array[key], &out, sizeof(out));
+            } else {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+            }
+        }
+        TEST_ASSERT_EQUAL_INT(numel, particle_map_size(&m));
+    }
+
+    size_t seen = 0;
+    particle_map_iterator_t it;
+    for (saeclib_error_e err = particle_map_iterator_init(&m, &it); err == SAECLIB_ERROR_NOERROR;
+         err = particle_map_iterator_next(&m, &it)) {
+        uint32_t key = *particle_map_iterator_key(&m, &it);
+        TEST_ASSERT_TRUE(golden_occupancy[key]);
+        TEST_ASSERT_EQUAL_MEMORY(&golden_array[key], particle_map_iterator_value(&m, &it),
+                                 sizeof(particle_t));
+        seen++;
+    }
+    TEST_ASSERT_EQUAL_INT(numel, seen);
+#undef KEY_RANGE
+}
+
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(saeclib_hashmap_init_test);
+    RUN_TEST(saeclib_hashmap_str_test);
+    RUN_TEST(saeclib_hashmap_fuzz_test);
+    return UNITY_END();
+}
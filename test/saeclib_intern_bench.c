@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "saeclib_hash.h"
+#include "saeclib_intern.h"
+
+/**
+ * Looks up a stream of identifiers, as a parser would look up symbols, in a saeclib_hash_table_t
+ * with char* keys (saeclib_hash_table_str_hash and saeclib_hash_table_str_cmp) and in an intern
+ * pool, then compares the cost of the lookups that follow once the symbols are ids.
+ */
+
+#define NSYMBOLS 8192
+#define NTOKENS  (1 << 21)
+
+static char names[NSYMBOLS][24];
+static const char* name_ptrs[NSYMBOLS];
+static uint32_t tokens[NTOKENS];
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec * 1e-9);
+}
+
+int main(int argc, char** argv)
+{
+    // identifiers that share long prefixes, like names in real code often do.
+    for (uint32_t i = 0; i < NSYMBOLS; i++) {
+        snprintf(names[i], sizeof(names[i]), "module_symbol_%u", i * 7919);
+        name_ptrs[i] = names[i];
+    }
+    srand(0);
+    for (uint32_t i = 0; i < NTOKENS; i++) {
+        tokens[i] = rand() % NSYMBOLS;
+    }
+
+    saeclib_hash_table_t sht = saeclib_hash_table_pow2_salloc(2 * NSYMBOLS, sizeof(char*),
+                                                              sizeof(uint32_t),
+                                                              saeclib_hash_table_str_hash,
+                                                              saeclib_hash_table_str_cmp);
+    saeclib_intern_pool_t pool = saeclib_intern_pool_salloc(NSYMBOLS, NSYMBOLS * 24);
+    for (uint32_t i = 0; i < NSYMBOLS; i++) {
+        uint32_t id;
+        saeclib_hash_insert(&sht, &name_ptrs[i], &i);
+        saeclib_intern_add_cstr(&pool, names[i], &id);
+    }
+
+    // the token text is a separate copy, as it would be coming out of a lexer.
+    static char text[NSYMBOLS][24];
+    static const char* text_ptrs[NSYMBOLS];
+    static size_t text_lens[NSYMBOLS];
+    for (uint32_t i = 0; i < NSYMBOLS; i++) {
+        strcpy(text[i], names[i]);
+        text_ptrs[i] = text[i];
+        text_lens[i] = strlen(text[i]);
+    }
+
+    uint64_t sum = 0;
+    double t0 = now();
+    for (uint32_t i = 0; i < NTOKENS; i++) {
+        uint32_t value;
+        saeclib_hash_search(&sht, &text_ptrs[tokens[i]], &value);
+        sum += value;
+    }
+    double t1 = now();
+    for (uint32_t i = 0; i < NTOKENS; i++) {
+        uint32_t id;
+        saeclib_intern_find(&pool, text[tokens[i]], text_lens[tokens[i]], &id);
+        sum += id;
+    }
+    double t2 = now();
+
+    // once a symbol's an id, comparing it with another is one integer compare.
+    static uint32_t ids[NTOKENS];
+    for (uint32_t i = 0; i < NTOKENS; i++) {
+        saeclib_intern_find(&pool, text[tokens[i]], text_lens[tokens[i]], &ids[i]);
+    }
+    double t3 = now();
+    for (uint32_t i = 1; i < NTOKENS; i++) {
+        sum += !strcmp(saeclib_intern_str(&pool, ids[i]), saeclib_intern_str(&pool, ids[i - 1]));
+    }
+    double t4 = now();
+    for (uint32_t i = 1; i < NTOKENS; i++) {
+        sum += (ids[i] == ids[i - 1]);
+    }
+    double t5 = now();
+
+    printf("saeclib_intern_bench: %d symbols, %d tokens (checksum %llu)\n", NSYMBOLS, NTOKENS,
+           (unsigned long long)sum);
+    printf("char* hash table lookup  %6.1f ns/token\n", (t1 - t0) * 1e9 / NTOKENS);
+    printf("intern pool lookup       %6.1f ns/token\n", (t2 - t1) * 1e9 / NTOKENS);
+    printf("strcmp of two symbols    %6.1f ns\n", (t4 - t3) * 1e9 / NTOKENS);
+    printf("compare of two ids       %6.1f ns\n", (t5 - t4) * 1e9 / NTOKENS);
+
+    return 0;
+}
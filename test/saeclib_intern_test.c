@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "saeclib_intern.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void saeclib_intern_pool_init_test()
+{
+    saeclib_intern_pool_t pool;
+    static char arenaspace[64];
+    static saeclib_intern_entry_t entryspace[8];
+    static uint32_t tablespace[16];
+
+    // table not bigger than the number of strings, or not a power of two.
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_intern_pool_init(&pool, arenaspace, sizeof(arenaspace),
+                                                   entryspace, sizeof(entryspace), tablespace,
+                                                   8 * sizeof(uint32_t)));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_intern_pool_init(&pool, arenaspace, sizeof(arenaspace),
+                                                   entryspace, sizeof(entryspace), tablespace,
+                                                   12 * sizeof(uint32_t)));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                          saeclib_intern_pool_init(&pool, arenaspace, sizeof(arenaspace),
+                                                   entryspace, sizeof(entryspace), tablespace,
+                                                   sizeof(tablespace)));
+    TEST_ASSERT_EQUAL_INT(8, pool.max_strings);
+    TEST_ASSERT_EQUAL_INT(0, saeclib_intern_count(&pool));
+    TEST_ASSERT_NULL(saeclib_intern_str(&pool, 0));
+    TEST_ASSERT_EQUAL_INT(0, saeclib_intern_len(&pool, 0));
+}
+
+/**
+ * The same string always gets the same id, different strings get ids in order, and strings come
+ * back out as they went in.
+ */
+void saeclib_intern_add_test()
+{
+    saeclib_intern_pool_t pool = saeclib_intern_pool_salloc(16, 256);
+
+    uint32_t foo, bar, foo2, empty, tok;
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_intern_add_cstr(&pool, "foo", &foo));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_intern_add_cstr(&pool, "bar", &bar));
+    TEST_ASSERT_EQUAL_INT(0, foo);
+    TEST_ASSERT_EQUAL_INT(1, bar);
+
+    // a copy somewhere else is the same string.
+    char buf[] = "foo";
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_intern_add_cstr(&pool, buf, &foo2));
+    TEST_ASSERT_EQUAL_INT(foo, foo2);
+    TEST_ASSERT_EQUAL_INT(2, saeclib_intern_count(&pool));
+
+    // tokens out of a bigger buffer, prefixes, and the empty string are all different strings.
+    const char* src = "foobar fo";
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_intern_add(&pool, src + 3, 3, &tok));
+    TEST_ASSERT_EQUAL_INT(bar, tok);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_intern_add(&pool, src + 7, 2, &tok));
+    TEST_ASSERT_EQUAL_INT(2, tok);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_intern_add(&pool, src, 0, &empty));
+    TEST_ASSERT_EQUAL_INT(3, empty);
+
+    // strings with nuls in them.
+    uint32_t a, b;
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_intern_add(&pool, "a\0b", 3, &a));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_intern_add(&pool, "a\0c", 3, &b));
+    TEST_ASSERT_TRUE(a != b);
+    TEST_ASSERT_EQUAL_INT(3, saeclib_intern_len(&pool, b));
+    TEST_ASSERT_EQUAL_MEMORY("a\0c", saeclib_intern_str(&pool, b), 4);
+
+    TEST_ASSERT_EQUAL_STRING("foo", saeclib_intern_str(&pool, foo));
+    TEST_ASSERT_EQUAL_STRING("bar", saeclib_intern_str(&pool, bar));
+    TEST_ASSERT_EQUAL_STRING("fo", saeclib_intern_str(&pool, 2));
+    TEST_ASSERT_EQUAL_STRING("", saeclib_intern_str(&pool, empty));
+    TEST_ASSERT_EQUAL_INT(3, saeclib_intern_len(&pool, foo));
+
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_intern_find(&pool, "fo", 2, &tok));
+    TEST_ASSERT_EQUAL_INT(2, tok);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, saeclib_intern_find(&pool, "f", 1, &tok));
+    TEST_ASSERT_EQUAL_INT(6, saeclib_intern_count(&pool));
+
+    saeclib_intern_pool_clear(&pool);
+    TEST_ASSERT_EQUAL_INT(0, saeclib_intern_count(&pool));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, saeclib_intern_find(&pool, "foo", 3, &tok));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_intern_add_cstr(&pool, "bar", &bar));
+    TEST_ASSERT_EQUAL_INT(0, bar);
+}
+
+/**
+ * Running out of ids or of arena is an overflow that leaves the pool as it was, and strings that
+ * are already there can still be interned.
+ */
+void saeclib_intern_overflow_test()
+{
+    saeclib_intern_pool_t pool = saeclib_intern_pool_salloc(4, 16);
+    uint32_t id;
+
+    // "0123456789" takes 11 bytes, leaving 5.
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_intern_add_cstr(&pool, "0123456789", &id));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_OVERFLOW, saeclib_intern_add_cstr(&pool, "abcde", &id));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, saeclib_intern_find(&pool, "abcde", 5, &id));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_intern_add_cstr(&pool, "abcd", &id));
+    TEST_ASSERT_EQUAL_INT(1, id);
+    TEST_ASSERT_EQUAL_INT(16, pool.arena_used);
+
+    // the empty string still takes a byte for its nul.
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_OVERFLOW, saeclib_intern_add_cstr(&pool, "", &id));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_intern_add_cstr(&pool, "abcd", &id));
+    TEST_ASSERT_EQUAL_INT(1, id);
+
+    pool = saeclib_intern_pool_salloc(2, 64);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_intern_add_cstr(&pool, "x", &id));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_intern_add_cstr(&pool, "y", &id));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_OVERFLOW, saeclib_intern_add_cstr(&pool, "z", &id));
+    TEST_ASSERT_EQUAL_INT(2, saeclib_intern_count(&pool));
+}
+
+/**
+ * Lots of random tokens, many of them repeated, intern to the same ids as a plain list of the
+ * strings seen so far would give them.
+ */
+void saeclib_intern_fuzz_test()
+{
+#define NUMEL 2000
+    saeclib_intern_pool_t pool = saeclib_intern_pool_salloc(NUMEL, NUMEL * 16);
+    static char golden[NUMEL][16];
+    uint32_t count = 0;
+
+    srand(0);
+    for (int i = 0; i < 50000; i++) {
+        // tokens of 1 to 12 letters from a small alphabet, so that short ones repeat a lot.
+        char tok[16];
+        const int len = 1 + (rand() % 12);
+        for (int j = 0; j < len; j++) {
+            tok[j] = 'a' + (rand() % 3);
+        }
+        tok[len] = '\0';
+
+        uint32_t expected = count;
+        for (uint32_t k = 0; k < count; k++) {
+            if (!strcmp(golden[k], tok)) {
+                expected = k;
+                break;
+            }
+        }
+
+        uint32_t id;
+        saeclib_error_e err = saeclib_intern_add(&pool, tok, len, &id);
+        if (expected == count) {
+            if (count == NUMEL) {
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_OVERFLOW, err);
+                continue;
+            }
+            strcpy(golden[count++], tok);
+        }
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+        TEST_ASSERT_EQUAL_INT(expected, id);
+    }
+    TEST_ASSERT_EQUAL_INT(count, saeclib_intern_count(&pool));
+
+    for (uint32_t k = 0; k < count; k++) {
+        TEST_ASSERT_EQUAL_STRING(golden[k], saeclib_intern_str(&pool, k));
+    }
+
+#undef NUMEL
+}
+
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(saeclib_intern_pool_init_test);
+    RUN_TEST(saeclib_intern_add_test);
+    RUN_TEST(saeclib_intern_overflow_test);
+    RUN_TEST(saeclib_intern_fuzz_test);
+    return UNITY_END();
+}
@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "saeclib_hash.h"
+#include "saeclib_hash_functions.h"
+#include "saeclib_lru_cache.h"
+
+/**
+ * Runs the same skewed stream of accesses (a get, and a put on a miss) through a cache in LRU
+ * mode and in CLOCK mode, and reports the time per access and hit rate of each.
+ */
+
+#define CAPACITY  (1 << 14)
+#define KEY_RANGE (1 << 17)
+#define NACCESSES (1 << 23)
+
+static uint32_t accesses[NACCESSES];
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec * 1e-9);
+}
+
+static void run(saeclib_lru_cache_t* cache, const char* name)
+{
+    size_t hits = 0;
+    double t0 = now();
+    for (uint32_t i = 0; i < NACCESSES; i++) {
+        uint64_t value;
+        if (saeclib_lru_cache_get(cache, &accesses[i], &value) == SAECLIB_ERROR_NOERROR) {
+            hits++;
+        } else {
+            value = accesses[i];
+            saeclib_lru_cache_put(cache, &accesses[i], &value);
+        }
+    }
+    double t1 = now();
+
+    printf("%-8s %7.1f ns/access    %5.1f%% hits\n", name, (t1 - t0) * 1e9 / NACCESSES,
+           100.0 * hits / NACCESSES);
+}
+
+int main(int argc, char** argv)
+{
+    // the product of two uniform numbers favours small keys: nearly 40% of accesses go to the
+    // smallest eighth of the keys, which is as many keys as the cache holds.
+    srand(0);
+    for (uint32_t i = 0; i < NACCESSES; i++) {
+        uint64_t a = rand() % KEY_RANGE, b = rand() % KEY_RANGE;
+        accesses[i] = (a * b) / KEY_RANGE;
+    }
+
+    saeclib_lru_cache_t lru = saeclib_lru_cache_salloc(CAPACITY, sizeof(uint32_t),
+                                                       sizeof(uint64_t), saeclib_hash_u32,
+                                                       saeclib_hash_table_u32_cmp,
+                                                       SAECLIB_LRU_CACHE_LRU);
+    saeclib_lru_cache_t clock = saeclib_lru_cache_salloc(CAPACITY, sizeof(uint32_t),
+                                                         sizeof(uint64_t), saeclib_hash_u32,
+                                                         saeclib_hash_table_u32_cmp,
+                                                         SAECLIB_LRU_CACHE_CLOCK);
+
+    printf("saeclib_lru_cache_bench: %d entries, %d keys, %d accesses\n", CAPACITY, KEY_RANGE,
+           NACCESSES);
+    run(&lru, "LRU");
+    run(&clock, "CLOCK");
+
+    return 0;
+}
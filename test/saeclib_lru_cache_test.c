@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "unity.h"
+
+#include "saeclib_lru_cache.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void saeclib_lru_cache_init_test()
+{
+    static uint32_t keyspace[8], valuespace[8];
+    static saeclib_lru_cache_slot_t slotspace[8];
+    saeclib_lru_cache_t cache;
+
+    // index too small for the cache
+    saeclib_hash_table_t index = saeclib_hash_table_pow2_salloc(4, sizeof(uint32_t),
+                                                                sizeof(uint32_t),
+                                                                saeclib_hash_table_u32_hash,
+                                                                saeclib_hash_table_u32_cmp);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_lru_cache_init(&cache, &index, keyspace, valuespace, slotspace,
+                                                 8, sizeof(uint32_t), SAECLIB_LRU_CACHE_LRU));
+
+    // index without uint32_t values
+    index = saeclib_hash_table_pow2_salloc(16, sizeof(uint32_t), sizeof(uint64_t),
+                                           saeclib_hash_table_u32_hash,
+                                           saeclib_hash_table_u32_cmp);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_lru_cache_init(&cache, &index, keyspace, valuespace, slotspace,
+                                                 8, sizeof(uint32_t), SAECLIB_LRU_CACHE_LRU));
+
+    cache = saeclib_lru_cache_salloc(8, sizeof(uint32_t), sizeof(uint32_t),
+                                     saeclib_hash_table_u32_hash, saeclib_hash_table_u32_cmp,
+                                     SAECLIB_LRU_CACHE_LRU);
+    TEST_ASSERT_EQUAL_INT(8, cache.capacity);
+    TEST_ASSERT_EQUAL_INT(0, saeclib_lru_cache_size(&cache));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, saeclib_lru_cache_evict(&cache, NULL, NULL));
+}
+
+/**
+ * Gets and puts move keys to the front, and the least recently used key is the one that's evicted.
+ */
+void saeclib_lru_cache_lru_order_test()
+{
+    saeclib_lru_cache_t cache = saeclib_lru_cache_salloc(4, sizeof(uint32_t), sizeof(uint32_t),
+                                                         saeclib_hash_table_u32_hash,
+                                                         saeclib_hash_table_u32_cmp,
+                                                         SAECLIB_LRU_CACHE_LRU);
+    for (uint32_t k = 0; k < 4; k++) {
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                              saeclib_lru_cache_put(&cache, &k, (uint32_t[]){ k + 100 }));
+    }
+
+    // order from most recent is now 3 2 1 0; make it 0 2 3 1.
+    uint32_t value;
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_lru_cache_get(&cache, (uint32_t[]){ 3 }, &value));
+    TEST_ASSERT_EQUAL_INT(103, value);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                          saeclib_lru_cache_put(&cache, (uint32_t[]){ 2 }, (uint32_t[]){ 202 }));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_lru_cache_get(&cache, (uint32_t[]){ 0 }, &value));
+    TEST_ASSERT_EQUAL_INT(4, saeclib_lru_cache_size(&cache));
+
+    // putting 4 evicts 1.
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                          saeclib_lru_cache_put(&cache, (uint32_t[]){ 4 }, (uint32_t[]){ 104 }));
+    TEST_ASSERT_EQUAL_INT(4, saeclib_lru_cache_size(&cache));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, saeclib_lru_cache_get(&cache, (uint32_t[]){ 1 }, &value));
+
+    // then 3, 2, 0 and 4, in that order.
+    const uint32_t expected_keys[] = { 3, 2, 0, 4 };
+    const uint32_t expected_values[] = { 103, 202, 100, 104 };
+    for (int i = 0; i < 4; i++) {
+        uint32_t key;
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_lru_cache_evict(&cache, &key, &value));
+        TEST_ASSERT_EQUAL_INT(expected_keys[i], key);
+        TEST_ASSERT_EQUAL_INT(expected_values[i], value);
+    }
+    TEST_ASSERT_EQUAL_INT(0, saeclib_lru_cache_size(&cache));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, saeclib_lru_cache_evict(&cache, NULL, NULL));
+}
+
+/**
+ * In CLOCK mode, keys that were used since the hand last passed them get a second chance.
+ */
+void saeclib_lru_cache_clock_test()
+{
+    saeclib_lru_cache_t cache = saeclib_lru_cache_salloc(4, sizeof(uint32_t), sizeof(uint32_t),
+                                                         saeclib_hash_table_u32_hash,
+                                                         saeclib_hash_table_u32_cmp,
+                                                         SAECLIB_LRU_CACHE_CLOCK);
+    for (uint32_t k = 0; k < 4; k++) {
+        saeclib_lru_cache_put(&cache, &k, &k);
+    }
+
+    // 0 and 2 are referenced, so the hand passes them and stops on 1, then on 3.
+    uint32_t value, key;
+    saeclib_lru_cache_get(&cache, (uint32_t[]){ 0 }, &value);
+    saeclib_lru_cache_get(&cache, (uint32_t[]){ 2 }, &value);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                          saeclib_lru_cache_put(&cache, (uint32_t[]){ 4 }, (uint32_t[]){ 4 }));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, saeclib_lru_cache_get(&cache, (uint32_t[]){ 1 }, &value));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_lru_cache_evict(&cache, &key, NULL));
+    TEST_ASSERT_EQUAL_INT(3, key);
+
+    // the hand cleared 0 and 2 on its way past, so the rest go in slot order: 0, then 4 (in the
+    // slot that 1 had), then 2.
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_lru_cache_evict(&cache, &key, NULL));
+    TEST_ASSERT_EQUAL_INT(0, key);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_lru_cache_evict(&cache, &key, NULL));
+    TEST_ASSERT_EQUAL_INT(4, key);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_lru_cache_evict(&cache, &key, NULL));
+    TEST_ASSERT_EQUAL_INT(2, key);
+    TEST_ASSERT_EQUAL_INT(0, saeclib_lru_cache_size(&cache));
+}
+
+/**
+ * Random gets, puts and deletes in LRU mode agree with a cache that keeps a last-used time for
+ * every key and evicts by searching for the oldest one.
+ */
+void saeclib_lru_cache_fuzz_test()
+{
+#define NUMEL 32
+#define KEY_RANGE 100
+    saeclib_lru_cache_t cache = saeclib_lru_cache_salloc(NUMEL, sizeof(uint32_t), sizeof(uint32_t),
+                                                         saeclib_hash_table_u32_hash,
+                                                         saeclib_hash_table_u32_cmp,
+                                                         SAECLIB_LRU_CACHE_LRU);
+
+    // 0 for keys that aren't in the cache.
+    static uint64_t last_used[KEY_RANGE];
+    static uint32_t golden_values[KEY_RANGE];
+    uint64_t clock = 0;
+    size_t size = 0;
+
+    srand(0);
+    for (int i = 0; i < 100000; i++) {
+        const uint32_t key = rand() % KEY_RANGE;
+        uint32_t value;
+        saeclib_error_e err;
+        switch (rand() % 8) {
+            case 0:
+            case 1:
+            case 2:
+                err = saeclib_lru_cache_get(&cache, &key, &value);
+                if (last_used[key]) {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                    TEST_ASSERT_EQUAL_INT(golden_values[key], value);
+                    last_used[key] = ++clock;
+                } else {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+                }
+                break;
+
+            case 3:
+            case 4:
+            case 5:
+                value = rand();
+                if (!last_used[key] && (size == NUMEL)) {
+                    uint32_t oldest = 0;
+                    for (uint32_t k = 0; k < KEY_RANGE; k++) {
+                        if (last_used[k] && (!last_used[oldest] || (last_used[k] < last_used[oldest])))
+                            oldest = k;
+                    }
+                    last_used[oldest] = 0;
+                    size--;
+                }
+                if (!last_used[key])
+                    size++;
+                TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_lru_cache_put(&cache, &key, &value));
+                golden_values[key] = value;
+                last_used[key] = ++clock;
+                break;
+
+            case 6:
+                err = saeclib_lru_cache_delete(&cache, &key);
+                if (last_used[key]) {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+                    last_used[key] = 0;
+                    size--;
+                } else {
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+                }
+                break;
+
+            case 7:
+                if (size > (NUMEL / 2)) {
+                    uint32_t evicted;
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                                          saeclib_lru_cache_evict(&cache, &evicted, &value));
+                    for (uint32_t k = 0; k < KEY_RANGE; k++) {
+                        if (last_used[k])
+                            TEST_ASSERT_TRUE(last_used[k] >= last_used[evicted]);
+                    }
+                    TEST_ASSERT_EQUAL_INT(golden_values[evicted], value);
+                    last_used[evicted] = 0;
+                    size--;
+                }
+                break;
+        }
+        TEST_ASSERT_EQUAL_INT(size, saeclib_lru_cache_size(&cache));
+    }
+
+#undef KEY_RANGE
+#undef NUMEL
+}
+
+/**
+ * CLOCK mode keeps every key it's been given until it has to evict, and only ever evicts when
+ * it's full or asked to.
+ */
+void saeclib_lru_cache_clock_fuzz_test()
+{
+#define NUMEL 32
+#define KEY_RANGE 100
+    saeclib_lru_cache_t cache = saeclib_lru_cache_salloc(NUMEL, sizeof(uint32_t), sizeof(uint32_t),
+                                                         saeclib_hash_table_u32_hash,
+                                                         saeclib_hash_table_u32_cmp,
+                                                         SAECLIB_LRU_CACHE_CLOCK);
+    static bool present[KEY_RANGE];
+    size_t size = 0;
+
+    srand(1);
+    for (int i = 0; i < 100000; i++) {
+        const uint32_t key = rand() % KEY_RANGE;
+        uint32_t value;
+        switch (rand() % 4) {
+            case 0:
+            case 1:
+                if (saeclib_lru_cache_get(&cache, &key, &value) == SAECLIB_ERROR_NOERROR) {
+                    TEST_ASSERT_TRUE(present[key]);
+                    TEST_ASSERT_EQUAL_INT(key * 7, value);
+                } else {
+                    TEST_ASSERT_FALSE(present[key]);
+                }
+                break;
+
+            case 2:
+                if (!present[key] && (size == NUMEL)) {
+                    uint32_t evicted;
+                    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                                          saeclib_lru_cache_evict(&cache, &evicted, &value));
+                    TEST_ASSERT_TRUE(present[evicted]);
+                    TEST_ASSERT_EQUAL_INT(evicted * 7, value);
+                    present[evicted] = false;
+                    size--;
+                }
+                if (!present[key])
+                    size++;
+                present[key] = true;
+                saeclib_lru_cache_put(&cache, &key, (uint32_t[]){ key * 7 });
+                break;
+
+            case 3:
+                if (saeclib_lru_cache_delete(&cache, &key) == SAECLIB_ERROR_NOERROR) {
+                    TEST_ASSERT_TRUE(present[key]);
+                    present[key] = false;
+                    size--;
+                } else {
+                    TEST_ASSERT_FALSE(present[key]);
+                }
+                break;
+        }
+        TEST_ASSERT_EQUAL_INT(size, saeclib_lru_cache_size(&cache));
+    }
+
+#undef KEY_RANGE
+#undef NUMEL
+}
+
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(saeclib_lru_cache_init_test);
+    RUN_TEST(saeclib_lru_cache_lru_order_test);
+    RUN_TEST(saeclib_lru_cache_clock_test);
+    RUN_TEST(saeclib_lru_cache_fuzz_test);
+    RUN_TEST(saeclib_lru_cache_clock_fuzz_test);
+    return UNITY_END();
+}
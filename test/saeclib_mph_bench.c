@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "saeclib_hash.h"
+#include "saeclib_hash_functions.h"
+#include "saeclib_mph.h"
+
+/**
+ * Builds a minimal perfect hash over a million keys, and compares random lookups in it against a
+ * power-of-two saeclib_hash_table_t holding the same keys at 50% load.
+ */
+
+#define NKEYS    (1 << 20)
+#define NLOOKUPS (1 << 22)
+
+static uint32_t keys[NKEYS];
+static uint32_t values[NKEYS];
+static uint32_t lookups[NLOOKUPS];
+
+static uint32_t pilots[SAECLIB_MPH_NBUCKETS(NKEYS)];
+static uint32_t mph_keys[NKEYS];
+static uint32_t order[NKEYS];
+static uint32_t mph_values[NKEYS];
+static uint32_t workspace[SAECLIB_MPH_WORKSPACE_SIZE(NKEYS) / sizeof(uint32_t)];
+
+static uint32_t table_keys[2 * NKEYS];
+static uint32_t table_values[2 * NKEYS];
+static uint8_t table_status[2 * NKEYS];
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec * 1e-9);
+}
+
+int main(int argc, char** argv)
+{
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        keys[i] = i * 2654435761u;
+        values[i] = i;
+    }
+    srand(0);
+    for (uint32_t i = 0; i < NLOOKUPS; i++) {
+        lookups[i] = keys[rand() % NKEYS];
+    }
+
+    // a good 32-bit hash, so that hardly any keys end up in the stash.
+    saeclib_mph_t mph;
+    double t0 = now();
+    saeclib_error_e err = saeclib_mph_build(&mph, keys, NKEYS, sizeof(uint32_t),
+                                            saeclib_hash_u32, saeclib_hash_table_u32_cmp, pilots,
+                                            mph_keys, order, workspace, sizeof(workspace));
+    double t1 = now();
+    if (err != SAECLIB_ERROR_NOERROR) {
+        printf("build failed: %d\n", err);
+        return 1;
+    }
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        mph_values[i] = values[order[i]];
+    }
+
+    saeclib_hash_table_t sht;
+    saeclib_hash_table_init_pow2(&sht, table_keys, table_values, table_status,
+                                 sizeof(table_keys), sizeof(uint32_t), sizeof(uint32_t),
+                                 saeclib_hash_u32, saeclib_hash_table_u32_cmp);
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        saeclib_hash_insert(&sht, &keys[i], &values[i]);
+    }
+
+    uint64_t sum = 0;
+    double t2 = now();
+    for (uint32_t i = 0; i < NLOOKUPS; i++) {
+        uint32_t idx;
+        saeclib_mph_lookup(&mph, &lookups[i], &idx);
+        sum += mph_values[idx];
+    }
+    double t3 = now();
+    for (uint32_t i = 0; i < NLOOKUPS; i++) {
+        uint32_t value;
+        saeclib_hash_search(&sht, &lookups[i], &value);
+        sum += value;
+    }
+    double t4 = now();
+
+    printf("saeclib_mph_bench: %d keys, %d in the stash, built in %.1f ms (checksum %llu)\n",
+           NKEYS, NKEYS - mph.nmain, (t1 - t0) * 1e3, (unsigned long long)sum);
+    printf("perfect hash       %7.1f ns/lookup    %6.2f bytes/key\n",
+           (t3 - t2) * 1e9 / NLOOKUPS, (double)sizeof(pilots) / NKEYS);
+    printf("hash table         %7.1f ns/lookup\n", (t4 - t3) * 1e9 / NLOOKUPS);
+
+    return 0;
+}
@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "saeclib_hash.h"
+#include "saeclib_mph.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static unsigned int weak_hash(const void* a)
+{
+    return *(const uint32_t*)a % 97;
+}
+
+/**
+ * Checks that every one of the n keys maps to a different index, that order points back at it,
+ * and that the even keys from not_key_base on, which weren't in the set, aren't found.
+ */
+static void check_mph(const saeclib_mph_t* mph, const uint32_t* keys, const uint32_t* order,
+                      uint32_t n, uint32_t not_key_base)
+{
+    static bool seen[10000];
+    memset(seen, 0, sizeof(seen));
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t idx;
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_mph_lookup(mph, &keys[i], &idx));
+        TEST_ASSERT_TRUE(idx < n);
+        TEST_ASSERT_FALSE(seen[idx]);
+        seen[idx] = true;
+        TEST_ASSERT_EQUAL_INT(i, order[idx]);
+    }
+
+    for (uint32_t key = not_key_base; key < (not_key_base + 2000); key += 2) {
+        uint32_t idx;
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, saeclib_mph_lookup(mph, &key, &idx));
+    }
+}
+
+/**
+ * Every key gets its own index in [0, n).
+ */
+void saeclib_mph_build_test()
+{
+#define NUMEL 10000
+    static uint32_t keys[NUMEL];
+    static uint32_t pilots[SAECLIB_MPH_NBUCKETS(NUMEL)];
+    static uint32_t keyspace[NUMEL];
+    static uint32_t order[NUMEL];
+    static uint32_t workspace[SAECLIB_MPH_WORKSPACE_SIZE(NUMEL) / sizeof(uint32_t)];
+
+    // multiplying by an odd number is a bijection, so these are all different, and all odd.
+    for (uint32_t i = 0; i < NUMEL; i++) {
+        keys[i] = (i * 2654435761u) | 1;
+    }
+
+    // sizes that aren't a multiple of the bucket size, down to none at all.
+    const uint32_t sizes[] = { NUMEL, 4097, 7, 1, 0 };
+    for (int s = 0; s < 5; s++) {
+        saeclib_mph_t mph;
+        saeclib_error_e err = saeclib_mph_build(&mph, keys, sizes[s], sizeof(uint32_t),
+                                                saeclib_hash_table_u32_hash,
+                                                saeclib_hash_table_u32_cmp, pilots, keyspace,
+                                                order, workspace, sizeof(workspace));
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+        TEST_ASSERT_EQUAL_INT(sizes[s], mph.n);
+        TEST_ASSERT_EQUAL_INT(sizes[s], mph.nmain);
+
+        // even keys are never in the set.
+        check_mph(&mph, keys, order, sizes[s], 0);
+        for (uint32_t i = 0; i < sizes[s]; i++) {
+            TEST_ASSERT_EQUAL_INT(keys[order[i]], keyspace[i]);
+        }
+    }
+
+#undef NUMEL
+}
+
+/**
+ * Keys whose hashes collide go in the stash and are still found.
+ */
+void saeclib_mph_stash_test()
+{
+#define NUMEL 500
+    static uint32_t keys[NUMEL];
+    static uint32_t pilots[SAECLIB_MPH_NBUCKETS(NUMEL)];
+    static uint32_t keyspace[NUMEL];
+    static uint32_t order[NUMEL];
+    static uint32_t workspace[SAECLIB_MPH_WORKSPACE_SIZE(NUMEL) / sizeof(uint32_t)];
+
+    for (uint32_t i = 0; i < NUMEL; i++) {
+        keys[i] = i * 3;
+    }
+
+    saeclib_mph_t mph;
+    saeclib_error_e err = saeclib_mph_build(&mph, keys, NUMEL, sizeof(uint32_t), weak_hash,
+                                            saeclib_hash_table_u32_cmp, pilots, keyspace, order,
+                                            workspace, sizeof(workspace));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    TEST_ASSERT_EQUAL_INT(97, mph.nmain);
+
+    // keys that are beyond the set but hash the same as keys in it.
+    check_mph(&mph, keys, order, NUMEL, 3 * NUMEL);
+
+#undef NUMEL
+}
+
+/**
+ * Duplicate keys and a workspace that's too small are errors.
+ */
+void saeclib_mph_errors_test()
+{
+#define NUMEL 100
+    static uint32_t keys[NUMEL];
+    static uint32_t pilots[SAECLIB_MPH_NBUCKETS(NUMEL)];
+    static uint32_t keyspace[NUMEL];
+    static uint32_t workspace[SAECLIB_MPH_WORKSPACE_SIZE(NUMEL) / sizeof(uint32_t)];
+
+    for (uint32_t i = 0; i < NUMEL; i++) {
+        keys[i] = i;
+    }
+    keys[77] = 12;
+
+    saeclib_mph_t mph;
+    saeclib_error_e err = saeclib_mph_build(&mph, keys, NUMEL, sizeof(uint32_t),
+                                            saeclib_hash_table_u32_hash,
+                                            saeclib_hash_table_u32_cmp, pilots, keyspace, NULL,
+                                            workspace, sizeof(workspace));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_DUPLICATE_KEY, err);
+
+    // also with a duplicate that's in a group of colliding hashes.
+    err = saeclib_mph_build(&mph, keys, NUMEL, sizeof(uint32_t), weak_hash,
+                            saeclib_hash_table_u32_cmp, pilots, keyspace, NULL, workspace,
+                            sizeof(workspace));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_DUPLICATE_KEY, err);
+
+    keys[77] = 77;
+    err = saeclib_mph_build(&mph, keys, NUMEL, sizeof(uint32_t), saeclib_hash_table_u32_hash,
+                            saeclib_hash_table_u32_cmp, pilots, keyspace, NULL, workspace,
+                            sizeof(workspace) - 1);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_OVERFLOW, err);
+
+#undef NUMEL
+}
+
+/**
+ * The emitted C source defines the same hash.
+ */
+void saeclib_mph_emit_test()
+{
+#define NUMEL 20
+    static uint32_t keys[NUMEL];
+    static uint32_t pilots[SAECLIB_MPH_NBUCKETS(NUMEL)];
+    static uint32_t keyspace[NUMEL];
+    static uint32_t workspace[SAECLIB_MPH_WORKSPACE_SIZE(NUMEL) / sizeof(uint32_t)];
+    for (uint32_t i = 0; i < NUMEL; i++) {
+        keys[i] = i * 1000;
+    }
+
+    saeclib_mph_t mph;
+    saeclib_mph_build(&mph, keys, NUMEL, sizeof(uint32_t), saeclib_hash_table_u32_hash,
+                      saeclib_hash_table_u32_cmp, pilots, keyspace, NULL, workspace,
+                      sizeof(workspace));
+
+    FILE* f = tmpfile();
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                          saeclib_mph_emit_c(&mph, f, "thousands", "saeclib_hash_table_u32_hash",
+                                             "saeclib_hash_table_u32_cmp"));
+
+    static char src[16384];
+    rewind(f);
+    size_t len = fread(src, 1, sizeof(src) - 1, f);
+    src[len] = '\0';
+    fclose(f);
+
+    TEST_ASSERT_NOT_NULL(strstr(src, "const saeclib_mph_t thousands = {"));
+    TEST_ASSERT_NOT_NULL(strstr(src, "static const uint32_t thousands_pilots[6] = {"));
+    TEST_ASSERT_NOT_NULL(strstr(src, "static const uint8_t thousands_keys[80]"));
+    TEST_ASSERT_NOT_NULL(strstr(src, ".n = 20,"));
+    TEST_ASSERT_NOT_NULL(strstr(src, ".hash_fn = saeclib_hash_table_u32_hash,"));
+
+    // the key at index 0, byte for byte.
+    char first_key[64];
+    const uint8_t* k = mph.key_data;
+    snprintf(first_key, sizeof(first_key), "{\n    0x%02x, 0x%02x, 0x%02x, 0x%02x,", k[0], k[1],
+             k[2], k[3]);
+    TEST_ASSERT_NOT_NULL(strstr(src, first_key));
+
+#undef NUMEL
+}
+
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(saeclib_mph_build_test);
+    RUN_TEST(saeclib_mph_stash_test);
+    RUN_TEST(saeclib_mph_errors_test);
+    RUN_TEST(saeclib_mph_emit_test);
+    return UNITY_END();
+}
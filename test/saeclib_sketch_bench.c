@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "saeclib_hash_functions.h"
+#include "saeclib_sketch.h"
+
+/**
+ * Feeds a stream of keys into a count-min sketch and a HyperLogLog, reports the time per add and
+ * how far off the estimates are, and times merging two of each.
+ */
+
+#define NKEYS     (1 << 24)
+#define KEY_RANGE (1 << 22)
+#define NMERGES   1000
+
+static uint32_t stream[NKEYS];
+static uint32_t counts[KEY_RANGE];
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec * 1e-9);
+}
+
+int main(int argc, char** argv)
+{
+    // skewed towards small keys, like the other benches.
+    srand(0);
+    uint32_t distinct = 0;
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        uint64_t a = rand() % KEY_RANGE, b = rand() % KEY_RANGE;
+        stream[i] = (a * b) / KEY_RANGE;
+        distinct += (counts[stream[i]]++ == 0);
+    }
+
+    saeclib_count_min_t cms = saeclib_count_min_salloc(1 << 16, 4, saeclib_hash_u32);
+    saeclib_count_min_t cms2 = saeclib_count_min_salloc(1 << 16, 4, saeclib_hash_u32);
+    saeclib_hyperloglog_t hll = saeclib_hyperloglog_salloc(14, saeclib_hash_u32);
+    saeclib_hyperloglog_t hll2 = saeclib_hyperloglog_salloc(14, saeclib_hash_u32);
+
+    double t0 = now();
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        saeclib_count_min_add(&cms, &stream[i], 1);
+    }
+    double t1 = now();
+    for (uint32_t i = 0; i < NKEYS; i++) {
+        saeclib_hyperloglog_add(&hll, &stream[i]);
+    }
+    double t2 = now();
+
+    // average overestimate over the 1000 most common keys, which are the smallest ones.
+    uint64_t over = 0;
+    for (uint32_t key = 0; key < 1000; key++) {
+        over += saeclib_count_min_estimate(&cms, &key) - counts[key];
+    }
+    const double estimate = saeclib_hyperloglog_estimate(&hll);
+
+    double t3 = now();
+    for (int i = 0; i < NMERGES; i++) {
+        saeclib_count_min_merge(&cms2, &cms);
+    }
+    double t4 = now();
+    for (int i = 0; i < NMERGES; i++) {
+        saeclib_hyperloglog_merge(&hll2, &hll);
+    }
+    double t5 = now();
+
+    printf("saeclib_sketch_bench: %d keys, %u distinct\n", NKEYS, distinct);
+    printf("count-min, 4 x 65536   %5.1f ns/add   mean overestimate %.1f for top keys"
+           "   %7.1f us/merge\n", (t1 - t0) * 1e9 / NKEYS, over / 1000.0,
+           (t4 - t3) * 1e6 / NMERGES);
+    printf("hyperloglog, 2^14      %5.1f ns/add   estimate %.0f (%+.2f%%)"
+           "            %7.1f us/merge\n", (t2 - t1) * 1e9 / NKEYS, estimate,
+           100.0 * (estimate - distinct) / distinct, (t5 - t4) * 1e6 / NMERGES);
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "saeclib_hash_functions.h"
+#include "saeclib_sketch.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void saeclib_count_min_init_test()
+{
+    saeclib_count_min_t cms;
+    static uint32_t counterspace[4 * 24];
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_count_min_init(&cms, counterspace, sizeof(counterspace), 0,
+                                                 saeclib_hash_table_u32_hash));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_count_min_init(&cms, counterspace, sizeof(counterspace), 4,
+                                                 saeclib_hash_table_u32_hash));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                          saeclib_count_min_init(&cms, counterspace, sizeof(counterspace), 3,
+                                                 saeclib_hash_table_u32_hash));
+    TEST_ASSERT_EQUAL_INT(32, cms.width);
+
+    cms = saeclib_count_min_salloc(1024, 4, saeclib_hash_table_u32_hash);
+    TEST_ASSERT_EQUAL_INT(1024, cms.width);
+    TEST_ASSERT_EQUAL_INT(4, cms.depth);
+    uint32_t key = 7;
+    TEST_ASSERT_EQUAL_INT(0, saeclib_count_min_estimate(&cms, &key));
+}
+
+/**
+ * Estimates for a skewed stream of keys are never under the true counts, and almost never more
+ * than the error bound over them.
+ */
+void saeclib_count_min_test()
+{
+#define KEY_RANGE 10000
+    saeclib_count_min_t cms = saeclib_count_min_salloc(1024, 4, saeclib_hash_table_u32_hash);
+    static uint32_t counts[KEY_RANGE];
+
+    srand(0);
+    for (int i = 0; i < 200000; i++) {
+        // small keys are much more common.
+        uint32_t key = ((uint64_t)(rand() % KEY_RANGE) * (rand() % KEY_RANGE)) / KEY_RANGE;
+        uint32_t count = 1 + (rand() % 3);
+        saeclib_count_min_add(&cms, &key, count);
+        counts[key] += count;
+    }
+
+    uint64_t total = 0;
+    for (uint32_t key = 0; key < KEY_RANGE; key++) {
+        total += counts[key];
+    }
+    TEST_ASSERT_EQUAL_INT(total, cms.total);
+
+    int over_bound = 0;
+    for (uint32_t key = 0; key < KEY_RANGE; key++) {
+        const uint32_t estimate = saeclib_count_min_estimate(&cms, &key);
+        TEST_ASSERT_TRUE(estimate >= counts[key]);
+        if ((estimate - counts[key]) > ((total * 272) / (100 * 1024)))
+            over_bound++;
+    }
+
+    // at most e^-4 = 1.8% of keys are allowed over; conservative update does far better.
+    TEST_ASSERT_TRUE(over_bound < (KEY_RANGE / 1000));
+
+    saeclib_count_min_clear(&cms);
+    TEST_ASSERT_EQUAL_INT(0, saeclib_count_min_estimate(&cms, (uint32_t[]){ 0 }));
+    TEST_ASSERT_EQUAL_INT(0, cms.total);
+
+#undef KEY_RANGE
+}
+
+/**
+ * A merged sketch's counters are the sums of the two sketches' counters, and its estimates are at
+ * least the true counts of both streams together. Counters saturate.
+ */
+void saeclib_count_min_merge_test()
+{
+#define KEY_RANGE 4096
+    saeclib_count_min_t a = saeclib_count_min_salloc(256, 3, saeclib_hash_table_u32_hash);
+    saeclib_count_min_t b = saeclib_count_min_salloc(256, 3, saeclib_hash_table_u32_hash);
+    static uint32_t counts_a[KEY_RANGE], counts_b[KEY_RANGE];
+    static uint32_t counters_a[256 * 3];
+
+    srand(1);
+    for (int i = 0; i < 50000; i++) {
+        uint32_t key = rand() % KEY_RANGE;
+        if (rand() % 2) {
+            saeclib_count_min_add(&a, &key, 1);
+            counts_a[key]++;
+        } else {
+            saeclib_count_min_add(&b, &key, 1);
+            counts_b[key]++;
+        }
+    }
+    memcpy(counters_a, a.counters, sizeof(counters_a));
+
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_count_min_merge(&a, &b));
+    TEST_ASSERT_EQUAL_INT(50000, a.total);
+    for (int i = 0; i < (256 * 3); i++) {
+        TEST_ASSERT_EQUAL_UINT32(counters_a[i] + b.counters[i], a.counters[i]);
+    }
+    for (uint32_t key = 0; key < KEY_RANGE; key++) {
+        TEST_ASSERT_TRUE(saeclib_count_min_estimate(&a, &key) >= (counts_a[key] + counts_b[key]));
+    }
+
+    // different shapes don't merge.
+    saeclib_count_min_t c = saeclib_count_min_salloc(256, 4, saeclib_hash_table_u32_hash);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, saeclib_count_min_merge(&a, &c));
+    saeclib_count_min_t d = saeclib_count_min_salloc(256, 3, saeclib_hash_u32);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, saeclib_count_min_merge(&a, &d));
+
+    // adding or merging past UINT32_MAX sticks there.
+    uint32_t key = 12345;
+    saeclib_count_min_add(&c, &key, UINT32_MAX - 1);
+    saeclib_count_min_add(&c, &key, 5);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, saeclib_count_min_estimate(&c, &key));
+    saeclib_count_min_t e = saeclib_count_min_salloc(256, 4, saeclib_hash_table_u32_hash);
+    saeclib_count_min_add(&e, &key, 2);
+    saeclib_count_min_add(&c, &key, 0);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_count_min_merge(&e, &c));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, saeclib_count_min_estimate(&e, &key));
+
+#undef KEY_RANGE
+}
+
+void saeclib_hyperloglog_init_test()
+{
+    saeclib_hyperloglog_t hll;
+    static uint8_t registerspace[1 << 10];
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_hyperloglog_init(&hll, registerspace, sizeof(registerspace), 3,
+                                                   saeclib_hash_table_u32_hash));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE,
+                          saeclib_hyperloglog_init(&hll, registerspace, sizeof(registerspace), 11,
+                                                   saeclib_hash_table_u32_hash));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR,
+                          saeclib_hyperloglog_init(&hll, registerspace, sizeof(registerspace), 10,
+                                                   saeclib_hash_table_u32_hash));
+
+    hll = saeclib_hyperloglog_salloc(12, saeclib_hash_table_u32_hash);
+    TEST_ASSERT_EQUAL_INT(12, hll.precision);
+    TEST_ASSERT_EQUAL_FLOAT(0.0, saeclib_hyperloglog_estimate(&hll));
+}
+
+/**
+ * Estimates stay within a few standard errors of the true number of distinct keys, small and
+ * large, however many times each key is added.
+ */
+void saeclib_hyperloglog_test()
+{
+    saeclib_hyperloglog_t hll = saeclib_hyperloglog_salloc(12, saeclib_hash_table_u32_hash);
+
+    // 1.04 / sqrt(4096) = 1.6%; allow 4 standard errors.
+    const uint32_t checkpoints[] = { 10, 100, 1000, 10000, 100000, 1000000 };
+    uint32_t added = 0;
+    for (int c = 0; c < 6; c++) {
+        for (; added < checkpoints[c]; added++) {
+            uint32_t key = added * 7;
+            saeclib_hyperloglog_add(&hll, &key);
+            saeclib_hyperloglog_add(&hll, &key);
+        }
+        const double estimate = saeclib_hyperloglog_estimate(&hll);
+        TEST_ASSERT_TRUE(estimate > (checkpoints[c] * 0.936));
+        TEST_ASSERT_TRUE(estimate < (checkpoints[c] * 1.064));
+    }
+
+    saeclib_hyperloglog_clear(&hll);
+    TEST_ASSERT_EQUAL_FLOAT(0.0, saeclib_hyperloglog_estimate(&hll));
+}
+
+/**
+ * Merging two sketches gives exactly the sketch of all of their keys.
+ */
+void saeclib_hyperloglog_merge_test()
+{
+    saeclib_hyperloglog_t a = saeclib_hyperloglog_salloc(10, saeclib_hash_table_u32_hash);
+    saeclib_hyperloglog_t b = saeclib_hyperloglog_salloc(10, saeclib_hash_table_u32_hash);
+    saeclib_hyperloglog_t all = saeclib_hyperloglog_salloc(10, saeclib_hash_table_u32_hash);
+
+    for (uint32_t key = 0; key < 50000; key++) {
+        saeclib_hyperloglog_add((key % 3) ? &a : &b, &key);
+        saeclib_hyperloglog_add(&all, &key);
+    }
+    // some keys in both.
+    for (uint32_t key = 0; key < 1000; key++) {
+        saeclib_hyperloglog_add(&a, &key);
+        saeclib_hyperloglog_add(&b, &key);
+    }
+
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_hyperloglog_merge(&a, &b));
+    TEST_ASSERT_EQUAL_MEMORY(all.registers, a.registers, 1 << 10);
+
+    saeclib_hyperloglog_t c = saeclib_hyperloglog_salloc(11, saeclib_hash_table_u32_hash);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_BAD_STRUCTURE, saeclib_hyperloglog_merge(&a, &c));
+}
+
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(saeclib_count_min_init_test);
+    RUN_TEST(saeclib_count_min_test);
+    RUN_TEST(saeclib_count_min_merge_test);
+    RUN_TEST(saeclib_hyperloglog_init_test);
+    RUN_TEST(saeclib_hyperloglog_test);
+    RUN_TEST(saeclib_hyperloglog_merge_test);
+    return UNITY_END();
+}
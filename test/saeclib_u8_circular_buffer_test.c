@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "unity.h"
 
@@ -389,6 +390,196 @@ void saeclib_u8_circular_buffer_pushmany_popmany_fuzz_test0()
 #undef NUMEL
 }
 
+/**
+ * Make sure that find locates bytes in both segments of a wrapped buffer and reports their offset
+ * from the tail.
+ */
+void saeclib_u8_circular_buffer_find_wrap_test()
+{
+#define NUMEL 50
+
+    saeclib_u8_circular_buffer_t scb = saeclib_u8_circular_buffer_salloc(NUMEL);
+
+    // move the tail near the end of the buffer so that the next push wraps.
+    uint8_t junk[40] = { 0 };
+    saeclib_u8_circular_buffer_pushmany(&scb, junk, sizeof(junk));
+    saeclib_u8_circular_buffer_disposemany(&scb, sizeof(junk));
+
+    uint8_t data[30];
+    for (int i = 0; i < 30; i++) data[i] = 'a' + (i % 20);
+    data[5] = '\n';
+    data[25] = 0x7e;
+    saeclib_error_e err = saeclib_u8_circular_buffer_pushmany(&scb, data, sizeof(data));
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    TEST_ASSERT_TRUE(scb.head < scb.tail);
+
+    size_t offset = 1234;
+    err = saeclib_u8_circular_buffer_find(&scb, '\n', &offset);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    TEST_ASSERT_EQUAL_INT(5, offset);
+
+    // this one is in the second segment.
+    err = saeclib_u8_circular_buffer_find(&scb, 0x7e, &offset);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    TEST_ASSERT_EQUAL_INT(25, offset);
+
+    offset = 1234;
+    err = saeclib_u8_circular_buffer_find(&scb, 0xff, &offset);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+    TEST_ASSERT_EQUAL_INT(1234, offset);
+
+    err = saeclib_u8_circular_buffer_find_any(&scb, (uint8_t[]){ 0xff, 0x7e, '\n' }, 3, &offset);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    TEST_ASSERT_EQUAL_INT(5, offset);
+
+    err = saeclib_u8_circular_buffer_find_any(&scb, (uint8_t[]){ 0xff, 0x7e }, 2, &offset);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    TEST_ASSERT_EQUAL_INT(25, offset);
+
+    // searching doesn't consume anything
+    TEST_ASSERT_EQUAL_INT(30, saeclib_u8_circular_buffer_size(&scb));
+
+#undef NUMEL
+}
+
+/**
+ * Compare find and find_any against a byte-by-byte search on random data, using sets that are big
+ * enough to take both the SIMD and the table-driven paths.
+ */
+void saeclib_u8_circular_buffer_find_fuzz_test0()
+{
+#define NUMEL 301
+    srand(0);
+
+    saeclib_u8_circular_buffer_t scb = saeclib_u8_circular_buffer_salloc(NUMEL);
+
+    for (int i = 0; i < 2000; i++) {
+        // random fill level and random position of the tail.
+        uint8_t buf[NUMEL];
+        int shift = rand() % NUMEL;
+        int fill = rand() % NUMEL;
+        scb.head = scb.tail = shift;
+        for (int j = 0; j < fill; j++) buf[j] = rand() % 64;
+        saeclib_u8_circular_buffer_pushmany(&scb, buf, fill);
+
+        uint8_t set[24];
+        size_t setlen = 1 + (rand() % 24);
+        for (int j = 0; j < setlen; j++) set[j] = 64 + (rand() % 192);
+
+        // plant a few matches, sometimes
+        int plant = (fill > 0) ? (rand() % 3) : 0;
+        for (int j = 0; j < plant; j++) {
+            int pos = rand() % fill;
+            buf[pos] = set[rand() % setlen];
+            scb.data[(scb.tail + pos) % NUMEL] = buf[pos];
+        }
+
+        int golden_one = -1, golden_any = -1;
+        for (int j = fill - 1; j >= 0; j--) {
+            if (buf[j] == set[0]) golden_one = j;
+            for (int k = 0; k < setlen; k++) {
+                if (buf[j] == set[k]) golden_any = j;
+            }
+        }
+
+        size_t offset;
+        saeclib_error_e err = saeclib_u8_circular_buffer_find(&scb, set[0], &offset);
+        if (golden_one == -1) {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+        } else {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+            TEST_ASSERT_EQUAL_INT(golden_one, offset);
+        }
+
+        err = saeclib_u8_circular_buffer_find_any(&scb, set, setlen, &offset);
+        if (golden_any == -1) {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+        } else {
+            TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+            TEST_ASSERT_EQUAL_INT(golden_any, offset);
+        }
+    }
+
+#undef NUMEL
+}
+
+/**
+ * Pop newline-delimited frames, including one that straddles the wrap point and one that's too big
+ * for the caller's frame buffer.
+ */
+void saeclib_u8_circular_buffer_pop_frame_test()
+{
+#define NUMEL 32
+
+    saeclib_u8_circular_buffer_t scb = saeclib_u8_circular_buffer_salloc(NUMEL);
+    scb.head = scb.tail = 20;
+
+    const char* stream = "hi\nwrapped line\n\npartial";
+    saeclib_u8_circular_buffer_pushmany(&scb, (const uint8_t*)stream, strlen(stream));
+
+    uint8_t frame[16];
+    size_t framelen;
+    saeclib_error_e err = saeclib_u8_circular_buffer_pop_frame(&scb, '\n', frame, sizeof(frame),
+                                                               &framelen);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    TEST_ASSERT_EQUAL_INT(2, framelen);
+    TEST_ASSERT_EQUAL_MEMORY("hi", frame, 2);
+
+    // too small of a frame buffer leaves the buffer alone.
+    err = saeclib_u8_circular_buffer_pop_frame(&scb, '\n', frame, 4, &framelen);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_OVERFLOW, err);
+    TEST_ASSERT_EQUAL_INT(12, framelen);
+
+    err = saeclib_u8_circular_buffer_pop_frame(&scb, '\n', frame, sizeof(frame), &framelen);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    TEST_ASSERT_EQUAL_INT(12, framelen);
+    TEST_ASSERT_EQUAL_MEMORY("wrapped line", frame, 12);
+
+    // empty frame
+    err = saeclib_u8_circular_buffer_pop_frame(&scb, '\n', frame, sizeof(frame), &framelen);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, err);
+    TEST_ASSERT_EQUAL_INT(0, framelen);
+
+    // incomplete frame stays put
+    err = saeclib_u8_circular_buffer_pop_frame(&scb, '\n', frame, sizeof(frame), &framelen);
+    TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_UNDERFLOW, err);
+    TEST_ASSERT_EQUAL_INT(strlen("partial"), saeclib_u8_circular_buffer_size(&scb));
+
+#undef NUMEL
+}
+
+/**
+ * Bulk transfers in streaming mode should give back exactly what was put in, no matter how the
+ * transfers line up with the end of the buffer or with 16-byte boundaries.
+ */
+void saeclib_u8_circular_buffer_streaming_test()
+{
+#define NUMEL 4099
+    srand(1);
+
+    saeclib_u8_circular_buffer_t scb = saeclib_u8_circular_buffer_salloc(NUMEL);
+    saeclib_u8_circular_buffer_set_streaming(&scb, 64);
+
+    uint32_t push_count = 0, pop_count = 0;
+    for (int i = 0; i < 5000; i++) {
+        static uint8_t tmp[NUMEL];
+        int free_space = NUMEL - 1 - saeclib_u8_circular_buffer_size(&scb);
+        int n = (free_space > 0) ? (rand() % (free_space + 1)) : 0;
+        for (int j = 0; j < n; j++) tmp[j] = (push_count + j) * 13;
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_u8_circular_buffer_pushmany(&scb, tmp, n));
+        push_count += n;
+
+        n = rand() % (saeclib_u8_circular_buffer_size(&scb) + 1);
+        TEST_ASSERT_EQUAL_INT(SAECLIB_ERROR_NOERROR, saeclib_u8_circular_buffer_popmany(&scb, tmp, n));
+        for (int j = 0; j < n; j++) {
+            TEST_ASSERT_EQUAL_UINT8((uint8_t)((pop_count + j) * 13), tmp[j]);
+        }
+        pop_count += n;
+    }
+
+#undef NUMEL
+}
+
 int main(int argc, char** argv)
 {
     UNITY_BEGIN();
@@ -405,5 +596,9 @@ int main(int argc, char** argv)
     RUN_TEST(saeclib_u8_circular_buffer_pushmany_overflow_test);
     RUN_TEST(saeclib_u8_circular_buffer_popmany_underflow_test);
     RUN_TEST(saeclib_u8_circular_buffer_pushmany_popmany_fuzz_test0);
+    RUN_TEST(saeclib_u8_circular_buffer_find_wrap_test);
+    RUN_TEST(saeclib_u8_circular_buffer_find_fuzz_test0);
+    RUN_TEST(saeclib_u8_circular_buffer_pop_frame_test);
+    RUN_TEST(saeclib_u8_circular_buffer_streaming_test);
     return UNITY_END();
 }
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "saeclib_circular_buffer.h"
+
+/**
+ * Measures how much a bulk transfer through a large u8 circular buffer slows down an unrelated,
+ * cache-sensitive thread, with and without streaming mode.
+ *
+ * The "hot" thread chases pointers around a random cycle through an array that fits in the cache.
+ * Meanwhile the main thread pushes 64KiB chunks into a 64MiB buffer and only pops them once the
+ * buffer is half full, like a consumer that reads data long after it's written.
+ */
+
+#define RING_SIZE     (64 * 1024 * 1024)
+#define CHUNK_SIZE    (64 * 1024)
+#define TOTAL_BYTES   (2048ull * 1024 * 1024)
+#define HOT_ELEMENTS  (256 * 1024)
+
+static uint8_t ring_space[RING_SIZE];
+static uint8_t chunk[CHUNK_SIZE];
+static uint32_t hot[HOT_ELEMENTS];
+
+static volatile int stop_hot;
+static volatile uint64_t hot_steps;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec * 1e-9);
+}
+
+static void* hot_worker(void* arg)
+{
+    uint32_t idx = 0;
+    uint64_t steps = 0;
+    while (!stop_hot) {
+        for (int i = 0; i < 1024; i++) {
+            idx = hot[idx];
+        }
+        steps += 1024;
+    }
+    hot_steps = steps + (idx & 1);
+    return NULL;
+}
+
+/**
+ * Runs the transfer with the given streaming threshold (0 for plain memcpy), or with no transfer at
+ * all if transfer is false, and prints the transfer rate and the hot thread's step rate.
+ */
+static void run(const char* name, bool transfer, size_t threshold)
+{
+    saeclib_u8_circular_buffer_t scb;
+    saeclib_u8_circular_buffer_init(&scb, ring_space, sizeof(ring_space));
+    saeclib_u8_circular_buffer_set_streaming(&scb, threshold);
+
+    stop_hot = 0;
+    pthread_t t;
+    pthread_create(&t, NULL, hot_worker, NULL);
+
+    double start = now();
+    if (transfer) {
+        static uint8_t out[CHUNK_SIZE];
+        for (uint64_t moved = 0; moved < TOTAL_BYTES; moved += CHUNK_SIZE) {
+            saeclib_u8_circular_buffer_pushmany(&scb, chunk, CHUNK_SIZE);
+            if (saeclib_u8_circular_buffer_size(&scb) > (RING_SIZE / 2)) {
+                saeclib_u8_circular_buffer_popmany(&scb, out, CHUNK_SIZE);
+            }
+        }
+    } else {
+        while ((now() - start) < 1.0);
+    }
+    double elapsed = now() - start;
+
+    stop_hot = 1;
+    pthread_join(t, NULL);
+
+    printf("%-24s transfer %8.1f MB/s    hot thread %8.1f Msteps/s\n", name,
+           transfer ? (TOTAL_BYTES / elapsed / 1e6) : 0.0, hot_steps / elapsed / 1e6);
+}
+
+int main(int argc, char** argv)
+{
+    // Sattolo's algorithm gives a single cycle through every element.
+    srand(0);
+    for (uint32_t i = 0; i < HOT_ELEMENTS; i++) hot[i] = i;
+    for (uint32_t i = HOT_ELEMENTS - 1; i > 0; i--) {
+        uint32_t j = rand() % i;
+        uint32_t tmp = hot[i];
+        hot[i] = hot[j];
+        hot[j] = tmp;
+    }
+    for (int i = 0; i < CHUNK_SIZE; i++) chunk[i] = i;
+
+    printf("saeclib_u8_stream_bench: %d MiB buffer, %d KiB chunks, %llu MiB moved\n",
+           RING_SIZE >> 20, CHUNK_SIZE >> 10, TOTAL_BYTES >> 20);
+    run("hot thread alone", false, 0);
+    run("memcpy", true, 0);
+    run("streaming", true, 4096);
+
+    return 0;
+}